@@ -69,11 +69,14 @@ typedef struct {
 
 extern StringEntry lovrArcMode[];
 extern StringEntry lovrAttributeType[];
+extern StringEntry lovrAudioOutput[];
 extern StringEntry lovrBlendAlphaMode[];
 extern StringEntry lovrBlendMode[];
 extern StringEntry lovrBlockType[];
+extern StringEntry lovrBroadPhase[];
 extern StringEntry lovrBufferUsage[];
 extern StringEntry lovrCompareMode[];
+extern StringEntry lovrContactEventType[];
 extern StringEntry lovrCoordinateSpace[];
 extern StringEntry lovrDevice[];
 extern StringEntry lovrDeviceAxe[];
@@ -192,4 +195,5 @@ void luax_pushjoint(lua_State* L, struct Joint* joint);
 void luax_pushshape(lua_State* L, struct Shape* shape);
 struct Joint* luax_checkjoint(lua_State* L, int index);
 struct Shape* luax_checkshape(lua_State* L, int index);
+struct Shape* luax_newmeshshape(lua_State* L, int index);
 #endif
@@ -7,6 +7,14 @@
 #include "core/ref.h"
 #include <stdlib.h>
 
+StringEntry lovrAudioOutput[] = {
+  [OUTPUT_OPENAL] = ENTRY("openal"),
+  [OUTPUT_MIXER] = ENTRY("mixer"),
+  [OUTPUT_WAV] = ENTRY("wav"),
+  [OUTPUT_NULL] = ENTRY("null"),
+  { 0 }
+};
+
 StringEntry lovrSourceType[] = {
   [SOURCE_STATIC] = ENTRY("static"),
   [SOURCE_STREAM] = ENTRY("stream"),
@@ -24,6 +32,11 @@ static int l_lovrAudioUpdate(lua_State* L) {
   return 0;
 }
 
+static int l_lovrAudioGetCacheLimit(lua_State* L) {
+  lua_pushinteger(L, lovrAudioGetCacheLimit());
+  return 1;
+}
+
 static int l_lovrAudioGetDopplerEffect(lua_State* L) {
   float factor, speedOfSound;
   lovrAudioGetDopplerEffect(&factor, &speedOfSound);
@@ -87,6 +100,36 @@ static int l_lovrAudioGetPosition(lua_State* L) {
   return 3;
 }
 
+static int l_lovrAudioGetStats(lua_State* L) {
+  if (lua_gettop(L) > 0) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    lua_settop(L, 1);
+  } else {
+    lua_createtable(L, 0, 9);
+  }
+
+  const AudioStats* stats = lovrAudioGetStats();
+  lua_pushinteger(L, stats->sources);
+  lua_setfield(L, 1, "sources");
+  lua_pushinteger(L, stats->voices);
+  lua_setfield(L, 1, "voices");
+  lua_pushinteger(L, stats->streams);
+  lua_setfield(L, 1, "streams");
+  lua_pushinteger(L, stats->underruns);
+  lua_setfield(L, 1, "underruns");
+  lua_pushinteger(L, stats->queuedSamples);
+  lua_setfield(L, 1, "queuedsamples");
+  lua_pushnumber(L, stats->decodeTime);
+  lua_setfield(L, 1, "decodetime");
+  lua_pushnumber(L, stats->mixerLoad);
+  lua_setfield(L, 1, "mixerload");
+  lua_pushinteger(L, stats->soundMemory);
+  lua_setfield(L, 1, "soundmemory");
+  lua_pushinteger(L, stats->bufferMemory);
+  lua_setfield(L, 1, "buffermemory");
+  return 1;
+}
+
 static int l_lovrAudioGetVelocity(lua_State* L) {
   float velocity[4];
   lovrAudioGetVelocity(velocity);
@@ -132,7 +175,7 @@ static int l_lovrAudioNewSource(lua_State* L) {
         soundData = lovrSoundDataCreateFromAudioStream(stream);
       } else {
         Blob* blob = luax_readblob(L, 1, "Source");
-        soundData = lovrSoundDataCreateFromBlob(blob);
+        soundData = lovrAudioLoadSound(blob);
         lovrRelease(Blob, blob);
       }
 
@@ -163,6 +206,17 @@ static int l_lovrAudioPause(lua_State* L) {
   return 0;
 }
 
+static int l_lovrAudioRender(lua_State* L) {
+  uint32_t frames = luaL_checkinteger(L, 1);
+  lovrAudioRender(frames);
+  return 0;
+}
+
+static int l_lovrAudioSetCacheLimit(lua_State* L) {
+  lovrAudioSetCacheLimit(luaL_checkinteger(L, 1));
+  return 0;
+}
+
 static int l_lovrAudioSetDopplerEffect(lua_State* L) {
   float factor = luax_optfloat(L, 1, 1.f);
   float speedOfSound = luax_optfloat(L, 2, 343.29f);
@@ -214,17 +268,21 @@ static int l_lovrAudioStop(lua_State* L) {
 
 static const luaL_Reg lovrAudio[] = {
   { "update", l_lovrAudioUpdate },
+  { "getCacheLimit", l_lovrAudioGetCacheLimit },
   { "getDopplerEffect", l_lovrAudioGetDopplerEffect },
   { "getMicrophoneNames", l_lovrAudioGetMicrophoneNames },
   { "getOrientation", l_lovrAudioGetOrientation },
   { "getPose", l_lovrAudioGetPose },
   { "getPosition", l_lovrAudioGetPosition },
+  { "getStats", l_lovrAudioGetStats },
   { "getVelocity", l_lovrAudioGetVelocity },
   { "getVolume", l_lovrAudioGetVolume },
   { "isSpatialized", l_lovrAudioIsSpatialized },
   { "newMicrophone", l_lovrAudioNewMicrophone },
   { "newSource", l_lovrAudioNewSource },
   { "pause", l_lovrAudioPause },
+  { "render", l_lovrAudioRender },
+  { "setCacheLimit", l_lovrAudioSetCacheLimit },
   { "setDopplerEffect", l_lovrAudioSetDopplerEffect },
   { "setOrientation", l_lovrAudioSetOrientation },
   { "setPose", l_lovrAudioSetPose },
@@ -240,8 +298,39 @@ int luaopen_lovr_audio(lua_State* L) {
   luax_register(L, lovrAudio);
   luax_registertype(L, Microphone);
   luax_registertype(L, Source);
-  if (lovrAudioInit()) {
+
+  AudioOutput output = OUTPUT_OPENAL;
+  uint32_t sampleRate = 44100;
+  uint32_t voices = 64;
+  const char* path = "audio.wav";
+
+  luax_pushconf(L);
+  if (lua_istable(L, -1)) {
+    lua_getfield(L, -1, "audio");
+    if (lua_istable(L, -1)) {
+      lua_getfield(L, -1, "output");
+      output = luax_checkenum(L, -1, AudioOutput, "openal");
+      lua_pop(L, 1);
+
+      lua_getfield(L, -1, "samplerate");
+      sampleRate = luaL_optinteger(L, -1, sampleRate);
+      lua_pop(L, 1);
+
+      lua_getfield(L, -1, "voices");
+      voices = luaL_optinteger(L, -1, voices);
+      lua_pop(L, 1);
+
+      lua_getfield(L, -1, "path");
+      path = luaL_optstring(L, -1, path);
+      lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+  }
+
+  if (lovrAudioInit(output, sampleRate, voices, path)) {
     luax_atexit(L, lovrAudioDestroy);
   }
+
+  lua_pop(L, 1);
   return 1;
 }
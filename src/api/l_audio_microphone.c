@@ -1,6 +1,10 @@
 #include "api.h"
 #include "audio/audio.h"
+#include "data/audioStream.h"
 #include "data/soundData.h"
+#ifdef LOVR_ENABLE_THREAD
+#include "thread/channel.h"
+#endif
 #include "core/ref.h"
 #include <stdlib.h>
 
@@ -44,6 +48,12 @@ static int l_lovrMicrophoneGetName(lua_State* L) {
   return 1;
 }
 
+static int l_lovrMicrophoneGetOverruns(lua_State* L) {
+  Microphone* microphone = luax_checktype(L, 1, Microphone);
+  lua_pushinteger(L, lovrMicrophoneGetOverruns(microphone));
+  return 1;
+}
+
 static int l_lovrMicrophoneGetSampleCount(lua_State* L) {
   Microphone* microphone = luax_checktype(L, 1, Microphone);
   lua_pushinteger(L, lovrMicrophoneGetSampleCount(microphone));
@@ -56,18 +66,56 @@ static int l_lovrMicrophoneGetSampleRate(lua_State* L) {
   return 1;
 }
 
+static int l_lovrMicrophoneIsCapturing(lua_State* L) {
+  Microphone* microphone = luax_checktype(L, 1, Microphone);
+  lua_pushboolean(L, lovrMicrophoneIsCapturing(microphone));
+  return 1;
+}
+
 static int l_lovrMicrophoneIsRecording(lua_State* L) {
   Microphone* microphone = luax_checktype(L, 1, Microphone);
   lua_pushboolean(L, lovrMicrophoneIsRecording(microphone));
   return 1;
 }
 
+static int l_lovrMicrophoneSetChannel(lua_State* L) {
+  Microphone* microphone = luax_checktype(L, 1, Microphone);
+#ifdef LOVR_ENABLE_THREAD
+  Channel* channel = lua_isnoneornil(L, 2) ? NULL : luax_checktype(L, 2, Channel);
+#else
+  struct Channel* channel = NULL;
+#endif
+  uint32_t chunkSize = luaL_optinteger(L, 3, lovrMicrophoneGetSampleRate(microphone) / 50);
+  lovrMicrophoneSetChannel(microphone, channel, chunkSize);
+  return 0;
+}
+
+static int l_lovrMicrophoneSetStream(lua_State* L) {
+  Microphone* microphone = luax_checktype(L, 1, Microphone);
+  AudioStream* stream = lua_isnoneornil(L, 2) ? NULL : luax_checktype(L, 2, AudioStream);
+  lovrMicrophoneSetStream(microphone, stream);
+  return 0;
+}
+
+static int l_lovrMicrophoneStartCapture(lua_State* L) {
+  Microphone* microphone = luax_checktype(L, 1, Microphone);
+  size_t bufferSize = luaL_optinteger(L, 2, lovrMicrophoneGetSampleRate(microphone) / 4);
+  lovrMicrophoneStartCapture(microphone, bufferSize);
+  return 0;
+}
+
 static int l_lovrMicrophoneStartRecording(lua_State* L) {
   Microphone* microphone = luax_checktype(L, 1, Microphone);
   lovrMicrophoneStartRecording(microphone);
   return 0;
 }
 
+static int l_lovrMicrophoneStopCapture(lua_State* L) {
+  Microphone* microphone = luax_checktype(L, 1, Microphone);
+  lovrMicrophoneStopCapture(microphone);
+  return 0;
+}
+
 static int l_lovrMicrophoneStopRecording(lua_State* L) {
   Microphone* microphone = luax_checktype(L, 1, Microphone);
   lovrMicrophoneStopRecording(microphone);
@@ -79,10 +127,16 @@ const luaL_Reg lovrMicrophone[] = {
   { "getChannelCount", l_lovrMicrophoneGetChannelCount },
   { "getData", l_lovrMicrophoneGetData },
   { "getName", l_lovrMicrophoneGetName },
+  { "getOverruns", l_lovrMicrophoneGetOverruns },
   { "getSampleCount", l_lovrMicrophoneGetSampleCount },
   { "getSampleRate", l_lovrMicrophoneGetSampleRate },
+  { "isCapturing", l_lovrMicrophoneIsCapturing },
   { "isRecording", l_lovrMicrophoneIsRecording },
+  { "setChannel", l_lovrMicrophoneSetChannel },
+  { "setStream", l_lovrMicrophoneSetStream },
+  { "startCapture", l_lovrMicrophoneStartCapture },
   { "startRecording", l_lovrMicrophoneStartRecording },
+  { "stopCapture", l_lovrMicrophoneStopCapture },
   { "stopRecording", l_lovrMicrophoneStopRecording },
   { NULL, NULL }
 };
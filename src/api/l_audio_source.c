@@ -25,6 +25,12 @@ static int l_lovrSourceGetCone(lua_State* L) {
   return 3;
 }
 
+static int l_lovrSourceGetDecodeTime(lua_State* L) {
+  Source* source = luax_checktype(L, 1, Source);
+  lua_pushnumber(L, lovrSourceGetDecodeTime(source));
+  return 1;
+}
+
 static int l_lovrSourceGetDuration(lua_State* L) {
   Source* source = luax_checktype(L, 1, Source);
   TimeUnit unit = luax_checkenum(L, 2, TimeUnit, "seconds");
@@ -92,6 +98,12 @@ static int l_lovrSourceGetPosition(lua_State* L) {
   return 3;
 }
 
+static int l_lovrSourceGetPriority(lua_State* L) {
+  Source* source = luax_checktype(L, 1, Source);
+  lua_pushnumber(L, lovrSourceGetPriority(source));
+  return 1;
+}
+
 static int l_lovrSourceGetSampleRate(lua_State* L) {
   Source* source = luax_checktype(L, 1, Source);
   lua_pushinteger(L, lovrSourceGetSampleRate(source));
@@ -151,7 +163,6 @@ static int l_lovrSourcePause(lua_State* L) {
 static int l_lovrSourcePlay(lua_State* L) {
   Source* source = luax_checktype(L, 1, Source);
   lovrSourcePlay(source);
-  lovrAudioAdd(source);
   return 0;
 }
 
@@ -225,6 +236,11 @@ static int l_lovrSourceSetPosition(lua_State* L) {
   return 0;
 }
 
+static int l_lovrSourceSetPriority(lua_State* L) {
+  lovrSourceSetPriority(luax_checktype(L, 1, Source), luax_checkfloat(L, 2));
+  return 0;
+}
+
 static int l_lovrSourceSetRelative(lua_State* L) {
   Source* source = luax_checktype(L, 1, Source);
   bool isRelative = lua_toboolean(L, 2);
@@ -273,12 +289,14 @@ const luaL_Reg lovrSource[] = {
   { "getBitDepth", l_lovrSourceGetBitDepth },
   { "getChannelCount", l_lovrSourceGetChannelCount },
   { "getCone", l_lovrSourceGetCone },
+  { "getDecodeTime", l_lovrSourceGetDecodeTime },
   { "getDuration", l_lovrSourceGetDuration },
   { "getFalloff", l_lovrSourceGetFalloff },
   { "getOrientation", l_lovrSourceGetOrientation },
   { "getPitch", l_lovrSourceGetPitch },
   { "getPose", l_lovrSourceGetPose },
   { "getPosition", l_lovrSourceGetPosition },
+  { "getPriority", l_lovrSourceGetPriority },
   { "getSampleRate", l_lovrSourceGetSampleRate },
   { "getType", l_lovrSourceGetType },
   { "getVelocity", l_lovrSourceGetVelocity },
@@ -297,6 +315,7 @@ const luaL_Reg lovrSource[] = {
   { "setPitch", l_lovrSourceSetPitch },
   { "setPose", l_lovrSourceSetPose },
   { "setPosition", l_lovrSourceSetPosition },
+  { "setPriority", l_lovrSourceSetPriority },
   { "setRelative", l_lovrSourceSetRelative },
   { "setVelocity", l_lovrSourceSetVelocity },
   { "setVolume", l_lovrSourceSetVolume },
@@ -46,7 +46,8 @@ static int l_lovrDataNewAudioStream(lua_State* L) {
     int sampleRate = lua_tonumber(L, 2);
     int bufferSize = luaL_optinteger(L, 3, 4096);
     int queueLimit = luaL_optinteger(L, 4, sampleRate*0.5);
-    stream = lovrAudioStreamCreateRaw(channelCount, sampleRate, bufferSize, queueLimit);
+    int bitDepth = luaL_optinteger(L, 5, 16);
+    stream = lovrAudioStreamCreateRaw(channelCount, sampleRate, bitDepth, bufferSize, queueLimit);
   } else {
     Blob* blob = luax_readblob(L, 1, "AudioStream");
     int bufferSize = luaL_optinteger(L, 2, 4096);
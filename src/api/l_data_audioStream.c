@@ -43,6 +43,27 @@ static int l_lovrAudioStreamGetSampleRate(lua_State* L) {
   return 1;
 }
 
+static int l_lovrAudioStreamGetQueueStats(lua_State* L) {
+  AudioStream* stream = luax_checktype(L, 1, AudioStream);
+  lovrAssert(lovrAudioStreamIsRaw(stream), "Only raw AudioStreams have a queue");
+  if (lua_gettop(L) > 1) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_settop(L, 2);
+  } else {
+    lua_createtable(L, 0, 4);
+  }
+
+  lua_pushinteger(L, lovrAudioStreamGetQueuedSamples(stream));
+  lua_setfield(L, -2, "queued");
+  lua_pushinteger(L, stream->queue.capacity / (stream->bitDepth / 8));
+  lua_setfield(L, -2, "capacity");
+  lua_pushinteger(L, stream->underruns);
+  lua_setfield(L, -2, "underruns");
+  lua_pushinteger(L, stream->overruns);
+  lua_setfield(L, -2, "overruns");
+  return 1;
+}
+
 static int l_lovrAudioStreamAppend(lua_State* L) {
   AudioStream* stream = luax_checktype(L, 1, AudioStream);
   Blob* blob = luax_totype(L, 2, Blob);
@@ -64,6 +85,7 @@ const luaL_Reg lovrAudioStream[] = {
   { "getChannelCount", l_lovrAudioStreamGetChannelCount },
   { "getDuration", l_lovrAudioStreamGetDuration },
   { "getSampleRate", l_lovrAudioStreamGetSampleRate },
+  { "getQueueStats", l_lovrAudioStreamGetQueueStats },
   { "append", l_lovrAudioStreamAppend},
   { NULL, NULL }
 };
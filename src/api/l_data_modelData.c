@@ -1,6 +1,32 @@
 #include "api.h"
 #include "data/modelData.h"
 
+static int l_lovrModelDataEncode(lua_State* L) {
+  ModelData* modelData = luax_checktype(L, 1, ModelData);
+  const char* filename = luaL_checkstring(L, 2);
+  bool success = lovrModelDataEncode(modelData, filename);
+  lua_pushboolean(L, success);
+  return 1;
+}
+
+static int l_lovrModelDataOptimize(lua_State* L) {
+  ModelData* modelData = luax_checktype(L, 1, ModelData);
+  bool quantize = lua_toboolean(L, 2);
+  lovrModelDataOptimize(modelData, quantize);
+  return 0;
+}
+
+static int l_lovrModelDataGenerateLods(lua_State* L) {
+  ModelData* modelData = luax_checktype(L, 1, ModelData);
+  uint32_t levels = luaL_optinteger(L, 2, MAX_LODS - 1);
+  float ratio = luax_optfloat(L, 3, .5f);
+  lovrModelDataGenerateLods(modelData, levels, ratio);
+  return 0;
+}
+
 const luaL_Reg lovrModelData[] = {
+  { "encode", l_lovrModelDataEncode },
+  { "optimize", l_lovrModelDataOptimize },
+  { "generateLods", l_lovrModelDataGenerateLods },
   { NULL, NULL }
 };
@@ -1,5 +1,25 @@
 #include "api.h"
 #include "data/soundData.h"
+#include "core/ref.h"
+#include <stdlib.h>
+
+static int l_lovrSoundDataApplyGain(lua_State* L) {
+  SoundData* soundData = luax_checktype(L, 1, SoundData);
+  float gain = luax_checkfloat(L, 2);
+  size_t offset = luaL_optinteger(L, 3, 0);
+  size_t count = lua_isnoneornil(L, 4) ? SIZE_MAX : (size_t) luaL_checkinteger(L, 4);
+  lovrSoundDataApplyGain(soundData, gain, offset, count);
+  return 0;
+}
+
+static int l_lovrSoundDataConvert(lua_State* L) {
+  SoundData* soundData = luax_checktype(L, 1, SoundData);
+  uint32_t bitDepth = luaL_checkinteger(L, 2);
+  SoundData* result = lovrSoundDataConvert(soundData, bitDepth);
+  luax_pushtype(L, SoundData, result);
+  lovrRelease(SoundData, result);
+  return 1;
+}
 
 static int l_lovrSoundDataGetBitDepth(lua_State* L) {
   SoundData* soundData = luax_checktype(L, 1, SoundData);
@@ -19,6 +39,23 @@ static int l_lovrSoundDataGetDuration(lua_State* L) {
   return 1;
 }
 
+static int l_lovrSoundDataGetLevels(lua_State* L) {
+  SoundData* soundData = luax_checktype(L, 1, SoundData);
+  size_t offset = luaL_optinteger(L, 2, 0);
+  size_t count = lua_isnoneornil(L, 3) ? SIZE_MAX : (size_t) luaL_checkinteger(L, 3);
+  float rms, peak;
+  lovrSoundDataGetLevels(soundData, offset, count, &rms, &peak);
+  lua_pushnumber(L, rms);
+  lua_pushnumber(L, peak);
+  return 2;
+}
+
+static int l_lovrSoundDataGetPointer(lua_State* L) {
+  SoundData* soundData = luax_checktype(L, 1, SoundData);
+  lua_pushlightuserdata(L, soundData->blob->data);
+  return 1;
+}
+
 static int l_lovrSoundDataGetSample(lua_State* L) {
   SoundData* soundData = luax_checktype(L, 1, SoundData);
   int index = luaL_checkinteger(L, 2);
@@ -38,6 +75,50 @@ static int l_lovrSoundDataGetSampleRate(lua_State* L) {
   return 1;
 }
 
+static int l_lovrSoundDataGetSpectrum(lua_State* L) {
+  SoundData* soundData = luax_checktype(L, 1, SoundData);
+  uint32_t size = luaL_optinteger(L, 2, 1024);
+  size_t offset = luaL_optinteger(L, 3, 0);
+  lovrAssert(size >= 2 && (size & (size - 1)) == 0, "Spectrum size must be a power of 2");
+
+  if (lua_istable(L, 4)) {
+    lua_settop(L, 4);
+  } else {
+    lua_settop(L, 3);
+    lua_createtable(L, size / 2, 0);
+  }
+
+  // Userdata, so it's collected if the offset is out of range
+  float* magnitudes = lua_newuserdata(L, size / 2 * sizeof(float));
+  lovrSoundDataGetSpectrum(soundData, offset, size, magnitudes);
+
+  for (uint32_t i = 0; i < size / 2; i++) {
+    lua_pushnumber(L, magnitudes[i]);
+    lua_rawseti(L, -3, i + 1);
+  }
+
+  lua_pop(L, 1);
+  return 1;
+}
+
+static int l_lovrSoundDataMix(lua_State* L) {
+  SoundData* soundData = luax_checktype(L, 1, SoundData);
+  SoundData* source = luax_checktype(L, 2, SoundData);
+  float gain = luax_optfloat(L, 3, 1.f);
+  size_t offset = luaL_optinteger(L, 4, 0);
+  lovrSoundDataMix(soundData, source, gain, offset);
+  return 0;
+}
+
+static int l_lovrSoundDataResample(lua_State* L) {
+  SoundData* soundData = luax_checktype(L, 1, SoundData);
+  uint32_t sampleRate = luaL_checkinteger(L, 2);
+  SoundData* result = lovrSoundDataResample(soundData, sampleRate);
+  luax_pushtype(L, SoundData, result);
+  lovrRelease(SoundData, result);
+  return 1;
+}
+
 static int l_lovrSoundDataSetSample(lua_State* L) {
   SoundData* soundData = luax_checktype(L, 1, SoundData);
   int index = luaL_checkinteger(L, 2);
@@ -54,12 +135,19 @@ static int l_lovrSoundDataGetBlob(lua_State* L) {
 }
 
 const luaL_Reg lovrSoundData[] = {
+  { "applyGain", l_lovrSoundDataApplyGain },
+  { "convert", l_lovrSoundDataConvert },
   { "getBitDepth", l_lovrSoundDataGetBitDepth },
   { "getChannelCount", l_lovrSoundDataGetChannelCount },
   { "getDuration", l_lovrSoundDataGetDuration },
+  { "getLevels", l_lovrSoundDataGetLevels },
+  { "getPointer", l_lovrSoundDataGetPointer },
   { "getSample", l_lovrSoundDataGetSample },
   { "getSampleCount", l_lovrSoundDataGetSampleCount },
   { "getSampleRate", l_lovrSoundDataGetSampleRate },
+  { "getSpectrum", l_lovrSoundDataGetSpectrum },
+  { "mix", l_lovrSoundDataMix },
+  { "resample", l_lovrSoundDataResample },
   { "setSample", l_lovrSoundDataSetSample },
   { "getBlob", l_lovrSoundDataGetBlob },
   { NULL, NULL }
@@ -1434,6 +1434,31 @@ static int l_lovrGraphicsNewModel(lua_State* L) {
     Blob* blob = luax_readblob(L, 1, "Model");
     modelData = lovrModelDataCreate(blob, luax_readfile);
     lovrRelease(Blob, blob);
+
+    if (lua_istable(L, 2)) {
+      bool optimize = false;
+      bool quantize = false;
+
+      lua_getfield(L, 2, "optimize");
+      optimize = lua_isnil(L, -1) ? optimize : lua_toboolean(L, -1);
+      lua_pop(L, 1);
+
+      lua_getfield(L, 2, "quantize");
+      quantize = lua_isnil(L, -1) ? quantize : lua_toboolean(L, -1);
+      lua_pop(L, 1);
+
+      if (optimize || quantize) {
+        lovrModelDataOptimize(modelData, quantize);
+      }
+
+      lua_getfield(L, 2, "lods");
+      uint32_t lods = luaL_optinteger(L, -1, 0);
+      lua_pop(L, 1);
+
+      if (lods > 0) {
+        lovrModelDataGenerateLods(modelData, lods, .5f);
+      }
+    }
   } else {
     lovrRetain(modelData);
   }
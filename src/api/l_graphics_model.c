@@ -198,6 +198,19 @@ static int l_lovrModelHasJoints(lua_State* L) {
   return 1;
 }
 
+static int l_lovrModelGetLodThreshold(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  lua_pushnumber(L, lovrModelGetLodThreshold(model));
+  return 1;
+}
+
+static int l_lovrModelSetLodThreshold(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  float threshold = luax_checkfloat(L, 2);
+  lovrModelSetLodThreshold(model, threshold);
+  return 0;
+}
+
 const luaL_Reg lovrModel[] = {
   { "draw", l_lovrModelDraw },
   { "animate", l_lovrModelAnimate },
@@ -213,5 +226,7 @@ const luaL_Reg lovrModel[] = {
   { "getNodeCount", l_lovrModelGetNodeCount },
   { "getAnimationDuration", l_lovrModelGetAnimationDuration },
   { "hasJoints", l_lovrModelHasJoints },
+  { "getLodThreshold", l_lovrModelGetLodThreshold },
+  { "setLodThreshold", l_lovrModelSetLodThreshold },
   { NULL, NULL }
 };
@@ -2,6 +2,13 @@
 #include "physics/physics.h"
 #include "core/ref.h"
 
+StringEntry lovrBroadPhase[] = {
+  [BROADPHASE_HASH] = ENTRY("hash"),
+  [BROADPHASE_SAP] = ENTRY("sap"),
+  [BROADPHASE_QUADTREE] = ENTRY("quadtree"),
+  { 0 }
+};
+
 StringEntry lovrShapeType[] = {
   [SHAPE_SPHERE] = ENTRY("sphere"),
   [SHAPE_BOX] = ENTRY("box"),
@@ -11,6 +18,13 @@ StringEntry lovrShapeType[] = {
   { 0 }
 };
 
+StringEntry lovrContactEventType[] = {
+  [CONTACT_BEGIN] = ENTRY("begin"),
+  [CONTACT_PERSIST] = ENTRY("persist"),
+  [CONTACT_END] = ENTRY("end"),
+  { 0 }
+};
+
 StringEntry lovrJointType[] = {
   [JOINT_BALL] = ENTRY("ball"),
   [JOINT_DISTANCE] = ENTRY("distance"),
@@ -29,7 +43,7 @@ static int l_lovrPhysicsNewWorld(lua_State* L) {
   if (lua_type(L, 5) == LUA_TTABLE) {
     tagCount = luax_len(L, 5);
     for (int i = 0; i < tagCount; i++) {
-      lua_rawgeti(L, -1, i + 1);
+      lua_rawgeti(L, 5, i + 1);
       if (lua_isstring(L, -1)) {
         tags[i] = lua_tostring(L, -1);
       } else {
@@ -40,7 +54,64 @@ static int l_lovrPhysicsNewWorld(lua_State* L) {
   } else {
     tagCount = 0;
   }
-  World* world = lovrWorldCreate(xg, yg, zg, allowSleep, tags, tagCount);
+
+  WorldInfo info = {
+    .threads = 1,
+    .hashLevels = { -4, 8 },
+    .extents = { 1000.f, 1000.f, 1000.f },
+    .depth = 8
+  };
+
+  if (lua_istable(L, 6)) {
+    lua_getfield(L, 6, "threads");
+    lua_Integer threads = luaL_optinteger(L, -1, info.threads);
+    info.threads = (uint32_t) CLAMP(threads, 1, MAX_WORLD_THREADS);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 6, "broadphase");
+    info.broadphase = luax_checkenum(L, -1, BroadPhase, "hash");
+    lua_pop(L, 1);
+
+    lua_getfield(L, 6, "static");
+    info.staticSpace = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 6, "levels");
+    if (lua_istable(L, -1)) {
+      lua_rawgeti(L, -1, 1);
+      lua_rawgeti(L, -2, 2);
+      info.hashLevels[0] = luaL_optinteger(L, -2, info.hashLevels[0]);
+      info.hashLevels[1] = luaL_optinteger(L, -1, info.hashLevels[1]);
+      lua_pop(L, 2);
+    }
+    lua_pop(L, 1);
+
+    lua_getfield(L, 6, "center");
+    if (lua_istable(L, -1)) {
+      for (int i = 0; i < 3; i++) {
+        lua_rawgeti(L, -1, i + 1);
+        info.center[i] = luax_optfloat(L, -1, info.center[i]);
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+
+    lua_getfield(L, 6, "extents");
+    if (lua_istable(L, -1)) {
+      for (int i = 0; i < 3; i++) {
+        lua_rawgeti(L, -1, i + 1);
+        info.extents[i] = luax_optfloat(L, -1, info.extents[i]);
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+
+    lua_getfield(L, 6, "depth");
+    info.depth = luaL_optinteger(L, -1, info.depth);
+    lua_pop(L, 1);
+  }
+
+  World* world = lovrWorldCreate(xg, yg, zg, allowSleep, tags, tagCount, &info);
   luax_pushtype(L, World, world);
   lovrRelease(World, world);
   return 1;
@@ -109,6 +180,13 @@ static int l_lovrPhysicsNewHingeJoint(lua_State* L) {
   return 1;
 }
 
+static int l_lovrPhysicsNewMeshShape(lua_State* L) {
+  MeshShape* mesh = luax_newmeshshape(L, 1);
+  luax_pushtype(L, MeshShape, mesh);
+  lovrRelease(Shape, mesh);
+  return 1;
+}
+
 static int l_lovrPhysicsNewSliderJoint(lua_State* L) {
   Collider* a = luax_checktype(L, 1, Collider);
   Collider* b = luax_checktype(L, 2, Collider);
@@ -136,6 +214,7 @@ static const luaL_Reg lovrPhysics[] = {
   { "newCylinderShape", l_lovrPhysicsNewCylinderShape },
   { "newDistanceJoint", l_lovrPhysicsNewDistanceJoint },
   { "newHingeJoint", l_lovrPhysicsNewHingeJoint },
+  { "newMeshShape", l_lovrPhysicsNewMeshShape },
   { "newSliderJoint", l_lovrPhysicsNewSliderJoint },
   { "newSphereShape", l_lovrPhysicsNewSphereShape },
   { NULL, NULL }
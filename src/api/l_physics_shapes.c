@@ -1,5 +1,8 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "data/modelData.h"
+#include "core/ref.h"
+#include <stdlib.h>
 
 void luax_pushshape(lua_State* L, Shape* shape) {
   switch (shape->type) {
@@ -35,6 +38,80 @@ Shape* luax_checkshape(lua_State* L, int index) {
   return NULL;
 }
 
+// Accepts a ModelData with an optional node index or name, or tables of vertices and indices
+Shape* luax_newmeshshape(lua_State* L, int index) {
+  TriMeshData* data;
+  ModelData* model = luax_totype(L, index, ModelData);
+
+  if (model) {
+    uint32_t node = ALL_NODES;
+    switch (lua_type(L, index + 1)) {
+      case LUA_TNONE:
+      case LUA_TNIL:
+        break;
+      case LUA_TNUMBER: {
+        lua_Integer n = lua_tointeger(L, index + 1);
+        lovrAssert(n >= 1 && n <= model->nodeCount, "Invalid node index '%d' (ModelData has %d nodes)", (int) n, model->nodeCount);
+        node = (uint32_t) n - 1;
+        break;
+      }
+      case LUA_TSTRING: {
+        size_t length;
+        const char* name = lua_tolstring(L, index + 1, &length);
+        uint64_t nodeIndex = map_get(&model->nodeMap, hash64(name, length));
+        lovrAssert(nodeIndex != MAP_NIL, "ModelData has no node named '%s'", name);
+        node = (uint32_t) nodeIndex;
+        break;
+      }
+      default:
+        luax_typeerror(L, index + 1, "number or string");
+        return NULL;
+    }
+    data = lovrTriMeshDataCreateFromModel(model, node);
+  } else {
+    lovrAssert(lua_istable(L, index), "Vertices must be a table");
+    lovrAssert(lua_istable(L, index + 1), "Indices must be a table");
+    uint32_t vertexCount = luax_len(L, index);
+    uint32_t indexCount = luax_len(L, index + 1);
+
+    // Parsing can throw, so the tables are read into userdata and only copied once they're valid
+    float* vertices = lua_newuserdata(L, 3 * vertexCount * sizeof(float));
+    dTriIndex* indices = lua_newuserdata(L, indexCount * sizeof(dTriIndex));
+
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      lua_rawgeti(L, index, i + 1);
+      lovrAssert(lua_istable(L, -1), "Each vertex must be a table of coordinates");
+      for (int j = 0; j < 3; j++) {
+        lua_rawgeti(L, -1, j + 1);
+        vertices[3 * i + j] = luax_optfloat(L, -1, 0.f);
+        lua_pop(L, 1);
+      }
+      lua_pop(L, 1);
+    }
+
+    for (uint32_t i = 0; i < indexCount; i++) {
+      lua_rawgeti(L, index + 1, i + 1);
+      uint32_t vertex = luaL_checkinteger(L, -1) - 1;
+      lovrAssert(vertex < vertexCount, "Invalid vertex index %d", vertex + 1);
+      indices[i] = vertex;
+      lua_pop(L, 1);
+    }
+
+    indexCount -= indexCount % 3;
+    float* ownedVertices = malloc(3 * vertexCount * sizeof(float));
+    dTriIndex* ownedIndices = malloc(indexCount * sizeof(dTriIndex));
+    lovrAssert(ownedVertices && ownedIndices, "Out of memory");
+    memcpy(ownedVertices, vertices, 3 * vertexCount * sizeof(float));
+    memcpy(ownedIndices, indices, indexCount * sizeof(dTriIndex));
+    lua_pop(L, 2);
+    data = lovrTriMeshDataCreate(vertexCount, ownedVertices, indexCount, ownedIndices);
+  }
+
+  MeshShape* mesh = lovrMeshShapeCreate(data);
+  lovrRelease(TriMeshData, data);
+  return mesh;
+}
+
 static int l_lovrShapeDestroy(lua_State* L) {
   Shape* shape = luax_checkshape(L, 1);
   lovrShapeDestroyData(shape);
@@ -1,7 +1,9 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "data/blob.h"
 #include "core/ref.h"
 #include <stdbool.h>
+#include <stdlib.h>
 
 static void collisionResolver(World* world, void* userdata) {
   lua_State* L = userdata;
@@ -38,6 +40,21 @@ static void raycastCallback(Shape* shape, float x, float y, float z, float nx, f
   lua_call(L, 7, 0);
 }
 
+// Floats can come from a Blob or a raw pointer (e.g. from the FFI), the count is required for pointers
+static float* luax_checkfloats(lua_State* L, int index, size_t* count) {
+  Blob* blob = luax_totype(L, index, Blob);
+  if (blob) {
+    *count = blob->size / sizeof(float);
+    return blob->data;
+  } else if (lua_type(L, index) == LUA_TLIGHTUSERDATA) {
+    *count = SIZE_MAX;
+    return lua_touserdata(L, index);
+  } else {
+    luax_typeerror(L, index, "Blob or pointer");
+    return NULL;
+  }
+}
+
 static int l_lovrWorldNewCollider(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   float position[4];
@@ -112,34 +129,8 @@ static int l_lovrWorldNewSphereCollider(lua_State* L) {
 
 static int l_lovrWorldNewMeshCollider(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
-  lovrAssert(lua_istable(L, 2), "Vertices must be a table");
-  lovrAssert(lua_istable(L, 3), "Indices must be a table");
-  int vertexCount = luax_len(L, 2);
-  int indexCount  = luax_len(L, 3);
-  // TODO: this never gets deallocated
-  float    * vertices = malloc(sizeof(float) * vertexCount * 3);
-  unsigned * indices  = malloc(sizeof(unsigned) * indexCount);
-
-  for (int i = 0; i < vertexCount; i++) {
-    lua_rawgeti(L, 2, i + 1);
-    lovrAssert(lua_istable(L, -1), "Each verticle must be a table of coordinates");
-    lua_rawgeti(L, -1, 1); // x
-    vertices[i * 3 + 0] = luaL_optnumber(L, -1, 0.);
-    lua_pop(L, 1);
-    lua_rawgeti(L, -1, 2); // y
-    vertices[i * 3 + 1] = luaL_optnumber(L, -1, 0.);
-    lua_pop(L, 1);
-    lua_rawgeti(L, -1, 3); // z
-    vertices[i * 3 + 2] = luaL_optnumber(L, -1, 0.);
-    lua_pop(L, 2);
-  }
-  for (int i = 0; i < indexCount; i++) {
-    lua_rawgeti(L, 3, i + 1);
-    indices[i] = luaL_checkinteger(L, -1) - 1;
-  }
-  lua_pop(L, indexCount);
-  Collider* collider = lovrColliderCreate(world, 0,0,0);
-  MeshShape* shape = lovrMeshShapeCreate(vertexCount, vertices, indexCount, indices);
+  MeshShape* shape = luax_newmeshshape(L, 2);
+  Collider* collider = lovrColliderCreate(world, 0, 0, 0);
   lovrColliderAddShape(collider, shape);
   lovrColliderInitInertia(collider, shape);
   luax_pushtype(L, Collider, collider);
@@ -169,6 +160,60 @@ static int l_lovrWorldGetColliders(lua_State* L) {
   return 1;
 }
 
+static int l_lovrWorldGetColliderStates(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  size_t capacity;
+  float* data = luax_checkfloats(L, 2, &capacity);
+  const char* tag = luaL_optstring(L, 4, NULL);
+  bool pointer = capacity == SIZE_MAX;
+  lua_Integer limit = pointer ? luaL_checkinteger(L, 3) : luaL_optinteger(L, 3, capacity / COLLIDER_STATE_SIZE);
+  lovrAssert(limit >= 0 && (size_t) limit <= capacity / COLLIDER_STATE_SIZE, "Not enough space in the output for %d states", (int) limit);
+
+  // Userdata, so it's collected if the tag is unknown
+  Collider** colliders = NULL;
+  if (lua_istable(L, 5)) {
+    colliders = lua_newuserdata(L, limit * sizeof(Collider*));
+  }
+
+  bool interpolate = lua_toboolean(L, 6);
+  uint32_t count = lovrWorldGetColliderStates(world, tag, data, (uint32_t) limit, colliders, interpolate);
+  uint32_t written = MIN(count, (uint32_t) limit);
+
+  if (colliders) {
+    for (uint32_t i = 0; i < written; i++) {
+      luax_pushtype(L, Collider, colliders[i]);
+      lua_rawseti(L, 5, i + 1);
+    }
+    lua_pop(L, 1);
+
+    // Clear leftovers from the last time the table was used
+    for (uint32_t i = written + 1;; i++) {
+      lua_rawgeti(L, 5, i);
+      bool empty = lua_isnil(L, -1);
+      lua_pop(L, 1);
+      if (empty) break;
+      lua_pushnil(L);
+      lua_rawseti(L, 5, i);
+    }
+  }
+
+  lua_pushinteger(L, written);
+  lua_pushinteger(L, count);
+  return 2;
+}
+
+static int l_lovrWorldSetColliderStates(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  size_t capacity;
+  const float* data = luax_checkfloats(L, 2, &capacity);
+  const char* tag = luaL_optstring(L, 4, NULL);
+  bool pointer = capacity == SIZE_MAX;
+  lua_Integer count = pointer ? luaL_checkinteger(L, 3) : luaL_optinteger(L, 3, capacity / COLLIDER_STATE_SIZE);
+  lovrAssert(count >= 0 && (size_t) count <= capacity / COLLIDER_STATE_SIZE, "Not enough states in the input (expected %d)", (int) count);
+  lua_pushinteger(L, lovrWorldSetColliderStates(world, tag, data, (uint32_t) count));
+  return 1;
+}
+
 static int l_lovrWorldDestroy(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   lovrWorldDestroyData(world);
@@ -184,6 +229,69 @@ static int l_lovrWorldUpdate(lua_State* L) {
   return 0;
 }
 
+static int l_lovrWorldGetStepRate(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t maxSubsteps;
+  float rate = lovrWorldGetStepRate(world, &maxSubsteps);
+  lua_pushnumber(L, rate);
+  lua_pushinteger(L, maxSubsteps);
+  return 2;
+}
+
+static int l_lovrWorldSetStepRate(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  float rate = luax_optfloat(L, 2, 0.f);
+  lua_Integer maxSubsteps = luaL_optinteger(L, 3, 4);
+  lovrWorldSetStepRate(world, rate, (uint32_t) MAX(maxSubsteps, 1));
+  return 0;
+}
+
+static int l_lovrWorldGetInterpolation(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lua_pushnumber(L, lovrWorldGetInterpolation(world));
+  return 1;
+}
+
+static int l_lovrWorldIsDeterministic(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lua_pushboolean(L, lovrWorldIsDeterministic(world));
+  return 1;
+}
+
+static int l_lovrWorldSetDeterministic(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lovrWorldSetDeterministic(world, lua_toboolean(L, 2));
+  return 0;
+}
+
+// Passing in a Blob from an earlier snapshot reuses it if it's the right size
+static int l_lovrWorldSaveSnapshot(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  Blob* blob = luax_totype(L, 2, Blob);
+  size_t size = lovrWorldGetSnapshotSize(world);
+
+  if (blob && blob->size == size) {
+    lovrWorldSaveSnapshot(world, blob->data);
+    lua_settop(L, 2);
+    return 1;
+  }
+
+  void* data = malloc(size);
+  lovrAssert(data, "Out of memory");
+  lovrWorldSaveSnapshot(world, data);
+  blob = lovrBlobCreate(data, size, "World snapshot");
+  luax_pushtype(L, Blob, blob);
+  lovrRelease(Blob, blob);
+  return 1;
+}
+
+static int l_lovrWorldRestoreSnapshot(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  Blob* blob = luax_checktype(L, 2, Blob);
+  lovrWorldRestoreSnapshot(world, blob->data, blob->size);
+  return 0;
+}
+
 static int l_lovrWorldComputeOverlaps(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   lovrWorldComputeOverlaps(world);
@@ -197,6 +305,30 @@ static int l_lovrWorldOverlaps(lua_State* L) {
   return 1;
 }
 
+static int l_lovrWorldGetStats(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  const WorldStats* stats = lovrWorldGetStats(world);
+
+  if (lua_gettop(L) > 1) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_settop(L, 2);
+  } else {
+    lua_createtable(L, 0, 5);
+  }
+
+  lua_pushnumber(L, stats->collideTime);
+  lua_setfield(L, -2, "collidetime");
+  lua_pushnumber(L, stats->stepTime);
+  lua_setfield(L, -2, "steptime");
+  lua_pushinteger(L, stats->pairs);
+  lua_setfield(L, -2, "pairs");
+  lua_pushinteger(L, stats->contacts);
+  lua_setfield(L, -2, "contacts");
+  lua_pushinteger(L, stats->threads);
+  lua_setfield(L, -2, "threads");
+  return 1;
+}
+
 static int l_lovrWorldCollide(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   Shape* a = luax_checkshape(L, 2);
@@ -314,6 +446,280 @@ static int l_lovrWorldRaycast(lua_State* L) {
   return 0;
 }
 
+static int luax_pushraycasthit(lua_State* L, bool found, RaycastHit* hit) {
+  if (!found) {
+    lua_pushnil(L);
+    return 1;
+  }
+
+  luax_pushshape(L, hit->shape);
+  lua_pushnumber(L, hit->position[0]);
+  lua_pushnumber(L, hit->position[1]);
+  lua_pushnumber(L, hit->position[2]);
+  lua_pushnumber(L, hit->normal[0]);
+  lua_pushnumber(L, hit->normal[1]);
+  lua_pushnumber(L, hit->normal[2]);
+  lua_pushnumber(L, hit->distance);
+  return 8;
+}
+
+static int l_lovrWorldRaycastClosest(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  float start[4], end[4];
+  int index = luax_readvec3(L, 2, start, NULL);
+  luax_readvec3(L, index, end, NULL);
+  RaycastHit hit;
+  bool found = lovrWorldRaycastClosest(world, start[0], start[1], start[2], end[0], end[1], end[2], &hit);
+  return luax_pushraycasthit(L, found, &hit);
+}
+
+static int l_lovrWorldRaycastAny(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  float start[4], end[4];
+  int index = luax_readvec3(L, 2, start, NULL);
+  luax_readvec3(L, index, end, NULL);
+  RaycastHit hit;
+  bool found = lovrWorldRaycastAny(world, start[0], start[1], start[2], end[0], end[1], end[2], &hit);
+  return luax_pushraycasthit(L, found, &hit);
+}
+
+static int l_lovrWorldRaycastBatch(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  size_t rayCapacity, resultCapacity;
+  const float* rays = luax_checkfloats(L, 2, &rayCapacity);
+  float* results = luax_checkfloats(L, 3, &resultCapacity);
+  bool pointer = rayCapacity == SIZE_MAX || resultCapacity == SIZE_MAX;
+  lua_Integer count = pointer ? luaL_checkinteger(L, 4) : luaL_optinteger(L, 4, MIN(rayCapacity / 6, resultCapacity / 8));
+  lua_Integer workers = luaL_optinteger(L, 5, 1);
+  bool shapes = lua_istable(L, 6);
+  lovrAssert(count >= 0 && count <= UINT32_MAX, "Ray count must be between 0 and 2^32 - 1");
+  lovrAssert((size_t) count <= rayCapacity / 6, "Not enough rays in the input (expected %d)", (int) count);
+  lovrAssert((size_t) count <= resultCapacity / 8, "Not enough space in the output for %d results", (int) count);
+
+  // The hits are a userdata so they get collected if the batch throws
+  RaycastHit* hits = lua_newuserdata(L, count * sizeof(RaycastHit));
+  uint32_t hitCount = lovrWorldRaycastBatch(world, rays, (uint32_t) count, hits, (uint32_t) CLAMP(workers, 1, MAX_RAYCAST_WORKERS));
+
+  // Each result is x, y, z, nx, ny, nz, distance, hit
+  for (uint32_t i = 0; i < count; i++) {
+    RaycastHit* hit = &hits[i];
+    float* result = results + 8 * i;
+    if (hit->shape) {
+      memcpy(result, hit->position, 3 * sizeof(float));
+      memcpy(result + 3, hit->normal, 3 * sizeof(float));
+      result[6] = hit->distance;
+      result[7] = 1.f;
+    } else {
+      memset(result, 0, 8 * sizeof(float));
+    }
+
+    if (shapes) {
+      if (hit->shape) {
+        luax_pushshape(L, hit->shape);
+      } else {
+        lua_pushboolean(L, false);
+      }
+      lua_rawseti(L, 6, i + 1);
+    }
+  }
+
+  lua_pop(L, 1);
+  lua_pushinteger(L, hitCount);
+  return 1;
+}
+
+// Shared by the query functions, a NULL shape queries a point.  Returns the count and the table.
+static int luax_queryshapes(lua_State* L, World* world, QueryShape* shape, float position[3], int index) {
+  const char* tag = luaL_optstring(L, index, NULL);
+  Shape* stack[64];
+  Shape** shapes = stack;
+  uint32_t capacity = sizeof(stack) / sizeof(stack[0]);
+  uint32_t count;
+
+  for (;;) {
+    if (shape) {
+      count = lovrWorldQueryShape(world, shape, position[0], position[1], position[2], tag, shapes, capacity);
+    } else {
+      count = lovrWorldQueryPoint(world, position[0], position[1], position[2], tag, shapes, capacity);
+    }
+
+    if (count <= capacity) {
+      break;
+    }
+
+    if (shapes != stack) free(shapes);
+    capacity = count;
+    shapes = malloc(capacity * sizeof(Shape*));
+    lovrAssert(shapes, "Out of memory");
+  }
+
+  if (lua_istable(L, index + 1)) {
+    lua_settop(L, index + 1);
+  } else {
+    lua_settop(L, index);
+    lua_createtable(L, count, 0);
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    luax_pushshape(L, shapes[i]);
+    lua_rawseti(L, -2, i + 1);
+  }
+
+  // Clear leftovers from the last time the table was used
+  for (int i = count + 1;; i++) {
+    lua_rawgeti(L, -1, i);
+    bool empty = lua_isnil(L, -1);
+    lua_pop(L, 1);
+    if (empty) break;
+    lua_pushnil(L);
+    lua_rawseti(L, -2, i);
+  }
+
+  if (shapes != stack) free(shapes);
+  lua_pushinteger(L, count);
+  lua_insert(L, -2);
+  return 2;
+}
+
+static int l_lovrWorldQueryPoint(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  float position[4];
+  int index = luax_readvec3(L, 2, position, NULL);
+  return luax_queryshapes(L, world, NULL, position, index);
+}
+
+static int l_lovrWorldQuerySphere(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  QueryShape shape = { .type = SHAPE_SPHERE, .orientation = { 0.f, 0.f, 0.f, 1.f } };
+  float position[4];
+  int index = luax_readvec3(L, 2, position, NULL);
+  shape.size[0] = luax_optfloat(L, index++, 1.f);
+  return luax_queryshapes(L, world, &shape, position, index);
+}
+
+static int l_lovrWorldQueryBox(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  QueryShape shape = { .type = SHAPE_BOX };
+  float position[4];
+  int index = luax_readvec3(L, 2, position, NULL);
+  index = luax_readscale(L, index, shape.size, 3, NULL);
+  index = luax_readquat(L, index, shape.orientation, NULL);
+  return luax_queryshapes(L, world, &shape, position, index);
+}
+
+static int l_lovrWorldQueryCapsule(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  QueryShape shape = { .type = SHAPE_CAPSULE };
+  float position[4];
+  int index = luax_readvec3(L, 2, position, NULL);
+  shape.size[0] = luax_optfloat(L, index++, 1.f);
+  shape.size[1] = luax_optfloat(L, index++, 1.f);
+  index = luax_readquat(L, index, shape.orientation, NULL);
+  return luax_queryshapes(L, world, &shape, position, index);
+}
+
+static int l_lovrWorldSweepSphere(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  QueryShape shape = { .type = SHAPE_SPHERE, .orientation = { 0.f, 0.f, 0.f, 1.f } };
+  float start[4], end[4];
+  int index = luax_readvec3(L, 2, start, NULL);
+  index = luax_readvec3(L, index, end, NULL);
+  shape.size[0] = luax_optfloat(L, index++, 1.f);
+  const char* tag = luaL_optstring(L, index, NULL);
+  RaycastHit hit;
+  bool found = lovrWorldSweep(world, &shape, start[0], start[1], start[2], end[0], end[1], end[2], tag, &hit);
+  return luax_pushraycasthit(L, found, &hit);
+}
+
+static int l_lovrWorldSweepBox(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  QueryShape shape = { .type = SHAPE_BOX };
+  float start[4], end[4];
+  int index = luax_readvec3(L, 2, start, NULL);
+  index = luax_readvec3(L, index, end, NULL);
+  index = luax_readscale(L, index, shape.size, 3, NULL);
+  index = luax_readquat(L, index, shape.orientation, NULL);
+  const char* tag = luaL_optstring(L, index, NULL);
+  RaycastHit hit;
+  bool found = lovrWorldSweep(world, &shape, start[0], start[1], start[2], end[0], end[1], end[2], tag, &hit);
+  return luax_pushraycasthit(L, found, &hit);
+}
+
+static int l_lovrWorldSweepCapsule(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  QueryShape shape = { .type = SHAPE_CAPSULE };
+  float start[4], end[4];
+  int index = luax_readvec3(L, 2, start, NULL);
+  index = luax_readvec3(L, index, end, NULL);
+  shape.size[0] = luax_optfloat(L, index++, 1.f);
+  shape.size[1] = luax_optfloat(L, index++, 1.f);
+  index = luax_readquat(L, index, shape.orientation, NULL);
+  const char* tag = luaL_optstring(L, index, NULL);
+  RaycastHit hit;
+  bool found = lovrWorldSweep(world, &shape, start[0], start[1], start[2], end[0], end[1], end[2], tag, &hit);
+  return luax_pushraycasthit(L, found, &hit);
+}
+
+static int l_lovrWorldIsContactEventsEnabled(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lua_pushboolean(L, lovrWorldIsContactEventsEnabled(world));
+  return 1;
+}
+
+static int l_lovrWorldSetContactEventsEnabled(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  lovrWorldSetContactEventsEnabled(world, lua_toboolean(L, 2));
+  return 0;
+}
+
+static int l_lovrWorldSetContactEventsBetween(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  const char* tag1 = luaL_checkstring(L, 2);
+  const char* tag2 = luaL_checkstring(L, 3);
+  bool enabled = lua_isnoneornil(L, 4) || lua_toboolean(L, 4);
+  lovrWorldSetContactEventsBetween(world, tag1, tag2, enabled);
+  return 0;
+}
+
+static int l_lovrWorldSetContactRule(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  const char* tag1 = luaL_checkstring(L, 2);
+  const char* tag2 = luaL_checkstring(L, 3);
+  float friction = luax_optfloat(L, 4, -1.f);
+  float restitution = luax_optfloat(L, 5, -1.f);
+  lovrWorldSetContactRule(world, tag1, tag2, friction, restitution);
+  return 0;
+}
+
+static int l_lovrWorldGetContactEventCount(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t count;
+  lovrWorldGetContactEvents(world, &count);
+  lua_pushinteger(L, count);
+  return 1;
+}
+
+static int l_lovrWorldGetContactEvent(lua_State* L) {
+  World* world = luax_checktype(L, 1, World);
+  uint32_t count;
+  ContactEvent* events = lovrWorldGetContactEvents(world, &count);
+  lua_Integer index = luaL_checkinteger(L, 2);
+  luaL_argcheck(L, index >= 1 && index <= count, 2, "Invalid contact event index");
+  ContactEvent* event = &events[index - 1];
+  luax_pushenum(L, ContactEventType, event->type);
+  luax_pushshape(L, event->a);
+  luax_pushshape(L, event->b);
+  lua_pushnumber(L, event->position[0]);
+  lua_pushnumber(L, event->position[1]);
+  lua_pushnumber(L, event->position[2]);
+  lua_pushnumber(L, event->normal[0]);
+  lua_pushnumber(L, event->normal[1]);
+  lua_pushnumber(L, event->normal[2]);
+  lua_pushnumber(L, event->depth);
+  lua_pushnumber(L, event->impulse);
+  return 11;
+}
+
 static int l_lovrWorldDisableCollisionBetween(lua_State* L) {
   World* world = luax_checktype(L, 1, World);
   const char* tag1 = luaL_checkstring(L, 2);
@@ -346,11 +752,21 @@ const luaL_Reg lovrWorld[] = {
   { "newSphereCollider", l_lovrWorldNewSphereCollider },
   { "newMeshCollider", l_lovrWorldNewMeshCollider },
   { "getColliders", l_lovrWorldGetColliders },
+  { "getColliderStates", l_lovrWorldGetColliderStates },
+  { "setColliderStates", l_lovrWorldSetColliderStates },
   { "destroy", l_lovrWorldDestroy },
   { "update", l_lovrWorldUpdate },
+  { "getStepRate", l_lovrWorldGetStepRate },
+  { "setStepRate", l_lovrWorldSetStepRate },
+  { "getInterpolation", l_lovrWorldGetInterpolation },
+  { "isDeterministic", l_lovrWorldIsDeterministic },
+  { "setDeterministic", l_lovrWorldSetDeterministic },
+  { "saveSnapshot", l_lovrWorldSaveSnapshot },
+  { "restoreSnapshot", l_lovrWorldRestoreSnapshot },
   { "computeOverlaps", l_lovrWorldComputeOverlaps },
   { "overlaps", l_lovrWorldOverlaps },
   { "collide", l_lovrWorldCollide },
+  { "getStats", l_lovrWorldGetStats },
   { "getGravity", l_lovrWorldGetGravity },
   { "setGravity", l_lovrWorldSetGravity },
   { "getTightness", l_lovrWorldGetTightness },
@@ -364,6 +780,22 @@ const luaL_Reg lovrWorld[] = {
   { "isSleepingAllowed", l_lovrWorldIsSleepingAllowed },
   { "setSleepingAllowed", l_lovrWorldSetSleepingAllowed },
   { "raycast", l_lovrWorldRaycast },
+  { "raycastClosest", l_lovrWorldRaycastClosest },
+  { "raycastAny", l_lovrWorldRaycastAny },
+  { "raycastBatch", l_lovrWorldRaycastBatch },
+  { "queryPoint", l_lovrWorldQueryPoint },
+  { "querySphere", l_lovrWorldQuerySphere },
+  { "queryBox", l_lovrWorldQueryBox },
+  { "queryCapsule", l_lovrWorldQueryCapsule },
+  { "sweepSphere", l_lovrWorldSweepSphere },
+  { "sweepBox", l_lovrWorldSweepBox },
+  { "sweepCapsule", l_lovrWorldSweepCapsule },
+  { "isContactEventsEnabled", l_lovrWorldIsContactEventsEnabled },
+  { "setContactEventsEnabled", l_lovrWorldSetContactEventsEnabled },
+  { "setContactEventsBetween", l_lovrWorldSetContactEventsBetween },
+  { "setContactRule", l_lovrWorldSetContactRule },
+  { "getContactEventCount", l_lovrWorldGetContactEventCount },
+  { "getContactEvent", l_lovrWorldGetContactEvent },
   { "disableCollisionBetween", l_lovrWorldDisableCollisionBetween },
   { "enableCollisionBetween", l_lovrWorldEnableCollisionBetween },
   { "isCollisionEnabledBetween", l_lovrWorldIsCollisionEnabledBetween },
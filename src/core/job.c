@@ -0,0 +1,129 @@
+#include "job.h"
+#include "util.h"
+#include <stdlib.h>
+
+#ifdef LOVR_ENABLE_THREAD
+
+#include "lib/tinycthread/tinycthread.h"
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_WORKERS 16
+
+struct job_batch {
+  job_fn* fn;
+  void* context;
+  uint32_t count;
+  uint32_t next;
+  uint32_t workerCount;
+  thrd_t workers[MAX_WORKERS];
+  mtx_t lock;
+  char error[256];
+  bool failed;
+};
+
+typedef struct {
+  job_batch* batch;
+  jmp_buf env;
+} job_worker;
+
+static void onError(void* userdata, const char* format, va_list args) {
+  job_worker* worker = userdata;
+  job_batch* batch = worker->batch;
+  mtx_lock(&batch->lock);
+  if (!batch->failed) {
+    vsnprintf(batch->error, sizeof(batch->error), format, args);
+    batch->failed = true;
+  }
+  batch->next = batch->count;
+  mtx_unlock(&batch->lock);
+  longjmp(worker->env, 1);
+}
+
+static int run(void* userdata) {
+  job_worker worker = { .batch = userdata };
+  job_batch* batch = worker.batch;
+  lovrSetErrorCallback(onError, &worker);
+
+  if (setjmp(worker.env)) {
+    return 1;
+  }
+
+  for (;;) {
+    mtx_lock(&batch->lock);
+    uint32_t index = batch->next < batch->count ? batch->next++ : ~0u;
+    mtx_unlock(&batch->lock);
+
+    if (index == ~0u) {
+      return 0;
+    }
+
+    batch->fn(batch->context, index);
+  }
+}
+
+job_batch* job_start(job_fn* fn, void* context, uint32_t count, uint32_t workers) {
+  if (count == 0) {
+    return NULL;
+  }
+
+  job_batch* batch = calloc(1, sizeof(job_batch));
+  lovrAssert(batch, "Out of memory");
+  batch->fn = fn;
+  batch->context = context;
+  batch->count = count;
+  mtx_init(&batch->lock, mtx_plain);
+
+  workers = CLAMP(workers, 1, MIN(count, MAX_WORKERS));
+  for (uint32_t i = 0; i < workers; i++) {
+    if (thrd_create(&batch->workers[i], run, batch) != thrd_success) {
+      break;
+    }
+    batch->workerCount++;
+  }
+
+  // If no threads could be created, just do the work here
+  if (batch->workerCount == 0) {
+    for (uint32_t i = 0; i < count; i++) {
+      fn(context, i);
+    }
+  }
+
+  return batch;
+}
+
+bool job_wait(job_batch* batch, char* error, size_t size) {
+  if (!batch) {
+    return true;
+  }
+
+  for (uint32_t i = 0; i < batch->workerCount; i++) {
+    thrd_join(batch->workers[i], NULL);
+  }
+
+  bool failed = batch->failed;
+  if (failed && error && size > 0) {
+    strncpy(error, batch->error, size - 1);
+    error[size - 1] = '\0';
+  }
+
+  mtx_destroy(&batch->lock);
+  free(batch);
+  return !failed;
+}
+
+#else
+
+job_batch* job_start(job_fn* fn, void* context, uint32_t count, uint32_t workers) {
+  for (uint32_t i = 0; i < count; i++) {
+    fn(context, i);
+  }
+  return NULL;
+}
+
+bool job_wait(job_batch* batch, char* error, size_t size) {
+  return true;
+}
+
+#endif
@@ -0,0 +1,16 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+
+// A tiny fork-join helper: job_start runs fn(context, i) for every i in [0, count) on a few worker
+// threads and returns immediately, job_wait blocks until all of them are done.  If the callback
+// throws, the remaining work is skipped and job_wait returns false with the error message.  When
+// the thread module is disabled the work runs synchronously in job_start.
+
+typedef void job_fn(void* context, uint32_t index);
+typedef struct job_batch job_batch;
+
+job_batch* job_start(job_fn* fn, void* context, uint32_t count, uint32_t workers);
+bool job_wait(job_batch* batch, char* error, size_t size);
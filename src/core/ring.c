@@ -0,0 +1,86 @@
+#include "ring.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __has_builtin
+#define __has_builtin(x) 0
+#endif
+
+#ifndef LOVR_ENABLE_THREAD
+#define load(p) (*(p))
+#define store(p, x) (*(p) = (x))
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define load(p) ((uint32_t) _InterlockedOr((volatile long*) (p), 0))
+#define store(p, x) _InterlockedExchange((volatile long*) (p), (long) (x))
+#elif (defined(__GNUC_MINOR__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) \
+   || (__has_builtin(__atomic_load_n) && __has_builtin(__atomic_store_n))
+#define load(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store(p, x) __atomic_store_n(p, x, __ATOMIC_RELEASE)
+#else
+#include <stdatomic.h>
+#define load(p) atomic_load_explicit((_Atomic(uint32_t)*) (p), memory_order_acquire)
+#define store(p, x) atomic_store_explicit((_Atomic(uint32_t)*) (p), x, memory_order_release)
+#endif
+
+void ring_init(ring_t* ring, uint32_t capacity) {
+  uint32_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+    lovrAssert(size > 0, "Out of memory");
+  }
+
+  ring->data = malloc(size);
+  lovrAssert(ring->data, "Out of memory");
+  ring->capacity = capacity;
+  ring->mask = size - 1;
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+void ring_free(ring_t* ring) {
+  free(ring->data);
+}
+
+uint32_t ring_count(ring_t* ring) {
+  return load(&ring->head) - load(&ring->tail);
+}
+
+uint32_t ring_space(ring_t* ring) {
+  return ring->capacity - ring_count(ring);
+}
+
+// Producer side.  Writes are all-or-nothing so a packet is never split across an overrun.
+bool ring_write(ring_t* ring, const void* data, uint32_t size) {
+  uint32_t head = ring->head;
+  if (size > ring->capacity - (head - load(&ring->tail))) {
+    return false;
+  }
+
+  uint32_t offset = head & ring->mask;
+  uint32_t first = MIN(size, ring->mask + 1 - offset);
+  memcpy(ring->data + offset, data, first);
+  memcpy(ring->data, (const char*) data + first, size - first);
+  store(&ring->head, head + size);
+  return true;
+}
+
+// Consumer side, returns the number of bytes read
+uint32_t ring_read(ring_t* ring, void* data, uint32_t size) {
+  uint32_t tail = ring->tail;
+  uint32_t count = load(&ring->head) - tail;
+  size = MIN(size, count);
+
+  uint32_t offset = tail & ring->mask;
+  uint32_t first = MIN(size, ring->mask + 1 - offset);
+  memcpy(data, ring->data + offset, first);
+  memcpy((char*) data + first, ring->data, size - first);
+  store(&ring->tail, tail + size);
+  return size;
+}
+
+// Consumer side, drops everything that has been written so far
+void ring_clear(ring_t* ring) {
+  store(&ring->tail, load(&ring->head));
+}
@@ -0,0 +1,25 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+
+// A fixed-capacity byte ring for one producer thread and one consumer thread.  The producer only
+// moves head and the consumer only moves tail, so neither side takes a lock.  Positions increase
+// forever and are masked on access, which lets head == tail mean empty without wasting a slot.
+
+typedef struct {
+  char* data;
+  uint32_t capacity;
+  uint32_t mask;
+  uint32_t head;
+  uint32_t tail;
+} ring_t;
+
+void ring_init(ring_t* ring, uint32_t capacity);
+void ring_free(ring_t* ring);
+uint32_t ring_count(ring_t* ring);
+uint32_t ring_space(ring_t* ring);
+bool ring_write(ring_t* ring, const void* data, uint32_t size);
+uint32_t ring_read(ring_t* ring, void* data, uint32_t size);
+void ring_clear(ring_t* ring);
@@ -1,11 +1,22 @@
 #include "audio/audio.h"
+#include "audio/mixer.h"
 #include "data/audioStream.h"
 #include "data/soundData.h"
 #include "core/arr.h"
 #include "core/maf.h"
+#include "core/os.h"
 #include "core/ref.h"
+#include "core/ring.h"
 #include "core/util.h"
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#ifdef LOVR_ENABLE_THREAD
+#include "thread/channel.h"
+#include "event/event.h"
+#include "lib/tinycthread/tinycthread.h"
+#endif
 #include <AL/al.h>
 #include <AL/alc.h>
 #ifndef EMSCRIPTEN
@@ -13,16 +24,64 @@
 #endif
 
 #define SOURCE_BUFFERS 4
+#define STREAM_INTERVAL 5 // Milliseconds between refills on the audio thread
+#define CAPTURE_INTERVAL 2 // Milliseconds between polls on a Microphone's capture thread
+#define MAX_VOICES 256
+#define VOICE_HYSTERESIS 1.25f // Sources that already have a voice are favored by this much
+#define DEFAULT_CACHE_LIMIT (32 << 20)
+#define STATS_INTERVAL 1. // Seconds that decode time and mixer load are averaged over
 
 struct Source {
   SourceType type;
   struct SoundData* soundData;
   struct AudioStream* stream;
-  ALuint id;
+  ALuint id; // The voice playing this Source, 0 while it's virtual or when mixing in software
   ALuint buffers[SOURCE_BUFFERS];
+  size_t bufferSize; // Bytes of OpenAL buffers owned by this Source
+  bool isCached; // The SoundData and its buffer belong to the cache
   bool isLooping;
+  bool isRelative;
+  float volume;
+  float minVolume;
+  float maxVolume;
+  float pitch;
+  float innerAngle;
+  float outerAngle;
+  float outerGain;
+  float reference;
+  float maxDistance;
+  float rolloff;
+  float position[4];
+  float velocity[4];
+  float direction[4];
+  float priority;
+
+  // Playback state, kept here so Sources without a voice still advance
+  bool isPlaying;
+  bool isPaused;
+  double cursor; // Frame offset into the SoundData or stream, or into the decoded chunk when mixing
+  uint32_t chunkFrames; // Frames currently decoded into the stream's buffer, when mixing
+
+  double decodeTime; // Seconds spent decoding in the current stats interval
+  double decodeRate; // Microseconds per second over the last stats interval
 };
 
+typedef struct {
+  Source* source;
+  float score;
+} VoiceCandidate;
+
+// Decoded sounds are shared by every static Source playing them, along with their OpenAL buffer
+typedef struct {
+  uint64_t hash;
+  size_t blobSize;
+  SoundData* soundData;
+  ALuint buffer;
+  size_t bufferSize;
+  uint32_t sources;
+  uint64_t lastUse;
+} CachedSound;
+
 struct Microphone {
   ALCdevice* device;
   const char* name;
@@ -30,19 +89,79 @@ struct Microphone {
   uint32_t sampleRate;
   uint32_t bitDepth;
   uint32_t channelCount;
+  uint32_t deviceFrames;
+#ifdef LOVR_ENABLE_THREAD
+  // While capturing, a thread drains the device into the ring (or straight into the targets), so
+  // latency is bounded by the buffer sizes instead of by how often Lua polls
+  bool isCapturing;
+  ring_t ring;
+  void* scratch;
+  uint32_t scratchFrames;
+  uint32_t chunkFrames;
+  uint32_t overruns;
+  struct AudioStream* stream;
+  struct Channel* channel;
+  thrd_t thread;
+  mtx_t lock;
+  cnd_t wake;
+#endif
 };
 
 static struct {
   bool initialized;
   bool spatialized;
+  bool mixing;
+  bool float32;
+  bool multichannel;
+  bool ambisonic;
+  void* scratch;
+  size_t scratchSize;
   ALCdevice* device;
   ALCcontext* context;
+  const AudioSink* sink;
+  uint32_t sampleRate;
+  float volume;
+  float dopplerFactor;
+  float speedOfSound;
   float LOVR_ALIGN(16) orientation[4];
   float LOVR_ALIGN(16) position[4];
   float LOVR_ALIGN(16) velocity[4];
   arr_t(Source*) sources;
+  arr_t(VoiceCandidate) candidates;
+  ALuint voices[MAX_VOICES];
+  Source* voiceOwners[MAX_VOICES];
+  uint32_t voiceCount;
+  double time;
+  arr_t(CachedSound) cache;
+  size_t cacheSize;
+  size_t cacheLimit;
+  uint64_t cacheTick;
+  AudioStats stats;
+  double statsTime;
+  double decodeTime;
+  double mixTime;
+  uint32_t underruns;
+  size_t sourceMemory;
+  size_t bufferMemory;
+#ifdef LOVR_ENABLE_THREAD
+  thrd_t thread;
+  mtx_t lock;
+  cnd_t wake;
+  bool running;
+#endif
 } state;
 
+// The lock is recursive since some of the Source functions call each other
+#ifdef LOVR_ENABLE_THREAD
+#define lock() mtx_lock(&state.lock)
+#define unlock() mtx_unlock(&state.lock)
+#else
+#define lock()
+#define unlock()
+#endif
+
+// Returns 0 for formats the device can't play.  32 bit audio is float.  4 channels are treated as
+// first order ambisonics (a B-format bed), 6, 7, and 8 channels are 5.1, 6.1, and 7.1 surround.
 static ALenum lovrAudioConvertFormat(uint32_t bitDepth, uint32_t channelCount) {
   if (bitDepth == 8 && channelCount == 1) {
     return AL_FORMAT_MONO8;
@@ -53,89 +172,698 @@ static ALenum lovrAudioConvertFormat(uint32_t bitDepth, uint32_t channelCount) {
   } else if (bitDepth == 16 && channelCount == 2) {
     return AL_FORMAT_STEREO16;
   }
+
+#ifdef AL_EXT_float32
+  if (bitDepth == 32 && channelCount == 1 && state.float32) {
+    return AL_FORMAT_MONO_FLOAT32;
+  } else if (bitDepth == 32 && channelCount == 2 && state.float32) {
+    return AL_FORMAT_STEREO_FLOAT32;
+  }
+#endif
+
+#ifdef AL_EXT_BFORMAT
+  if (channelCount == 4 && state.ambisonic) {
+    if (bitDepth == 16) return AL_FORMAT_BFORMAT3D_16;
+    if (bitDepth == 32 && state.float32) return AL_FORMAT_BFORMAT3D_FLOAT32;
+  }
+#endif
+
+#ifdef AL_EXT_MCFORMATS
+  if (state.multichannel && (bitDepth == 16 || (bitDepth == 32 && state.float32))) {
+    switch (channelCount) {
+      case 6: return bitDepth == 16 ? AL_FORMAT_51CHN16 : AL_FORMAT_51CHN32;
+      case 7: return bitDepth == 16 ? AL_FORMAT_61CHN16 : AL_FORMAT_61CHN32;
+      case 8: return bitDepth == 16 ? AL_FORMAT_71CHN16 : AL_FORMAT_71CHN32;
+      default: break;
+    }
+  }
+#endif
+
   return 0;
 }
 
-bool lovrAudioInit() {
-  if (state.initialized) return false;
+static bool isFormatSupported(uint32_t bitDepth, uint32_t channelCount) {
+  return lovrAudioConvertFormat(bitDepth, channelCount) || (bitDepth == 32 && lovrAudioConvertFormat(16, channelCount));
+}
 
-  ALCdevice* device = alcOpenDevice(NULL);
-  lovrAssert(device, "Unable to open default audio device");
+// Float audio is converted to 16 bits when the device doesn't support AL_EXT_float32
+static size_t uploadBuffer(ALuint buffer, uint32_t bitDepth, uint32_t channelCount, const void* data, size_t samples, uint32_t sampleRate) {
+  ALenum format = lovrAudioConvertFormat(bitDepth, channelCount);
 
-  ALCcontext* context = alcCreateContext(device, NULL);
-  if (!context || !alcMakeContextCurrent(context) || alcGetError(device) != ALC_NO_ERROR) {
-    lovrThrow("Unable to create OpenAL context");
+  if (!format && bitDepth == 32) {
+    format = lovrAudioConvertFormat(16, channelCount);
+    if (state.scratchSize < samples * sizeof(int16_t)) {
+      state.scratchSize = samples * sizeof(int16_t);
+      state.scratch = realloc(state.scratch, state.scratchSize);
+      lovrAssert(state.scratch, "Out of memory");
+    }
+    mixer_convert(state.scratch, data, (uint32_t) samples, 1.f);
+    data = state.scratch;
+    bitDepth = 16;
   }
 
-#if ALC_SOFT_HRTF
-  static LPALCRESETDEVICESOFT alcResetDeviceSOFT;
-  alcResetDeviceSOFT = (LPALCRESETDEVICESOFT) alcGetProcAddress(device, "alcResetDeviceSOFT");
-  state.spatialized = alcIsExtensionPresent(device, "ALC_SOFT_HRTF");
+  alBufferData(buffer, format, data, (ALsizei) (samples * (bitDepth / 8)), sampleRate);
+  return samples * (bitDepth / 8);
+}
+
+// Decodes the next chunk of a streaming Source into its stream's buffer, timing it for the stats
+static size_t decodeStream(Source* source) {
+  double start = lovrPlatformGetTime();
+  size_t samples = lovrAudioStreamDecode(source->stream, NULL, 0);
+  double duration = lovrPlatformGetTime() - start;
+  source->decodeTime += duration;
+  state.decodeTime += duration;
+  return samples;
+}
 
-  if (state.spatialized) {
-    alcResetDeviceSOFT(device, (ALCint[]) { ALC_HRTF_SOFT, ALC_TRUE, 0 });
+// Turns the time accumulated since the last interval into rates
+static void updateStats(double time) {
+  double elapsed = time - state.statsTime;
+  if (elapsed < STATS_INTERVAL) {
+    return;
   }
-#endif
 
-  state.device = device;
-  state.context = context;
-  arr_init(&state.sources);
-  return state.initialized = true;
+  for (size_t i = 0; i < state.sources.length; i++) {
+    Source* source = state.sources.data[i];
+    source->decodeRate = source->decodeTime / elapsed * 1e6;
+    source->decodeTime = 0.;
+  }
+
+  state.stats.decodeTime = state.decodeTime / elapsed * 1e6;
+  state.stats.mixerLoad = state.mixTime / elapsed;
+  state.decodeTime = 0.;
+  state.mixTime = 0.;
+  state.statsTime = time;
 }
 
-void lovrAudioDestroy() {
-  if (!state.initialized) return;
-  for (size_t i = 0; i < state.sources.length; i++) {
-    lovrRelease(Source, state.sources.data[i]);
+static void detachVoice(Source* source);
+
+static void resetSource(Source* source) {
+  if (source->id) {
+    detachVoice(source);
+  }
+  source->isPlaying = false;
+  source->isPaused = false;
+  source->cursor = 0.;
+  source->chunkFrames = 0;
+  source->decodeTime = 0.;
+  source->decodeRate = 0.;
+  if (source->stream) {
+    lovrAudioStreamRewind(source->stream);
   }
-  arr_free(&state.sources);
-  alcMakeContextCurrent(NULL);
-  alcDestroyContext(state.context);
-  alcCloseDevice(state.device);
-  memset(&state, 0, sizeof(state));
 }
 
-void lovrAudioUpdate() {
+// Matches OpenAL's default inverse clamped distance model and cones.  delta is set to the Source's
+// position relative to the listener, and is zero for Sources that aren't positional.
+static float getGain(Source* source, float delta[4]) {
+  float volume = CLAMP(source->volume, source->minVolume, source->maxVolume);
+
+  if (lovrSourceGetChannelCount(source) != 1) {
+    vec3_set(delta, 0.f, 0.f, 0.f);
+    return volume;
+  }
+
+  float toListener[4];
+  vec3_init(delta, source->position);
+  if (source->isRelative) {
+    vec3_scale(vec3_init(toListener, delta), -1.f);
+  } else {
+    float inverse[4];
+    vec3_sub(delta, state.position);
+    vec3_scale(vec3_init(toListener, delta), -1.f);
+    quat_conjugate(quat_init(inverse, state.orientation));
+    quat_rotate(inverse, delta);
+  }
+
+  float distance = vec3_length(delta);
+  float clamped = CLAMP(distance, source->reference, source->maxDistance);
+  float denominator = source->reference + source->rolloff * (clamped - source->reference);
+  if (denominator > 0.f) {
+    volume *= source->reference / denominator;
+  }
+
+  if (distance > 0.f && vec3_length(source->direction) > 0.f) {
+    float direction[4];
+    vec3_normalize(vec3_init(direction, source->direction));
+    vec3_normalize(toListener);
+    float angle = 2.f * acosf(CLAMP(vec3_dot(direction, toListener), -1.f, 1.f));
+    if (angle >= source->outerAngle) {
+      volume *= source->outerGain;
+    } else if (angle > source->innerAngle) {
+      float t = (angle - source->innerAngle) / (source->outerAngle - source->innerAngle);
+      volume *= 1.f + (source->outerGain - 1.f) * t;
+    }
+  }
+
+  return volume;
+}
+
+// Equal power panning for the software mixer
+static void getGains(Source* source, float* left, float* right) {
+  float delta[4];
+  float volume = getGain(source, delta);
+  float distance = vec3_length(delta);
+  float pan = distance > 0.f ? CLAMP(delta[0] / distance, -1.f, 1.f) : 0.f;
+  float theta = (pan + 1.f) * (float) M_PI / 4.f;
+  *left = volume * cosf(theta);
+  *right = volume * sinf(theta);
+}
+
+// Voices
+
+static void applyProperties(Source* source) {
+  ALuint id = source->id;
+  alSourcef(id, AL_GAIN, source->volume);
+  alSourcef(id, AL_MIN_GAIN, source->minVolume);
+  alSourcef(id, AL_MAX_GAIN, source->maxVolume);
+  alSourcef(id, AL_PITCH, source->pitch);
+  alSourcef(id, AL_CONE_INNER_ANGLE, source->innerAngle * 180.f / (float) M_PI);
+  alSourcef(id, AL_CONE_OUTER_ANGLE, source->outerAngle * 180.f / (float) M_PI);
+  alSourcef(id, AL_CONE_OUTER_GAIN, source->outerGain);
+  alSourcef(id, AL_REFERENCE_DISTANCE, source->reference);
+  alSourcef(id, AL_MAX_DISTANCE, source->maxDistance);
+  alSourcef(id, AL_ROLLOFF_FACTOR, source->rolloff);
+  alSourcei(id, AL_SOURCE_RELATIVE, source->isRelative ? AL_TRUE : AL_FALSE);
+  alSourcefv(id, AL_POSITION, source->position);
+  alSourcefv(id, AL_VELOCITY, source->velocity);
+  alSourcefv(id, AL_DIRECTION, source->direction);
+}
+
+// Where the voice is in the Source, in frames
+static double getVoiceOffset(Source* source) {
+  ALint sampleOffset;
+  alGetSourcei(source->id, AL_SAMPLE_OFFSET, &sampleOffset);
+
+  if (source->type == SOURCE_STATIC) {
+    return sampleOffset;
+  } else if (lovrAudioStreamIsRaw(source->stream)) {
+    return 0.;
+  }
+
+  // The decoder is ahead of the voice by the buffers that are still queued
+  AudioStream* stream = source->stream;
+  ALint queued;
+  alGetSourcei(source->id, AL_BUFFERS_QUEUED, &queued);
+  size_t framesPerBuffer = stream->bufferSize / stream->channelCount / (stream->bitDepth / 8);
+  size_t frames = stream->samples / stream->channelCount;
+  double offset = (double) lovrAudioStreamTell(stream) + sampleOffset - (double) queued * framesPerBuffer;
+  return offset < 0. ? offset + frames : offset;
+}
+
+static bool attachVoice(Source* source) {
+  uint32_t index = 0;
+  while (index < state.voiceCount && state.voiceOwners[index]) index++;
+  if (index == state.voiceCount) {
+    return false;
+  }
+
+  state.voiceOwners[index] = source;
+  source->id = state.voices[index];
+  applyProperties(source);
+
+  if (source->type == SOURCE_STATIC) {
+    alSourcei(source->id, AL_LOOPING, source->isLooping ? AL_TRUE : AL_FALSE);
+    alSourcei(source->id, AL_BUFFER, source->buffers[0]);
+    alSourcef(source->id, AL_SAMPLE_OFFSET, (float) source->cursor);
+  } else {
+    alSourcei(source->id, AL_LOOPING, AL_FALSE);
+    alSourcei(source->id, AL_BUFFER, AL_NONE);
+    if (!lovrAudioStreamIsRaw(source->stream)) {
+      lovrAudioStreamSeek(source->stream, (size_t) source->cursor);
+    }
+    lovrSourceStream(source, source->buffers, SOURCE_BUFFERS);
+  }
+
+  alSourcePlay(source->id);
+  if (source->isPaused) {
+    alSourcePause(source->id);
+  }
+
+  return true;
+}
+
+// Gives the Source's voice back to the pool, remembering where it was so it can pick up from there
+static void detachVoice(Source* source) {
+  source->cursor = getVoiceOffset(source);
+  alSourceStop(source->id);
+  alSourcei(source->id, AL_BUFFER, AL_NONE);
+  for (uint32_t i = 0; i < state.voiceCount; i++) {
+    if (state.voiceOwners[i] == source) {
+      state.voiceOwners[i] = NULL;
+      break;
+    }
+  }
+  source->id = 0;
+}
+
+// Refills a streaming voice, returns false once the voice has finished
+static bool updateVoice(Source* source) {
+  ALenum sourceState;
+  alGetSourcei(source->id, AL_SOURCE_STATE, &sourceState);
+  bool isStopped = sourceState == AL_STOPPED;
+
+  if (source->type == SOURCE_STATIC) {
+    return !isStopped;
+  }
+
+  ALint processed;
+  alGetSourcei(source->id, AL_BUFFERS_PROCESSED, &processed);
+
+  if (processed) {
+    ALuint buffers[SOURCE_BUFFERS];
+    alSourceUnqueueBuffers(source->id, processed, buffers);
+    size_t queued = lovrSourceStream(source, buffers, processed);
+
+    // A stopped voice that still had data to queue ran dry, otherwise the stream just ended
+    if (isStopped && queued > 0) {
+      state.underruns++;
+      alSourcePlay(source->id);
+    }
+    return !isStopped || queued > 0;
+  }
+
+  return !isStopped;
+}
+
+// Virtual Sources just move their cursor along, returns false once the Source has finished
+static bool updateVirtual(Source* source, double dt) {
+  if (source->type == SOURCE_STREAM && lovrAudioStreamIsRaw(source->stream)) {
+    return true;
+  }
+
+  size_t frames = source->type == SOURCE_STATIC ? source->soundData->samples : source->stream->samples / source->stream->channelCount;
+  source->cursor += dt * source->pitch * lovrSourceGetSampleRate(source);
+
+  if (source->cursor >= frames) {
+    if (!source->isLooping || frames == 0) {
+      return false;
+    }
+    source->cursor = fmod(source->cursor, frames);
+  }
+
+  return true;
+}
+
+static int compareCandidates(const void* a, const void* b) {
+  float x = ((const VoiceCandidate*) a)->score;
+  float y = ((const VoiceCandidate*) b)->score;
+  return (x < y) - (x > y);
+}
+
+// Drops finished Sources, then hands the voices to the most important Sources that are playing.
+// Raw streams can't be virtualized since they'd lose their data, so they always win.
+static void updateVoices() {
+  double time = lovrPlatformGetTime();
+  double dt = MAX(time - state.time, 0.);
+  state.time = time;
+
+  arr_clear(&state.candidates);
+
   for (size_t i = state.sources.length; i-- > 0;) {
     Source* source = state.sources.data[i];
 
-    if (lovrSourceGetType(source) == SOURCE_STATIC) {
+    bool playing = source->isPlaying;
+    if (playing && !source->isPaused) {
+      playing = source->id ? updateVoice(source) : updateVirtual(source, dt);
+    }
+
+    if (!playing) {
+      resetSource(source);
+      arr_splice(&state.sources, i, 1);
+      lovrRelease(Source, source);
       continue;
     }
 
-    ALenum sourceState;
-    alGetSourcei(source->id, AL_SOURCE_STATE, &sourceState);
-    bool isStopped = sourceState == AL_STOPPED;
-    ALint processed;
-    alGetSourcei(source->id, AL_BUFFERS_PROCESSED, &processed);
+    if (source->isPaused) {
+      if (source->id) {
+        detachVoice(source);
+      }
+      continue;
+    }
+
+    float delta[4];
+    float score = source->priority * getGain(source, delta) * (source->id ? VOICE_HYSTERESIS : 1.f);
+    if (source->type == SOURCE_STREAM && lovrAudioStreamIsRaw(source->stream)) {
+      score = FLT_MAX;
+    }
+
+    arr_push(&state.candidates, ((VoiceCandidate) { source, score }));
+  }
+
+  VoiceCandidate* candidates = state.candidates.data;
+  size_t count = state.candidates.length;
+  qsort(candidates, count, sizeof(VoiceCandidate), compareCandidates);
+
+  for (size_t i = state.voiceCount; i < count; i++) {
+    if (candidates[i].source->id) {
+      detachVoice(candidates[i].source);
+    }
+  }
 
-    if (processed) {
-      ALuint buffers[SOURCE_BUFFERS];
-      alSourceUnqueueBuffers(source->id, processed, buffers);
-      lovrSourceStream(source, buffers, processed);
-      if (isStopped) {
-        alSourcePlay(source->id);
+  for (size_t i = 0; i < MIN(count, state.voiceCount); i++) {
+    if (!candidates[i].source->id) {
+      attachVoice(candidates[i].source);
+    }
+  }
+
+  updateStats(time);
+}
+
+// Mixer
+
+// Adds up to MIXER_BLOCK frames of a Source to the stereo output, returns false once it finishes
+static bool mixSource(Source* source, float* output, uint32_t frames) {
+  float LOVR_ALIGN(16) scratch[MIXER_BLOCK * 2];
+  uint32_t channels = lovrSourceGetChannelCount(source);
+  double step = (double) source->pitch * lovrSourceGetSampleRate(source) / state.sampleRate;
+  bool rewound = false;
+  float left, right;
+
+  if (step <= 0.) {
+    return true;
+  }
+
+  getGains(source, &left, &right);
+
+  while (frames > 0) {
+    if (source->type == SOURCE_STREAM && source->cursor >= source->chunkFrames) {
+      source->cursor -= source->chunkFrames;
+      source->chunkFrames = (uint32_t) (decodeStream(source) / channels);
+
+      if (source->chunkFrames > 0) {
+        rewound = false;
+      } else if (lovrAudioStreamIsRaw(source->stream)) {
+        source->cursor = 0.;
+        return true; // Raw streams wait for more data instead of stopping
+      } else if (source->isLooping && !rewound) {
+        lovrAudioStreamRewind(source->stream);
+        source->cursor = 0.;
+        rewound = true;
+      } else {
+        return false;
       }
-    } else if (isStopped) {
-      // in case we'll play this source in the future, rewind it now. This also frees up queued raw buffers.
-      lovrAudioStreamRewind(source->stream);
 
-      arr_splice(&state.sources, i, 1);
-      lovrRelease(Source, source);
+      continue;
+    }
+
+    const void* input;
+    uint32_t inputFrames;
+    if (source->type == SOURCE_STATIC) {
+      input = source->soundData->blob->data;
+      inputFrames = (uint32_t) source->soundData->samples;
+    } else {
+      input = source->stream->buffer;
+      inputFrames = source->chunkFrames;
+    }
+
+    uint32_t count = mixer_count(source->cursor, step, inputFrames, frames);
+
+    if (count == 0) {
+      if (source->isLooping && inputFrames > 0) {
+        source->cursor = fmod(source->cursor, inputFrames);
+        continue;
+      }
+      return false;
+    }
+
+    mixer_resample(scratch, count, input, lovrSourceGetBitDepth(source), inputFrames, channels, source->cursor, step);
+    mixer_pan(output, scratch, count, channels, left, right);
+    source->cursor += count * step;
+    output += 2 * count;
+    frames -= count;
+  }
+
+  return true;
+}
+
+// Mixes every playing Source into 16 bit stereo, dropping the ones that finish
+static void render(int16_t* output, uint32_t frames) {
+  float LOVR_ALIGN(16) mix[MIXER_BLOCK * 2];
+
+  while (frames > 0) {
+    uint32_t count = MIN(frames, MIXER_BLOCK);
+    memset(mix, 0, count * 2 * sizeof(float));
+
+    for (size_t i = state.sources.length; i-- > 0;) {
+      Source* source = state.sources.data[i];
+
+      if (source->isPaused) {
+        continue;
+      }
+
+      if (!source->isPlaying || !mixSource(source, mix, count)) {
+        resetSource(source);
+        arr_splice(&state.sources, i, 1);
+        lovrRelease(Source, source);
+      }
+    }
+
+    mixer_convert(output, mix, count * 2, state.volume);
+    output += count * 2;
+    frames -= count;
+  }
+}
+
+// Gives the sink as much audio as it can take without blocking
+static void updateMixer() {
+  int16_t buffer[MIXER_BUFFER_FRAMES * 2];
+  double start = lovrPlatformGetTime();
+  uint32_t frames;
+  while ((frames = state.sink->poll()) > 0) {
+    uint32_t count = MIN(frames, MIXER_BUFFER_FRAMES);
+    render(buffer, count);
+    state.sink->write(buffer, count);
+  }
+  double time = lovrPlatformGetTime();
+  state.mixTime += time - start;
+  updateStats(time);
+}
+
+// Cache
+
+static CachedSound* findCachedSound(SoundData* soundData) {
+  for (size_t i = 0; i < state.cache.length; i++) {
+    if (state.cache.data[i].soundData == soundData) {
+      return &state.cache.data[i];
+    }
+  }
+  return NULL;
+}
+
+// Drops the least recently used sounds until the cache fits.  Sounds that Sources are still using
+// can't be freed anyway, so they stay and the limit is exceeded until they're released.
+static void evictSounds() {
+  while (state.cacheSize > state.cacheLimit) {
+    CachedSound* oldest = NULL;
+    for (size_t i = 0; i < state.cache.length; i++) {
+      CachedSound* sound = &state.cache.data[i];
+      if (sound->sources == 0 && (!oldest || sound->lastUse < oldest->lastUse)) {
+        oldest = sound;
+      }
+    }
+
+    if (!oldest) {
+      break;
+    }
+
+    if (oldest->buffer) {
+      alDeleteBuffers(1, &oldest->buffer);
+      state.bufferMemory -= oldest->bufferSize;
+    }
+
+    state.cacheSize -= oldest->soundData->blob->size;
+    lovrRelease(SoundData, oldest->soundData);
+    *oldest = state.cache.data[--state.cache.length];
+  }
+}
+
+#ifdef LOVR_ENABLE_THREAD
+// Streaming sources (or the mixer's output) are refilled here instead of once per frame, so a long
+// frame doesn't starve them
+static int streamThread(void* userdata) {
+  mtx_lock(&state.lock);
+  while (state.running) {
+    if (state.mixing) {
+      updateMixer();
+    } else {
+      updateVoices();
+    }
+    struct timespec until;
+    timespec_get(&until, TIME_UTC);
+    until.tv_nsec += STREAM_INTERVAL * 1000000;
+    until.tv_sec += until.tv_nsec / 1000000000;
+    until.tv_nsec %= 1000000000;
+    cnd_timedwait(&state.wake, &state.lock, &until);
+  }
+  mtx_unlock(&state.lock);
+  return 0;
+}
+#endif
+
+bool lovrAudioInit(AudioOutput output, uint32_t sampleRate, uint32_t voiceCount, const char* path) {
+  if (state.initialized) return false;
+
+  state.mixing = output != OUTPUT_OPENAL;
+  state.sampleRate = sampleRate;
+  state.volume = 1.f;
+  state.dopplerFactor = 1.f;
+  state.speedOfSound = 343.3f;
+  state.orientation[3] = 1.f;
+
+  // The wav and null outputs never touch OpenAL, so they work without an audio device
+  if (output == OUTPUT_OPENAL || output == OUTPUT_MIXER) {
+    ALCdevice* device = alcOpenDevice(NULL);
+    lovrAssert(device, "Unable to open default audio device");
+
+    ALCint attributes[] = { ALC_FREQUENCY, (ALCint) sampleRate, 0 };
+    ALCcontext* context = alcCreateContext(device, state.mixing ? attributes : NULL);
+    if (!context || !alcMakeContextCurrent(context) || alcGetError(device) != ALC_NO_ERROR) {
+      lovrThrow("Unable to create OpenAL context");
+    }
+
+#if ALC_SOFT_HRTF
+    if (!state.mixing) {
+      static LPALCRESETDEVICESOFT alcResetDeviceSOFT;
+      alcResetDeviceSOFT = (LPALCRESETDEVICESOFT) alcGetProcAddress(device, "alcResetDeviceSOFT");
+      state.spatialized = alcIsExtensionPresent(device, "ALC_SOFT_HRTF");
+
+      if (state.spatialized) {
+        alcResetDeviceSOFT(device, (ALCint[]) { ALC_HRTF_SOFT, ALC_TRUE, 0 });
+      }
+    }
+#endif
+
+    state.device = device;
+    state.context = context;
+  }
+
+  // Sources share a fixed pool of voices, the device may run out of them before the limit is reached
+  if (output == OUTPUT_OPENAL) {
+    state.float32 = alIsExtensionPresent("AL_EXT_FLOAT32");
+    state.multichannel = alIsExtensionPresent("AL_EXT_MCFORMATS");
+    state.ambisonic = alIsExtensionPresent("AL_EXT_BFORMAT");
+
+    ALCint mono = 0, stereo = 0;
+    alcGetIntegerv(state.device, ALC_MONO_SOURCES, 1, &mono);
+    alcGetIntegerv(state.device, ALC_STEREO_SOURCES, 1, &stereo);
+    voiceCount = MIN(voiceCount, MAX_VOICES);
+    if (mono + stereo > 0) {
+      voiceCount = MIN(voiceCount, (uint32_t) (mono + stereo));
+    }
+
+    alGetError();
+    while (state.voiceCount < voiceCount) {
+      alGenSources(1, &state.voices[state.voiceCount]);
+      if (alGetError() != AL_NO_ERROR) break;
+      state.voiceCount++;
+    }
+
+    lovrAssert(state.voiceCount > 0, "Unable to create any audio voices");
+    state.time = lovrPlatformGetTime();
+  }
+
+  switch (output) {
+    case OUTPUT_OPENAL: state.sink = NULL; break;
+    case OUTPUT_MIXER: state.sink = &lovrAudioSinkOpenAL; break;
+    case OUTPUT_WAV: state.sink = &lovrAudioSinkWav; break;
+    case OUTPUT_NULL: state.sink = &lovrAudioSinkNull; break;
+  }
+
+  if (state.sink) {
+    lovrAssert(state.sink->init(sampleRate, path), "Could not initialize audio output");
+  }
+
+  arr_init(&state.sources);
+  arr_init(&state.candidates);
+  arr_init(&state.cache);
+  state.cacheLimit = DEFAULT_CACHE_LIMIT;
+  state.time = state.statsTime = lovrPlatformGetTime();
+
+#ifdef LOVR_ENABLE_THREAD
+  mtx_init(&state.lock, mtx_plain | mtx_recursive);
+  cnd_init(&state.wake);
+
+  // Offline outputs are only advanced by lovrAudioRender
+  if (output == OUTPUT_OPENAL || output == OUTPUT_MIXER) {
+    state.running = true;
+    if (thrd_create(&state.thread, streamThread, NULL) != thrd_success) {
+      state.running = false; // lovrAudioUpdate will stream on the main thread instead
     }
   }
+#endif
+
+  return state.initialized = true;
+}
+
+void lovrAudioDestroy() {
+  if (!state.initialized) return;
+#ifdef LOVR_ENABLE_THREAD
+  if (state.running) {
+    mtx_lock(&state.lock);
+    state.running = false;
+    cnd_signal(&state.wake);
+    mtx_unlock(&state.lock);
+    thrd_join(state.thread, NULL);
+  }
+  mtx_destroy(&state.lock);
+  cnd_destroy(&state.wake);
+#endif
+  for (size_t i = 0; i < state.sources.length; i++) {
+    Source* source = state.sources.data[i];
+    if (source->id) {
+      detachVoice(source);
+    }
+    lovrRelease(Source, source);
+  }
+  arr_free(&state.sources);
+  arr_free(&state.candidates);
+  for (size_t i = 0; i < state.cache.length; i++) {
+    if (state.cache.data[i].buffer) {
+      alDeleteBuffers(1, &state.cache.data[i].buffer);
+    }
+    lovrRelease(SoundData, state.cache.data[i].soundData);
+  }
+  arr_free(&state.cache);
+  free(state.scratch);
+  if (state.voiceCount > 0) {
+    alDeleteSources(state.voiceCount, state.voices);
+  }
+  if (state.sink) {
+    state.sink->destroy();
+  }
+  if (state.context) {
+    alcMakeContextCurrent(NULL);
+    alcDestroyContext(state.context);
+    alcCloseDevice(state.device);
+  }
+  memset(&state, 0, sizeof(state));
+}
+
+void lovrAudioUpdate() {
+#ifdef LOVR_ENABLE_THREAD
+  if (state.running) {
+    return;
+  }
+#endif
+  if (state.mixing) {
+    updateMixer();
+  } else {
+    updateVoices();
+  }
 }
 
 void lovrAudioAdd(Source* source) {
+  lock();
   if (!lovrAudioHas(source)) {
     lovrRetain(source);
     arr_push(&state.sources, source);
   }
+  unlock();
 }
 
 void lovrAudioGetDopplerEffect(float* factor, float* speedOfSound) {
-  alGetFloatv(AL_DOPPLER_FACTOR, factor);
-  alGetFloatv(AL_SPEED_OF_SOUND, speedOfSound);
+  *factor = state.dopplerFactor;
+  *speedOfSound = state.speedOfSound;
 }
 
 void lovrAudioGetMicrophoneNames(const char* names[MAX_MICROPHONES], uint32_t* count) {
@@ -160,34 +888,147 @@ void lovrAudioGetVelocity(vec3 velocity) {
 }
 
 float lovrAudioGetVolume() {
-  float volume;
-  alGetListenerf(AL_GAIN, &volume);
-  return volume;
+  return state.volume;
+}
+
+size_t lovrAudioGetCacheLimit() {
+  return state.cacheLimit;
+}
+
+void lovrAudioGetCacheSize(size_t* size, uint32_t* count) {
+  lock();
+  *size = state.cacheSize;
+  *count = (uint32_t) state.cache.length;
+  unlock();
+}
+
+const AudioStats* lovrAudioGetStats() {
+  lock();
+  state.stats.sources = (uint32_t) state.sources.length;
+  state.stats.voices = 0;
+  state.stats.streams = 0;
+  state.stats.queuedSamples = 0;
+  for (size_t i = 0; i < state.sources.length; i++) {
+    Source* source = state.sources.data[i];
+    state.stats.voices += source->id != 0;
+    if (source->type == SOURCE_STREAM) {
+      state.stats.streams++;
+      state.stats.queuedSamples += lovrAudioStreamGetQueuedSamples(source->stream);
+    }
+  }
+  state.stats.underruns = state.underruns + (state.sink ? state.sink->underruns() : 0);
+  state.stats.soundMemory = state.sourceMemory + state.cacheSize;
+  state.stats.bufferMemory = state.bufferMemory;
+  unlock();
+  return &state.stats;
 }
 
 bool lovrAudioHas(Source* source) {
+  bool found = false;
+  lock();
   for (size_t i = 0; i < state.sources.length; i++) {
     if (state.sources.data[i] == source) {
-      return true;
+      found = true;
+      break;
     }
   }
-
-  return false;
+  unlock();
+  return found;
 }
 
 bool lovrAudioIsSpatialized() {
   return state.spatialized;
 }
 
+// Returns a retained cached sound matching the hash and size, or NULL, must be called with the lock held
+static SoundData* findSound(uint64_t hash, size_t size) {
+  for (size_t i = 0; i < state.cache.length; i++) {
+    CachedSound* sound = &state.cache.data[i];
+    if (sound->hash == hash && sound->blobSize == size) {
+      sound->lastUse = ++state.cacheTick;
+      lovrRetain(sound->soundData);
+      return sound->soundData;
+    }
+  }
+  return NULL;
+}
+
+// Returns a decoded copy of an encoded sound file, decoding it only if the same file isn't cached
+// The decode runs without the lock so it can't stall the stream thread or leave the lock held if it throws
+SoundData* lovrAudioLoadSound(Blob* blob) {
+  uint64_t hash = hash64(blob->data, blob->size);
+
+  lock();
+  SoundData* cached = findSound(hash, blob->size);
+  unlock();
+
+  if (cached) {
+    return cached;
+  }
+
+  SoundData* soundData = lovrSoundDataCreateFromBlob(blob);
+
+  lock();
+
+  // Another thread may have decoded the same file in the meantime
+  cached = findSound(hash, blob->size);
+  if (cached) {
+    unlock();
+    lovrRelease(SoundData, soundData);
+    return cached;
+  }
+
+  if (soundData->blob->size <= state.cacheLimit) {
+    state.cacheSize += soundData->blob->size;
+    evictSounds();
+    lovrRetain(soundData);
+    arr_push(&state.cache, ((CachedSound) {
+      .hash = hash,
+      .blobSize = blob->size,
+      .soundData = soundData,
+      .lastUse = ++state.cacheTick
+    }));
+  }
+
+  unlock();
+  return soundData;
+}
+
 void lovrAudioPause() {
+  lock();
   for (size_t i = 0; i < state.sources.length; i++) {
     lovrSourcePause(state.sources.data[i]);
   }
+  unlock();
+}
+
+void lovrAudioRender(uint32_t frames) {
+  lovrAssert(state.sink && !state.context, "Audio can only be rendered manually with the wav or null outputs");
+  int16_t buffer[MIXER_BUFFER_FRAMES * 2];
+  lock();
+  while (frames > 0) {
+    uint32_t count = MIN(frames, MIXER_BUFFER_FRAMES);
+    render(buffer, count);
+    state.sink->write(buffer, count);
+    frames -= count;
+  }
+  unlock();
+}
+
+void lovrAudioSetCacheLimit(size_t limit) {
+  lock();
+  state.cacheLimit = limit;
+  evictSounds();
+  unlock();
 }
 
 void lovrAudioSetDopplerEffect(float factor, float speedOfSound) {
-  alDopplerFactor(factor);
-  alSpeedOfSound(speedOfSound);
+  state.dopplerFactor = factor;
+  state.speedOfSound = speedOfSound;
+  if (!state.mixing) {
+    alDopplerFactor(factor);
+    alSpeedOfSound(speedOfSound);
+  }
 }
 
 void lovrAudioSetOrientation(quat orientation) {
@@ -200,59 +1041,141 @@ void lovrAudioSetOrientation(quat orientation) {
   quat_rotate(state.orientation, u);
 
   // Pass the rotated orientation vectors to OpenAL
-  ALfloat directionVectors[6] = { f[0], f[1], f[2], u[0], u[1], u[2] };
-  alListenerfv(AL_ORIENTATION, directionVectors);
+  if (!state.mixing) {
+    ALfloat directionVectors[6] = { f[0], f[1], f[2], u[0], u[1], u[2] };
+    alListenerfv(AL_ORIENTATION, directionVectors);
+  }
 }
 
 void lovrAudioSetPosition(vec3 position) {
   vec3_init(state.position, position);
-  alListenerfv(AL_POSITION, position);
+  if (!state.mixing) {
+    alListenerfv(AL_POSITION, position);
+  }
 }
 
 void lovrAudioSetVelocity(vec3 velocity) {
   vec3_init(state.velocity, velocity);
-  alListenerfv(AL_VELOCITY, velocity);
+  if (!state.mixing) {
+    alListenerfv(AL_VELOCITY, velocity);
+  }
 }
 
 void lovrAudioSetVolume(float volume) {
-  alListenerf(AL_GAIN, volume);
+  state.volume = volume;
+  if (!state.mixing) {
+    alListenerf(AL_GAIN, volume);
+  }
 }
 
 void lovrAudioStop() {
+  lock();
   for (size_t i = 0; i < state.sources.length; i++) {
     lovrSourceStop(state.sources.data[i]);
   }
+  unlock();
 }
 
 // Source
 
+static void initSource(Source* source) {
+  source->volume = 1.f;
+  source->minVolume = 0.f;
+  source->maxVolume = 1.f;
+  source->pitch = 1.f;
+  source->innerAngle = 2.f * (float) M_PI;
+  source->outerAngle = 2.f * (float) M_PI;
+  source->outerGain = 0.f;
+  source->reference = 1.f;
+  source->maxDistance = FLT_MAX;
+  source->rolloff = 1.f;
+  source->priority = 1.f;
+}
+
 Source* lovrSourceCreateStatic(SoundData* soundData) {
   Source* source = lovrAlloc(Source);
-  ALenum format = lovrAudioConvertFormat(soundData->bitDepth, soundData->channelCount);
+  initSource(source);
   source->type = SOURCE_STATIC;
   source->soundData = soundData;
-  alGenSources(1, &source->id);
-  alGenBuffers(1, source->buffers);
-  alBufferData(source->buffers[0], format, soundData->blob->data, (ALsizei) soundData->blob->size, soundData->sampleRate);
-  alSourcei(source->id, AL_BUFFER, source->buffers[0]);
+  if (state.mixing) {
+    lovrAssert(soundData->bitDepth == 16 || soundData->bitDepth == 32, "The software mixer only supports 16 and 32 bit audio");
+    lovrAssert(soundData->channelCount <= 2, "The software mixer only supports mono and stereo audio");
+  } else {
+    lovrAssert(isFormatSupported(soundData->bitDepth, soundData->channelCount), "Unsupported audio format (%d bit, %d channels)", soundData->bitDepth, soundData->channelCount);
+  }
+
+  lock();
+  CachedSound* sound = findCachedSound(soundData);
+  if (sound) {
+    source->isCached = true;
+    sound->sources++;
+    sound->lastUse = ++state.cacheTick;
+  }
+
+  if (!state.mixing && (!sound || !sound->buffer)) {
+    alGenBuffers(1, source->buffers);
+    size_t size = uploadBuffer(source->buffers[0], soundData->bitDepth, soundData->channelCount, soundData->blob->data, soundData->samples * soundData->channelCount, soundData->sampleRate);
+    state.bufferMemory += size;
+    if (sound) {
+      sound->buffer = source->buffers[0];
+      sound->bufferSize = size;
+    } else {
+      source->bufferSize = size;
+    }
+  } else if (sound) {
+    source->buffers[0] = sound->buffer;
+  }
+
+  if (!sound) {
+    state.sourceMemory += soundData->blob->size;
+  }
+  unlock();
+
   lovrRetain(soundData);
   return source;
 }
 
 Source* lovrSourceCreateStream(AudioStream* stream) {
   Source* source = lovrAlloc(Source);
+  initSource(source);
   source->type = SOURCE_STREAM;
   source->stream = stream;
-  alGenSources(1, &source->id);
-  alGenBuffers(SOURCE_BUFFERS, source->buffers);
+  if (state.mixing) {
+    lovrAssert(stream->channelCount <= 2, "The software mixer only supports mono and stereo audio");
+  } else {
+    lovrAssert(isFormatSupported(stream->bitDepth, stream->channelCount), "Unsupported audio format (%d bit, %d channels)", stream->bitDepth, stream->channelCount);
+    alGenBuffers(SOURCE_BUFFERS, source->buffers);
+    source->bufferSize = SOURCE_BUFFERS * stream->bufferSize;
+    lock();
+    state.bufferMemory += source->bufferSize;
+    unlock();
+  }
   lovrRetain(stream);
   return source;
 }
 
 void lovrSourceDestroy(void* ref) {
   Source* source = ref;
-  alDeleteSources(1, &source->id);
-  alDeleteBuffers(source->type == SOURCE_STATIC ? 1 : SOURCE_BUFFERS, source->buffers);
+  if (source->isCached) {
+    lock();
+    CachedSound* sound = findCachedSound(source->soundData);
+    if (sound) {
+      sound->sources--;
+      sound->lastUse = ++state.cacheTick;
+      evictSounds();
+    }
+    unlock();
+  } else if (!state.mixing) {
+    alDeleteBuffers(source->type == SOURCE_STATIC ? 1 : SOURCE_BUFFERS, source->buffers);
+  }
+
+  if (!source->isCached && state.initialized) {
+    lock();
+    state.bufferMemory -= source->bufferSize;
+    state.sourceMemory -= source->soundData ? source->soundData->blob->size : 0;
+    unlock();
+  }
+
   lovrRelease(SoundData, source->soundData);
   lovrRelease(AudioStream, source->stream);
 }
@@ -266,11 +1189,13 @@ uint32_t lovrSourceGetBitDepth(Source* source) {
 }
 
 void lovrSourceGetCone(Source* source, float* innerAngle, float* outerAngle, float* outerGain) {
-  alGetSourcef(source->id, AL_CONE_INNER_ANGLE, innerAngle);
-  alGetSourcef(source->id, AL_CONE_OUTER_ANGLE, outerAngle);
-  alGetSourcef(source->id, AL_CONE_OUTER_GAIN, outerGain);
-  *innerAngle *= (float) M_PI / 180.f;
-  *outerAngle *= (float) M_PI / 180.f;
+  *innerAngle = source->innerAngle;
+  *outerAngle = source->outerAngle;
+  *outerGain = source->outerGain;
+}
+
+double lovrSourceGetDecodeTime(Source* source) {
+  return source->decodeRate;
 }
 
 uint32_t lovrSourceGetChannelCount(Source* source) {
@@ -279,28 +1204,33 @@ uint32_t lovrSourceGetChannelCount(Source* source) {
 
 void lovrSourceGetOrientation(Source* source, quat orientation) {
   float v[4], forward[4] = { 0.f, 0.f, -1.f };
-  alGetSourcefv(source->id, AL_DIRECTION, v);
+  vec3_init(v, source->direction);
   quat_between(orientation, forward, v);
 }
 
 size_t lovrSourceGetDuration(Source* source) {
+  if (source->type == SOURCE_STREAM && lovrAudioStreamIsRaw(source->stream)) {
+    return lovrAudioStreamGetQueuedSamples(source->stream);
+  }
   return source->type == SOURCE_STATIC ? source->soundData->samples : source->stream->samples;
 }
 
 void lovrSourceGetFalloff(Source* source, float* reference, float* max, float* rolloff) {
-  alGetSourcef(source->id, AL_REFERENCE_DISTANCE, reference);
-  alGetSourcef(source->id, AL_MAX_DISTANCE, max);
-  alGetSourcef(source->id, AL_ROLLOFF_FACTOR, rolloff);
+  *reference = source->reference;
+  *max = source->maxDistance;
+  *rolloff = source->rolloff;
 }
 
 float lovrSourceGetPitch(Source* source) {
-  float pitch;
-  alGetSourcef(source->id, AL_PITCH, &pitch);
-  return pitch;
+  return source->pitch;
+}
+
+float lovrSourceGetPriority(Source* source) {
+  return source->priority;
 }
 
 void lovrSourceGetPosition(Source* source, vec3 position) {
-  alGetSourcefv(source->id, AL_POSITION, position);
+  vec3_init(position, source->position);
 }
 
 uint32_t lovrSourceGetSampleRate(Source* source) {
@@ -308,18 +1238,16 @@ uint32_t lovrSourceGetSampleRate(Source* source) {
 }
 
 void lovrSourceGetVelocity(Source* source, vec3 velocity) {
-  alGetSourcefv(source->id, AL_VELOCITY, velocity);
+  vec3_init(velocity, source->velocity);
 }
 
 float lovrSourceGetVolume(Source* source) {
-  float volume;
-  alGetSourcef(source->id, AL_GAIN, &volume);
-  return volume;
+  return source->volume;
 }
 
 void lovrSourceGetVolumeLimits(Source* source, float* min, float* max) {
-  alGetSourcef(source->id, AL_MIN_GAIN, min);
-  alGetSourcef(source->id, AL_MAX_GAIN, max);
+  *min = source->minVolume;
+  *max = source->maxVolume;
 }
 
 bool lovrSourceIsLooping(Source* source) {
@@ -327,181 +1255,285 @@ bool lovrSourceIsLooping(Source* source) {
 }
 
 bool lovrSourceIsPlaying(Source* source) {
-  ALenum state;
-  alGetSourcei(source->id, AL_SOURCE_STATE, &state);
-  return state == AL_PLAYING;
+  return source->isPlaying && !source->isPaused;
 }
 
 bool lovrSourceIsRelative(Source* source) {
-  int isRelative;
-  alGetSourcei(source->id, AL_SOURCE_RELATIVE, &isRelative);
-  return isRelative == AL_TRUE;
+  return source->isRelative;
 }
 
 void lovrSourcePause(Source* source) {
-  alSourcePause(source->id);
+  lock();
+  source->isPaused = source->isPlaying;
+  if (source->id) {
+    alSourcePause(source->id);
+  }
+  unlock();
 }
 
+// Sources without a voice start out virtual when the pool is full and get one once they're important
+// enough, so they're added to the list here instead of waiting for the Lua wrapper to do it
 void lovrSourcePlay(Source* source) {
-  ALenum state;
-  alGetSourcei(source->id, AL_SOURCE_STATE, &state);
-
-  if (source->type == SOURCE_STATIC) {
-    if (state != AL_PLAYING) {
+  lock();
+  bool wasPaused = source->isPaused;
+  source->isPlaying = true;
+  source->isPaused = false;
+  lovrAudioAdd(source);
+  if (source->id) {
+    if (wasPaused) {
       alSourcePlay(source->id);
     }
-  } else {
-    switch (state) {
-      case AL_INITIAL:
-      case AL_STOPPED:
-        alSourcei(source->id, AL_BUFFER, AL_NONE);
-        lovrSourceStream(source, source->buffers, SOURCE_BUFFERS);
-        alSourcePlay(source->id);
-        break;
-      case AL_PAUSED:
-        alSourcePlay(source->id);
-        break;
-      case AL_PLAYING:
-        break;
-    }
+  } else if (!state.mixing) {
+    attachVoice(source);
   }
+  unlock();
 }
 
 void lovrSourceSeek(Source* source, size_t sample) {
-  if (source->type == SOURCE_STATIC) {
-    alSourcef(source->id, AL_SAMPLE_OFFSET, sample);
-  } else {
-    ALenum state;
-    alGetSourcei(source->id, AL_SOURCE_STATE, &state);
-    bool wasPaused = state == AL_PAUSED;
-    alSourceStop(source->id);
-    lovrAudioStreamSeek(source->stream, sample);
-    lovrSourcePlay(source);
-    if (wasPaused) {
-      lovrSourcePause(source);
+  lovrAssert(!source->stream || !lovrAudioStreamIsRaw(source->stream), "Can't seek raw stream");
+  lock();
+  if (state.mixing) {
+    if (source->type == SOURCE_STATIC) {
+      source->cursor = (double) sample;
+    } else {
+      lovrAudioStreamSeek(source->stream, sample);
+      source->cursor = 0.;
+      source->chunkFrames = 0;
     }
+  } else if (source->id) {
+    detachVoice(source);
+    source->cursor = (double) sample;
+    attachVoice(source);
+  } else {
+    source->cursor = (double) sample;
   }
+  unlock();
 }
 
 void lovrSourceSetCone(Source* source, float innerAngle, float outerAngle, float outerGain) {
-  alSourcef(source->id, AL_CONE_INNER_ANGLE, innerAngle * 180.f / (float) M_PI);
-  alSourcef(source->id, AL_CONE_OUTER_ANGLE, outerAngle * 180.f / (float) M_PI);
-  alSourcef(source->id, AL_CONE_OUTER_GAIN, outerGain);
+  source->innerAngle = innerAngle;
+  source->outerAngle = outerAngle;
+  source->outerGain = outerGain;
+  lock();
+  if (source->id) {
+    alSourcef(source->id, AL_CONE_INNER_ANGLE, innerAngle * 180.f / (float) M_PI);
+    alSourcef(source->id, AL_CONE_OUTER_ANGLE, outerAngle * 180.f / (float) M_PI);
+    alSourcef(source->id, AL_CONE_OUTER_GAIN, outerGain);
+  }
+  unlock();
 }
 
 void lovrSourceSetOrientation(Source* source, quat orientation) {
   float v[4] = { 0.f, 0.f, -1.f };
   quat_rotate(orientation, v);
-  alSource3f(source->id, AL_DIRECTION, v[0], v[1], v[2]);
+  vec3_init(source->direction, v);
+  lock();
+  if (source->id) {
+    alSource3f(source->id, AL_DIRECTION, v[0], v[1], v[2]);
+  }
+  unlock();
 }
 
 void lovrSourceSetFalloff(Source* source, float reference, float max, float rolloff) {
   lovrAssert(lovrSourceGetChannelCount(source) == 1, "Positional audio is only supported for mono sources");
-  alSourcef(source->id, AL_REFERENCE_DISTANCE, reference);
-  alSourcef(source->id, AL_MAX_DISTANCE, max);
-  alSourcef(source->id, AL_ROLLOFF_FACTOR, rolloff);
+  source->reference = reference;
+  source->maxDistance = max;
+  source->rolloff = rolloff;
+  lock();
+  if (source->id) {
+    alSourcef(source->id, AL_REFERENCE_DISTANCE, reference);
+    alSourcef(source->id, AL_MAX_DISTANCE, max);
+    alSourcef(source->id, AL_ROLLOFF_FACTOR, rolloff);
+  }
+  unlock();
 }
 
 void lovrSourceSetLooping(Source* source, bool isLooping) {
   lovrAssert(!source->stream || !lovrAudioStreamIsRaw(source->stream), "Can't loop a raw stream");
+  lock();
   source->isLooping = isLooping;
-  if (source->type == SOURCE_STATIC) {
+  if (source->type == SOURCE_STATIC && source->id) {
     alSourcei(source->id, AL_LOOPING, isLooping ? AL_TRUE : AL_FALSE);
   }
+  unlock();
 }
 
 void lovrSourceSetPitch(Source* source, float pitch) {
-  alSourcef(source->id, AL_PITCH, pitch);
+  source->pitch = pitch;
+  lock();
+  if (source->id) {
+    alSourcef(source->id, AL_PITCH, pitch);
+  }
+  unlock();
+}
+
+void lovrSourceSetPriority(Source* source, float priority) {
+  source->priority = priority;
 }
 
 void lovrSourceSetPosition(Source* source, vec3 position) {
   lovrAssert(lovrSourceGetChannelCount(source) == 1, "Positional audio is only supported for mono sources");
-  alSource3f(source->id, AL_POSITION, position[0], position[1], position[2]);
+  vec3_init(source->position, position);
+  lock();
+  if (source->id) {
+    alSource3f(source->id, AL_POSITION, position[0], position[1], position[2]);
+  }
+  unlock();
 }
 
 void lovrSourceSetRelative(Source* source, bool isRelative) {
-  alSourcei(source->id, AL_SOURCE_RELATIVE, isRelative ? AL_TRUE : AL_FALSE);
+  source->isRelative = isRelative;
+  lock();
+  if (source->id) {
+    alSourcei(source->id, AL_SOURCE_RELATIVE, isRelative ? AL_TRUE : AL_FALSE);
+  }
+  unlock();
 }
 
 void lovrSourceSetVelocity(Source* source, vec3 velocity) {
-  alSource3f(source->id, AL_VELOCITY, velocity[0], velocity[1], velocity[2]);
+  vec3_init(source->velocity, velocity);
+  lock();
+  if (source->id) {
+    alSource3f(source->id, AL_VELOCITY, velocity[0], velocity[1], velocity[2]);
+  }
+  unlock();
 }
 
 void lovrSourceSetVolume(Source* source, float volume) {
-  alSourcef(source->id, AL_GAIN, volume);
+  source->volume = volume;
+  lock();
+  if (source->id) {
+    alSourcef(source->id, AL_GAIN, volume);
+  }
+  unlock();
 }
 
 void lovrSourceSetVolumeLimits(Source* source, float min, float max) {
-  alSourcef(source->id, AL_MIN_GAIN, min);
-  alSourcef(source->id, AL_MAX_GAIN, max);
+  source->minVolume = min;
+  source->maxVolume = max;
+  lock();
+  if (source->id) {
+    alSourcef(source->id, AL_MIN_GAIN, min);
+    alSourcef(source->id, AL_MAX_GAIN, max);
+  }
+  unlock();
 }
 
 void lovrSourceStop(Source* source) {
-  if (source->type == SOURCE_STATIC) {
-    alSourceStop(source->id);
-  } else {
-    alSourceStop(source->id);
-    alSourcei(source->id, AL_BUFFER, AL_NONE);
-    lovrAudioStreamRewind(source->stream);
-  }
+  lock();
+  resetSource(source);
+  unlock();
 }
 
 // Fills buffers with data and queues them, called once initially and over time to stream more data
-void lovrSourceStream(Source* source, ALuint* buffers, size_t count) {
+size_t lovrSourceStream(Source* source, ALuint* buffers, size_t count) {
   if (source->type == SOURCE_STATIC) {
-    return;
+    return 0;
   }
 
   AudioStream* stream = source->stream;
-  ALenum format = lovrAudioConvertFormat(stream->bitDepth, stream->channelCount);
-  uint32_t frequency = stream->sampleRate;
   size_t samples = 0;
   size_t n = 0;
 
   // Keep decoding until there is nothing left to decode or all the buffers are filled
-  while (n < count && (samples = lovrAudioStreamDecode(stream, NULL, 0)) != 0) {
-    alBufferData(buffers[n++], format, stream->buffer, (ALsizei) (samples * sizeof(ALshort)), frequency);
+  while (n < count && (samples = decodeStream(source)) != 0) {
+    uploadBuffer(buffers[n++], stream->bitDepth, stream->channelCount, stream->buffer, samples, stream->sampleRate);
   }
 
   alSourceQueueBuffers(source->id, (ALsizei) n, buffers);
 
   if (samples == 0 && source->isLooping && n < count) {
     lovrAudioStreamRewind(stream);
-    lovrSourceStream(source, buffers + n, count - n);
-    return;
+    return n + lovrSourceStream(source, buffers + n, count - n);
   }
+
+  return n;
 }
 
 size_t lovrSourceTell(Source* source) {
-  switch (source->type) {
-    case SOURCE_STATIC: {
-      float offset;
-      alGetSourcef(source->id, AL_SAMPLE_OFFSET, &offset);
-      return offset;
+  if (state.mixing) {
+    if (source->type == SOURCE_STATIC) {
+      return (size_t) source->cursor;
     }
 
-    case SOURCE_STREAM: {
-      size_t decoderOffset = lovrAudioStreamTell(source->stream);
-      size_t samplesPerBuffer = source->stream->bufferSize / source->stream->channelCount / sizeof(ALshort);
-      ALsizei queuedBuffers, sampleOffset;
-      alGetSourcei(source->id, AL_BUFFERS_QUEUED, &queuedBuffers);
-      alGetSourcei(source->id, AL_SAMPLE_OFFSET, &sampleOffset);
+    // The decoder is positioned at the end of the chunk being played
+    lovrAssert(!lovrAudioStreamIsRaw(source->stream), "No position available in raw stream");
+    lock();
+    size_t offset = lovrAudioStreamTell(source->stream) - source->chunkFrames + (size_t) source->cursor;
+    unlock();
+    return offset;
+  }
+
+  if (source->type == SOURCE_STREAM) {
+    lovrAssert(!lovrAudioStreamIsRaw(source->stream), "No position available in raw stream");
+  }
+
+  lock();
+  size_t offset = (size_t) (source->id ? getVoiceOffset(source) : source->cursor);
+  unlock();
+  return offset;
+}
 
-      size_t offset = decoderOffset + sampleOffset;
+// Microphone
 
-      if (queuedBuffers * samplesPerBuffer > offset) {
-        return offset + source->stream->samples;
-      } else {
-        return offset;
+#ifdef LOVR_ENABLE_THREAD
+// Called with the Microphone locked, scratch holds the frames that were just captured
+static void deliverFrames(Microphone* microphone, uint32_t frames) {
+  uint32_t stride = microphone->bitDepth / 8 * microphone->channelCount;
+  bool dropped = false;
+
+  if (microphone->stream) {
+    dropped |= !lovrAudioStreamWrite(microphone->stream, microphone->scratch, frames * microphone->channelCount);
+  }
+
+  if (microphone->channel) {
+    SoundData* soundData = lovrSoundDataCreate(frames, microphone->sampleRate, microphone->bitDepth, microphone->channelCount);
+    memcpy(soundData->blob->data, microphone->scratch, frames * stride);
+    Variant variant = { .type = TYPE_OBJECT, .value.object = { soundData, "SoundData", lovrSoundDataDestroy } };
+    uint64_t id;
+    lovrChannelPush(microphone->channel, &variant, NAN, &id); // The Channel takes the reference
+  }
+
+  if (!microphone->stream && !microphone->channel) {
+    dropped = !ring_write(&microphone->ring, microphone->scratch, frames * stride);
+  }
+
+  if (dropped) {
+    microphone->overruns++;
+  }
+}
+
+static int captureThread(void* userdata) {
+  Microphone* microphone = userdata;
+  mtx_lock(&microphone->lock);
+  while (microphone->isCapturing) {
+    ALCint available;
+    alcGetIntegerv(microphone->device, ALC_CAPTURE_SAMPLES, 1, &available);
+
+    // Channels get fixed size chunks, everything else takes whatever the device has
+    while (available > 0) {
+      uint32_t frames = MIN((uint32_t) available, microphone->scratchFrames);
+      if (microphone->channel) {
+        if ((uint32_t) available < microphone->chunkFrames) break;
+        frames = microphone->chunkFrames;
       }
-      break;
+
+      alcCaptureSamples(microphone->device, microphone->scratch, (ALCsizei) frames);
+      deliverFrames(microphone, frames);
+      available -= frames;
     }
 
-    default: lovrThrow("Unreachable"); break;
+    struct timespec until;
+    timespec_get(&until, TIME_UTC);
+    until.tv_nsec += CAPTURE_INTERVAL * 1000000;
+    until.tv_sec += until.tv_nsec / 1000000000;
+    until.tv_nsec %= 1000000000;
+    cnd_timedwait(&microphone->wake, &microphone->lock, &until);
   }
+  mtx_unlock(&microphone->lock);
+  return 0;
 }
-
-// Microphone
+#endif
 
 Microphone* lovrMicrophoneCreate(const char* name, size_t samples, uint32_t sampleRate, uint32_t bitDepth, uint32_t channelCount) {
   Microphone* microphone = lovrAlloc(Microphone);
@@ -512,6 +1544,12 @@ Microphone* lovrMicrophoneCreate(const char* name, size_t samples, uint32_t samp
   microphone->sampleRate = sampleRate;
   microphone->bitDepth = bitDepth;
   microphone->channelCount = channelCount;
+  microphone->deviceFrames = (uint32_t) samples;
+#ifdef LOVR_ENABLE_THREAD
+  microphone->chunkFrames = MIN(sampleRate / 50, microphone->deviceFrames);
+  mtx_init(&microphone->lock, mtx_plain);
+  cnd_init(&microphone->wake);
+#endif
   return microphone;
 }
 
@@ -519,6 +1557,12 @@ void lovrMicrophoneDestroy(void* ref) {
   Microphone* microphone = ref;
   lovrMicrophoneStopRecording(microphone);
   alcCaptureCloseDevice(microphone->device);
+#ifdef LOVR_ENABLE_THREAD
+  lovrRelease(AudioStream, microphone->stream);
+  lovrRelease(Channel, microphone->channel);
+  mtx_destroy(&microphone->lock);
+  cnd_destroy(&microphone->wake);
+#endif
 }
 
 uint32_t lovrMicrophoneGetBitDepth(Microphone* microphone) {
@@ -549,7 +1593,14 @@ SoundData* lovrMicrophoneGetData(Microphone* microphone, size_t samples, SoundDa
     lovrAssert(offset + samples <= soundData->samples, "Tried to write samples past the end of a SoundData buffer");
   }
 
-  uint8_t* data = (uint8_t*) soundData->blob->data + offset * (microphone->bitDepth / 8) * microphone->channelCount;
+  size_t stride = (microphone->bitDepth / 8) * microphone->channelCount;
+  uint8_t* data = (uint8_t*) soundData->blob->data + offset * stride;
+#ifdef LOVR_ENABLE_THREAD
+  if (microphone->isCapturing) {
+    ring_read(&microphone->ring, data, (uint32_t) (samples * stride));
+    return soundData;
+  }
+#endif
   alcCaptureSamples(microphone->device, data, (ALCsizei) samples);
   return soundData;
 }
@@ -558,11 +1609,25 @@ const char* lovrMicrophoneGetName(Microphone* microphone) {
   return microphone->name;
 }
 
+uint32_t lovrMicrophoneGetOverruns(Microphone* microphone) {
+#ifdef LOVR_ENABLE_THREAD
+  return microphone->overruns;
+#else
+  return 0;
+#endif
+}
+
 size_t lovrMicrophoneGetSampleCount(Microphone* microphone) {
   if (!microphone->isRecording) {
     return 0;
   }
 
+#ifdef LOVR_ENABLE_THREAD
+  if (microphone->isCapturing) {
+    return ring_count(&microphone->ring) / ((microphone->bitDepth / 8) * microphone->channelCount);
+  }
+#endif
+
   ALCint samples;
   alcGetIntegerv(microphone->device, ALC_CAPTURE_SAMPLES, sizeof(ALCint), &samples);
   return (size_t) samples;
@@ -572,10 +1637,110 @@ uint32_t lovrMicrophoneGetSampleRate(Microphone* microphone) {
   return microphone->sampleRate;
 }
 
+bool lovrMicrophoneIsCapturing(Microphone* microphone) {
+#ifdef LOVR_ENABLE_THREAD
+  return microphone->isCapturing;
+#else
+  return false;
+#endif
+}
+
 bool lovrMicrophoneIsRecording(Microphone* microphone) {
   return microphone->isRecording;
 }
 
+// Captured frames go to the stream, the Channel, or both.  With neither, they wait in the ring
+void lovrMicrophoneSetStream(Microphone* microphone, struct AudioStream* stream) {
+#ifdef LOVR_ENABLE_THREAD
+  if (stream) {
+    lovrAssert(lovrAudioStreamIsRaw(stream), "Microphones can only write to raw AudioStreams");
+    lovrAssert(stream->channelCount == microphone->channelCount, "Microphone and AudioStream channel counts must match");
+    lovrAssert(stream->sampleRate == microphone->sampleRate, "Microphone and AudioStream sample rates must match");
+    lovrAssert(stream->bitDepth == microphone->bitDepth, "Microphone and AudioStream bit depths must match");
+  }
+  lovrRetain(stream);
+  mtx_lock(&microphone->lock);
+  struct AudioStream* old = microphone->stream;
+  microphone->stream = stream;
+  mtx_unlock(&microphone->lock);
+  lovrRelease(AudioStream, old);
+#else
+  lovrAssert(!stream, "Microphone capture requires the thread module");
+#endif
+}
+
+// Each message pushed to the Channel is a SoundData holding chunkSize frames
+void lovrMicrophoneSetChannel(Microphone* microphone, struct Channel* channel, uint32_t chunkSize) {
+#ifdef LOVR_ENABLE_THREAD
+  lovrAssert(chunkSize > 0, "Chunk size must be positive");
+  lovrAssert(chunkSize <= microphone->deviceFrames, "Chunk size can not be bigger than the Microphone's buffer");
+  void* scratch = NULL;
+  if (microphone->isCapturing && chunkSize > microphone->scratchFrames) {
+    scratch = malloc(chunkSize * (microphone->bitDepth / 8) * microphone->channelCount);
+    lovrAssert(scratch, "Out of memory");
+  }
+  lovrRetain(channel);
+  mtx_lock(&microphone->lock);
+  struct Channel* old = microphone->channel;
+  microphone->channel = channel;
+  microphone->chunkFrames = chunkSize;
+  if (scratch) {
+    free(microphone->scratch);
+    microphone->scratch = scratch;
+    microphone->scratchFrames = chunkSize;
+  }
+  mtx_unlock(&microphone->lock);
+  lovrRelease(Channel, old);
+#else
+  lovrAssert(!channel, "Microphone capture requires the thread module");
+#endif
+}
+
+void lovrMicrophoneStartCapture(Microphone* microphone, size_t bufferSize) {
+#ifdef LOVR_ENABLE_THREAD
+  if (microphone->isCapturing) {
+    return;
+  }
+
+  lovrAssert(bufferSize > 0, "Capture buffer size must be positive");
+  uint32_t stride = (microphone->bitDepth / 8) * microphone->channelCount;
+  microphone->scratchFrames = MAX((uint32_t) bufferSize, microphone->chunkFrames);
+  microphone->scratch = malloc(microphone->scratchFrames * stride);
+  lovrAssert(microphone->scratch, "Out of memory");
+  ring_init(&microphone->ring, (uint32_t) (bufferSize * stride));
+  microphone->overruns = 0;
+
+  lovrMicrophoneStartRecording(microphone);
+  microphone->isCapturing = true;
+  if (thrd_create(&microphone->thread, captureThread, microphone) != thrd_success) {
+    microphone->isCapturing = false;
+    ring_free(&microphone->ring);
+    free(microphone->scratch);
+    microphone->scratch = NULL;
+    lovrThrow("Could not start Microphone capture thread");
+  }
+#else
+  lovrThrow("Microphone capture requires the thread module");
+#endif
+}
+
+void lovrMicrophoneStopCapture(Microphone* microphone) {
+#ifdef LOVR_ENABLE_THREAD
+  if (!microphone->isCapturing) {
+    return;
+  }
+
+  mtx_lock(&microphone->lock);
+  microphone->isCapturing = false;
+  cnd_signal(&microphone->wake);
+  mtx_unlock(&microphone->lock);
+  thrd_join(microphone->thread, NULL);
+  ring_free(&microphone->ring);
+  free(microphone->scratch);
+  microphone->scratch = NULL;
+#endif
+}
+
 void lovrMicrophoneStartRecording(Microphone* microphone) {
   if (microphone->isRecording) {
     return;
@@ -590,6 +1755,7 @@ void lovrMicrophoneStopRecording(Microphone* microphone) {
     return;
   }
 
+  lovrMicrophoneStopCapture(microphone);
   alcCaptureStop(microphone->device);
   microphone->isRecording = false;
 }
@@ -7,6 +7,8 @@
 #define MAX_MICROPHONES 8
 
 struct AudioStream;
+struct Blob;
+struct Channel;
 struct SoundData;
 
 typedef struct Source Source;
@@ -17,12 +19,31 @@ typedef enum {
   SOURCE_STREAM
 } SourceType;
 
+typedef enum {
+  OUTPUT_OPENAL,
+  OUTPUT_MIXER,
+  OUTPUT_WAV,
+  OUTPUT_NULL
+} AudioOutput;
+
 typedef enum {
   UNIT_SECONDS,
   UNIT_SAMPLES
 } TimeUnit;
 
-bool lovrAudioInit(void);
+typedef struct {
+  uint32_t sources; // Playing or paused
+  uint32_t voices;
+  uint32_t streams;
+  uint32_t underruns;
+  uint64_t queuedSamples; // Waiting in raw streams
+  double decodeTime; // Microseconds spent decoding streams per second
+  double mixerLoad; // Fraction of real time spent in the software mixer
+  uint64_t soundMemory; // Decoded audio held by static Sources and the cache
+  uint64_t bufferMemory; // OpenAL buffers
+} AudioStats;
+
+bool lovrAudioInit(AudioOutput output, uint32_t sampleRate, uint32_t voiceCount, const char* path);
 void lovrAudioDestroy(void);
 void lovrAudioUpdate(void);
 void lovrAudioAdd(struct Source* source);
@@ -32,9 +53,15 @@ void lovrAudioGetOrientation(float* orientation);
 void lovrAudioGetPosition(float* position);
 void lovrAudioGetVelocity(float* velocity);
 float lovrAudioGetVolume(void);
+size_t lovrAudioGetCacheLimit(void);
+void lovrAudioGetCacheSize(size_t* size, uint32_t* count);
+const AudioStats* lovrAudioGetStats(void);
 bool lovrAudioHas(struct Source* source);
 bool lovrAudioIsSpatialized(void);
+struct SoundData* lovrAudioLoadSound(struct Blob* blob);
 void lovrAudioPause(void);
+void lovrAudioRender(uint32_t frames);
+void lovrAudioSetCacheLimit(size_t limit);
 void lovrAudioSetDopplerEffect(float factor, float speedOfSound);
 void lovrAudioSetOrientation(float* orientation);
 void lovrAudioSetPosition(float* position);
@@ -49,10 +76,12 @@ SourceType lovrSourceGetType(Source* source);
 uint32_t lovrSourceGetBitDepth(Source* source);
 uint32_t lovrSourceGetChannelCount(Source* source);
 void lovrSourceGetCone(Source* source, float* innerAngle, float* outerAngle, float* outerGain);
+double lovrSourceGetDecodeTime(Source* source);
 void lovrSourceGetOrientation(Source* source, float* orientation);
 size_t lovrSourceGetDuration(Source* source);
 void lovrSourceGetFalloff(Source* source, float* reference, float* max, float* rolloff);
 float lovrSourceGetPitch(Source* source);
+float lovrSourceGetPriority(Source* source);
 void lovrSourceGetPosition(Source* source, float* position);
 void lovrSourceGetVelocity(Source* source, float* velocity);
 uint32_t lovrSourceGetSampleRate(Source* source);
@@ -69,13 +98,14 @@ void lovrSourceSetOrientation(Source* source, float* orientation);
 void lovrSourceSetFalloff(Source* source, float reference, float max, float rolloff);
 void lovrSourceSetLooping(Source* source, bool isLooping);
 void lovrSourceSetPitch(Source* source, float pitch);
+void lovrSourceSetPriority(Source* source, float priority);
 void lovrSourceSetPosition(Source* source, float* position);
 void lovrSourceSetRelative(Source* source, bool isRelative);
 void lovrSourceSetVelocity(Source* source, float* velocity);
 void lovrSourceSetVolume(Source* source, float volume);
 void lovrSourceSetVolumeLimits(Source* source, float min, float max);
 void lovrSourceStop(Source* source);
-void lovrSourceStream(Source* source, uint32_t* buffers, size_t count);
+size_t lovrSourceStream(Source* source, uint32_t* buffers, size_t count);
 size_t lovrSourceTell(Source* source);
 
 Microphone* lovrMicrophoneCreate(const char* name, size_t samples, uint32_t sampleRate, uint32_t bitDepth, uint32_t channelCount);
@@ -84,8 +114,14 @@ uint32_t lovrMicrophoneGetBitDepth(Microphone* microphone);
 uint32_t lovrMicrophoneGetChannelCount(Microphone* microphone);
 struct SoundData* lovrMicrophoneGetData(Microphone* microphone, size_t samples, struct SoundData* soundData, size_t offset);
 const char* lovrMicrophoneGetName(Microphone* microphone);
+uint32_t lovrMicrophoneGetOverruns(Microphone* microphone);
 size_t lovrMicrophoneGetSampleCount(Microphone* microphone);
 uint32_t lovrMicrophoneGetSampleRate(Microphone* microphone);
+bool lovrMicrophoneIsCapturing(Microphone* microphone);
 bool lovrMicrophoneIsRecording(Microphone* microphone);
+void lovrMicrophoneSetChannel(Microphone* microphone, struct Channel* channel, uint32_t chunkSize);
+void lovrMicrophoneSetStream(Microphone* microphone, struct AudioStream* stream);
+void lovrMicrophoneStartCapture(Microphone* microphone, size_t bufferSize);
 void lovrMicrophoneStartRecording(Microphone* microphone);
+void lovrMicrophoneStopCapture(Microphone* microphone);
 void lovrMicrophoneStopRecording(Microphone* microphone);
@@ -0,0 +1,337 @@
+#include "audio/mixer.h"
+#include "filesystem/filesystem.h"
+#include "core/arr.h"
+#include "core/util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <AL/al.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+#define SINK_BUFFERS 4
+
+// Kernels
+
+// How many output frames can be produced before the cursor runs off the end of the input
+uint32_t mixer_count(double cursor, double step, uint32_t inputFrames, uint32_t frames) {
+  if (cursor >= inputFrames) {
+    return 0;
+  }
+
+  double count = ceil((inputFrames - cursor) / step);
+  return count < frames ? (uint32_t) count : frames;
+}
+
+// Converts frames of interleaved 16 bit or float input starting at cursor to float, linearly
+// interpolating when step isn't 1.  Only mono and stereo input is supported.
+void mixer_resample(float* output, uint32_t frames, const void* data, uint32_t bitDepth, uint32_t inputFrames, uint32_t channels, double cursor, double step) {
+  const int16_t* input = data;
+  const float* floats = data;
+  const float scale = bitDepth == 32 ? 1.f : 1.f / 32768.f;
+  uint32_t count = frames * channels;
+  uint32_t base = (uint32_t) cursor;
+  uint32_t i = 0;
+
+  // Playing at the input's rate is just a conversion, or a copy for float input
+  if (step == 1. && cursor == base && bitDepth == 32) {
+    memcpy(output, floats + base * channels, count * sizeof(float));
+    return;
+  } else if (step == 1. && cursor == base) {
+    input += base * channels;
+#if defined(MIXER_SSE)
+    for (; i + 8 <= count; i += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i*) (input + i));
+      __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+      __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+      _mm_storeu_ps(output + i + 0, _mm_mul_ps(lo, _mm_set1_ps(scale)));
+      _mm_storeu_ps(output + i + 4, _mm_mul_ps(hi, _mm_set1_ps(scale)));
+    }
+#elif defined(MIXER_NEON)
+    for (; i + 8 <= count; i += 8) {
+      int16x8_t x = vld1q_s16(input + i);
+      vst1q_f32(output + i + 0, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+      vst1q_f32(output + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+    }
+#endif
+    for (; i < count; i++) {
+      output[i] = input[i] * scale;
+    }
+    return;
+  }
+
+  // Otherwise gather 4 pairs of neighboring samples at a time and blend them
+  float offset = (float) (cursor - base);
+  float LOVR_ALIGN(16) a[4] = { 0 };
+  float LOVR_ALIGN(16) b[4] = { 0 };
+  float LOVR_ALIGN(16) t[4] = { 0 };
+  float LOVR_ALIGN(16) result[4];
+  uint32_t last = inputFrames - 1;
+
+  while (i < count) {
+    uint32_t n = MIN(4, count - i);
+
+    for (uint32_t j = 0; j < n; j++) {
+      uint32_t frame = channels == 1 ? i + j : (i + j) >> 1;
+      uint32_t channel = channels == 1 ? 0 : (i + j) & 1;
+      float position = offset + frame * (float) step;
+      uint32_t whole = (uint32_t) position;
+      uint32_t index = MIN(base + whole, last);
+      uint32_t next = MIN(index + 1, last);
+      a[j] = bitDepth == 32 ? floats[index * channels + channel] : input[index * channels + channel];
+      b[j] = bitDepth == 32 ? floats[next * channels + channel] : input[next * channels + channel];
+      t[j] = position - whole;
+    }
+
+#if defined(MIXER_SSE)
+    __m128 x = _mm_load_ps(a);
+    __m128 y = _mm_load_ps(b);
+    __m128 blend = _mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(y, x), _mm_load_ps(t)));
+    _mm_store_ps(result, _mm_mul_ps(blend, _mm_set1_ps(scale)));
+#elif defined(MIXER_NEON)
+    float32x4_t x = vld1q_f32(a);
+    float32x4_t y = vld1q_f32(b);
+    float32x4_t blend = vmlaq_f32(x, vsubq_f32(y, x), vld1q_f32(t));
+    vst1q_f32(result, vmulq_n_f32(blend, scale));
+#else
+    for (uint32_t j = 0; j < 4; j++) {
+      result[j] = (a[j] + (b[j] - a[j]) * t[j]) * scale;
+    }
+#endif
+
+    memcpy(output + i, result, n * sizeof(float));
+    i += n;
+  }
+}
+
+// Accumulates mono or stereo float input into the stereo output with a gain for each side
+void mixer_pan(float* output, const float* input, uint32_t frames, uint32_t channels, float left, float right) {
+  uint32_t i = 0;
+
+  if (channels == 1) {
+#if defined(MIXER_SSE)
+    __m128 gain = _mm_setr_ps(left, right, left, right);
+    for (; i + 4 <= frames; i += 4) {
+      __m128 x = _mm_loadu_ps(input + i);
+      __m128 lo = _mm_mul_ps(_mm_unpacklo_ps(x, x), gain);
+      __m128 hi = _mm_mul_ps(_mm_unpackhi_ps(x, x), gain);
+      _mm_storeu_ps(output + 2 * i + 0, _mm_add_ps(_mm_loadu_ps(output + 2 * i + 0), lo));
+      _mm_storeu_ps(output + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(output + 2 * i + 4), hi));
+    }
+#elif defined(MIXER_NEON)
+    float32x4_t gain = { left, right, left, right };
+    for (; i + 4 <= frames; i += 4) {
+      float32x4_t x = vld1q_f32(input + i);
+      float32x4x2_t pairs = vzipq_f32(x, x);
+      vst1q_f32(output + 2 * i + 0, vmlaq_f32(vld1q_f32(output + 2 * i + 0), pairs.val[0], gain));
+      vst1q_f32(output + 2 * i + 4, vmlaq_f32(vld1q_f32(output + 2 * i + 4), pairs.val[1], gain));
+    }
+#endif
+    for (; i < frames; i++) {
+      output[2 * i + 0] += input[i] * left;
+      output[2 * i + 1] += input[i] * right;
+    }
+  } else {
+    uint32_t count = frames * 2;
+#if defined(MIXER_SSE)
+    __m128 gain = _mm_setr_ps(left, right, left, right);
+    for (; i + 4 <= count; i += 4) {
+      _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(_mm_loadu_ps(input + i), gain)));
+    }
+#elif defined(MIXER_NEON)
+    float32x4_t gain = { left, right, left, right };
+    for (; i + 4 <= count; i += 4) {
+      vst1q_f32(output + i, vmlaq_f32(vld1q_f32(output + i), vld1q_f32(input + i), gain));
+    }
+#endif
+    for (; i < count; i += 2) {
+      output[i + 0] += input[i + 0] * left;
+      output[i + 1] += input[i + 1] * right;
+    }
+  }
+}
+
+// Applies the master gain and converts to 16 bit, saturating instead of wrapping
+void mixer_convert(int16_t* output, const float* input, uint32_t count, float gain) {
+  uint32_t i = 0;
+  gain *= 32768.f;
+#if defined(MIXER_SSE)
+  __m128 scale = _mm_set1_ps(gain);
+  for (; i + 8 <= count; i += 8) {
+    __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i + 0), scale));
+    __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale));
+    _mm_storeu_si128((__m128i*) (output + i), _mm_packs_epi32(lo, hi));
+  }
+#elif defined(MIXER_NEON)
+  for (; i + 8 <= count; i += 8) {
+    int32x4_t lo = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i + 0), gain));
+    int32x4_t hi = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i + 4), gain));
+    vst1q_s16(output + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+  }
+#endif
+  for (; i < count; i++) {
+    float x = input[i] * gain;
+    output[i] = (int16_t) lrintf(CLAMP(x, -32768.f, 32767.f));
+  }
+}
+
+// OpenAL sink, streams the mix through a single source
+
+static struct {
+  ALuint source;
+  ALuint buffers[SINK_BUFFERS];
+  ALuint available[SINK_BUFFERS];
+  uint32_t availableCount;
+  uint32_t sampleRate;
+  uint32_t underruns;
+  bool started;
+} openal;
+
+static bool openal_init(uint32_t sampleRate, const char* path) {
+  alGetError();
+  alGenSources(1, &openal.source);
+  alGenBuffers(SINK_BUFFERS, openal.buffers);
+  alSourcei(openal.source, AL_SOURCE_RELATIVE, AL_TRUE);
+  memcpy(openal.available, openal.buffers, sizeof(openal.buffers));
+  openal.availableCount = SINK_BUFFERS;
+  openal.sampleRate = sampleRate;
+  return alGetError() == AL_NO_ERROR;
+}
+
+static void openal_destroy(void) {
+  alSourceStop(openal.source);
+  alSourcei(openal.source, AL_BUFFER, AL_NONE);
+  alDeleteSources(1, &openal.source);
+  alDeleteBuffers(SINK_BUFFERS, openal.buffers);
+  memset(&openal, 0, sizeof(openal));
+}
+
+static uint32_t openal_poll(void) {
+  ALint processed;
+  alGetSourcei(openal.source, AL_BUFFERS_PROCESSED, &processed);
+  if (processed > 0) {
+    alSourceUnqueueBuffers(openal.source, processed, openal.available + openal.availableCount);
+    openal.availableCount += processed;
+  }
+  return openal.availableCount * MIXER_BUFFER_FRAMES;
+}
+
+static void openal_write(const int16_t* samples, uint32_t frames) {
+  lovrAssert(openal.availableCount > 0 && frames <= MIXER_BUFFER_FRAMES, "Unreachable");
+  ALuint buffer = openal.available[--openal.availableCount];
+  alBufferData(buffer, AL_FORMAT_STEREO16, samples, (ALsizei) (frames * 2 * sizeof(int16_t)), openal.sampleRate);
+  alSourceQueueBuffers(openal.source, 1, &buffer);
+
+  // Restart after an underrun, or on the first write
+  ALint state;
+  alGetSourcei(openal.source, AL_SOURCE_STATE, &state);
+  if (state != AL_PLAYING) {
+    openal.underruns += openal.started;
+    openal.started = true;
+    alSourcePlay(openal.source);
+  }
+}
+
+static uint32_t openal_underruns(void) {
+  return openal.underruns;
+}
+
+const AudioSink lovrAudioSinkOpenAL = {
+  .init = openal_init,
+  .destroy = openal_destroy,
+  .poll = openal_poll,
+  .write = openal_write,
+  .underruns = openal_underruns
+};
+
+// WAV sink, the mix is kept in memory and written to the save directory when audio shuts down
+
+static struct {
+  char path[LOVR_PATH_MAX];
+  arr_t(int16_t) samples;
+  uint32_t sampleRate;
+} wav;
+
+static bool wav_init(uint32_t sampleRate, const char* path) {
+  lovrAssert(path && strlen(path) < sizeof(wav.path), "Invalid path for audio output");
+  strcpy(wav.path, path);
+  arr_init(&wav.samples);
+  wav.sampleRate = sampleRate;
+  return true;
+}
+
+static void wav_destroy(void) {
+  uint32_t size = (uint32_t) (wav.samples.length * sizeof(int16_t));
+  uint32_t header[11] = {
+    0x46464952, 36 + size, 0x45564157, // "RIFF", size, "WAVE"
+    0x20746d66, 16, 1 | (2 << 16), // "fmt ", size, PCM, 2 channels
+    wav.sampleRate, wav.sampleRate * 4, 4 | (16 << 16), // byte rate, frame size, bit depth
+    0x61746164, size // "data", size
+  };
+
+  char* data = malloc(sizeof(header) + size);
+  lovrAssert(data, "Out of memory");
+  memcpy(data, header, sizeof(header));
+  if (size > 0) {
+    memcpy(data + sizeof(header), wav.samples.data, size);
+  }
+  lovrFilesystemWrite(wav.path, data, sizeof(header) + size, false);
+  arr_free(&wav.samples);
+  free(data);
+}
+
+static uint32_t wav_poll(void) {
+  return 0;
+}
+
+static void wav_write(const int16_t* samples, uint32_t frames) {
+  arr_append(&wav.samples, samples, frames * 2);
+}
+
+static uint32_t wav_underruns(void) {
+  return 0; // Offline, it can't fall behind
+}
+
+const AudioSink lovrAudioSinkWav = {
+  .init = wav_init,
+  .destroy = wav_destroy,
+  .poll = wav_poll,
+  .write = wav_write,
+  .underruns = wav_underruns
+};
+
+// Null sink, the mix is thrown away
+
+static bool null_init(uint32_t sampleRate, const char* path) {
+  return true;
+}
+
+static void null_destroy(void) {
+  //
+}
+
+static uint32_t null_poll(void) {
+  return 0;
+}
+
+static void null_write(const int16_t* samples, uint32_t frames) {
+  //
+}
+
+static uint32_t null_underruns(void) {
+  return 0;
+}
+
+const AudioSink lovrAudioSinkNull = {
+  .init = null_init,
+  .destroy = null_destroy,
+  .poll = null_poll,
+  .write = null_write,
+  .underruns = null_underruns
+};
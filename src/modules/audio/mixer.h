@@ -0,0 +1,26 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#pragma once
+
+// Internal to the audio module: the kernels and output sinks used by the software mixer.
+
+#define MIXER_BLOCK 256 // Frames mixed at a time, the scratch buffers are sized for this
+#define MIXER_BUFFER_FRAMES 1024 // Frames per buffer queued to the OpenAL sink
+
+typedef struct {
+  bool (*init)(uint32_t sampleRate, const char* path);
+  void (*destroy)(void);
+  uint32_t (*poll)(void); // Frames the sink can accept right now, offline sinks always return 0
+  void (*write)(const int16_t* samples, uint32_t frames); // Interleaved stereo
+  uint32_t (*underruns)(void); // Times the sink ran dry and had to be restarted
+} AudioSink;
+
+extern const AudioSink lovrAudioSinkOpenAL;
+extern const AudioSink lovrAudioSinkWav;
+extern const AudioSink lovrAudioSinkNull;
+
+uint32_t mixer_count(double cursor, double step, uint32_t inputFrames, uint32_t frames);
+void mixer_resample(float* output, uint32_t frames, const void* input, uint32_t bitDepth, uint32_t inputFrames, uint32_t channels, double cursor, double step);
+void mixer_pan(float* output, const float* input, uint32_t frames, uint32_t channels, float left, float right);
+void mixer_convert(int16_t* output, const float* input, uint32_t count, float gain);
@@ -7,18 +7,83 @@
 #include <stdlib.h>
 #include <string.h>
 
-AudioStream* lovrAudioStreamInit(AudioStream* stream, Blob* blob, size_t bufferSize) {
+// Vorbis
+
+static bool vorbisInit(AudioStream* stream, Blob* blob) {
   stb_vorbis* decoder = stb_vorbis_open_memory(blob->data, (int) blob->size, NULL, NULL);
-  lovrAssert(decoder, "Could not create audio stream for '%s'", blob->name);
 
-  stb_vorbis_info info = stb_vorbis_get_info(decoder);
+  if (!decoder) {
+    return false;
+  }
 
+  stb_vorbis_info info = stb_vorbis_get_info(decoder);
   stream->bitDepth = 16;
   stream->channelCount = info.channels;
   stream->sampleRate = info.sample_rate;
   stream->samples = stb_vorbis_stream_length_in_samples(decoder) * info.channels;
-  stream->decoder = decoder;
-  stream->bufferSize = stream->channelCount * bufferSize * sizeof(int16_t);
+  stream->context = decoder;
+  return true;
+}
+
+static void vorbisDestroy(AudioStream* stream) {
+  stb_vorbis_close(stream->context);
+}
+
+static size_t vorbisDecode(AudioStream* stream, void* data, size_t capacity) {
+  stb_vorbis* decoder = stream->context;
+  int16_t* buffer = data;
+  uint32_t channelCount = stream->channelCount;
+  size_t samples = 0;
+
+  while (samples < capacity) {
+    size_t count = stb_vorbis_get_samples_short_interleaved(decoder, channelCount, buffer + samples, (int)(capacity - samples));
+    if (count == 0) break;
+    samples += count * channelCount;
+  }
+
+  return samples;
+}
+
+static void vorbisSeek(AudioStream* stream, size_t frame) {
+  if (frame == 0) {
+    stb_vorbis_seek_start(stream->context);
+  } else {
+    stb_vorbis_seek(stream->context, (unsigned int) frame);
+  }
+}
+
+static size_t vorbisTell(AudioStream* stream) {
+  return stb_vorbis_get_sample_offset(stream->context);
+}
+
+const AudioDecoder lovrAudioDecoderVorbis = {
+  .init = vorbisInit,
+  .destroy = vorbisDestroy,
+  .decode = vorbisDecode,
+  .seek = vorbisSeek,
+  .tell = vorbisTell
+};
+
+// AudioStream
+
+static const AudioDecoder* decoders[] = {
+  &lovrAudioDecoderWav,
+#ifdef LOVR_USE_OPUS
+  &lovrAudioDecoderOpus,
+#endif
+  &lovrAudioDecoderVorbis
+};
+
+AudioStream* lovrAudioStreamInit(AudioStream* stream, Blob* blob, size_t bufferSize) {
+  for (size_t i = 0; i < sizeof(decoders) / sizeof(decoders[0]); i++) {
+    if (decoders[i]->init(stream, blob)) {
+      stream->decoder = decoders[i];
+      break;
+    }
+  }
+
+  lovrAssert(stream->decoder, "Could not create audio stream for '%s'", blob->name);
+  stream->bufferSize = stream->channelCount * bufferSize * (stream->bitDepth / 8);
   stream->buffer = malloc(stream->bufferSize);
   lovrAssert(stream->buffer, "Out of memory");
   stream->blob = blob;
@@ -26,127 +91,99 @@ AudioStream* lovrAudioStreamInit(AudioStream* stream, Blob* blob, size_t bufferS
   return stream;
 }
 
-AudioStream* lovrAudioStreamInitRaw(AudioStream* stream, int channelCount, int sampleRate, size_t bufferSize, size_t queueLimitInSamples) {
-  stream->bitDepth = 16;
+AudioStream* lovrAudioStreamInitRaw(AudioStream* stream, int channelCount, int sampleRate, uint32_t bitDepth, size_t bufferSize, size_t queueLimitInSamples) {
+  lovrAssert(bitDepth == 16 || bitDepth == 32, "Raw AudioStreams must be 16 or 32 bit");
+  size_t stride = bitDepth / 8;
+  stream->bitDepth = bitDepth;
   stream->channelCount = channelCount;
   stream->sampleRate = sampleRate;
   stream->decoder = NULL;
-  stream->bufferSize = stream->channelCount * bufferSize * sizeof(int16_t);
+  stream->bufferSize = stream->channelCount * bufferSize * stride;
   stream->buffer = malloc(stream->bufferSize);
   lovrAssert(stream->buffer, "Out of memory");
   stream->blob = NULL;
-  arr_init(&stream->queuedRawBuffers);
   stream->samples = 0;
-  stream->firstBlobCursor = 0;
-  stream->queueLimitInSamples = queueLimitInSamples;
+  stream->starved = true;
+  size_t capacity = queueLimitInSamples ? queueLimitInSamples : (size_t) sampleRate * channelCount;
+  lovrAssert(capacity <= UINT32_MAX / 2 / stride, "AudioStream queue limit is too large");
+  ring_init(&stream->queue, (uint32_t) (capacity * stride));
   return stream;
 }
 
 void lovrAudioStreamDestroy(void* ref) {
   AudioStream* stream = ref;
   if (stream->decoder) {
-    stb_vorbis_close(stream->decoder);
+    stream->decoder->destroy(stream);
     lovrRelease(Blob, stream->blob);
   } else {
-    for (size_t i = 0; i < stream->queuedRawBuffers.length; i++) {
-      lovrRelease(Blob, stream->queuedRawBuffers.data[i]);
-    }
-    arr_free(&stream->queuedRawBuffers);
+    ring_free(&stream->queue);
   }
   free(stream->buffer);
 }
 
-static size_t dequeue_raw(AudioStream* stream, int16_t* destination, size_t sampleCount) {
-  if (stream->queuedRawBuffers.length == 0) {
-    return 0;
-  }
-  size_t byteCount = sampleCount * sizeof(int16_t);
-  Blob* blob = stream->queuedRawBuffers.data[0];
-  size_t remainingBlobSize = blob->size - stream->firstBlobCursor;
-  if (remainingBlobSize <= byteCount) {
-
-    // blob fits in destination in its entirety. Copy over, free it and remove from start of array.
-    memcpy(destination, (char*) blob->data + stream->firstBlobCursor, remainingBlobSize);
-    lovrRelease(Blob, blob);
-    arr_splice(&stream->queuedRawBuffers, 0, 1);
-    stream->firstBlobCursor = 0;
-    return remainingBlobSize / sizeof(int16_t);
-  } else {
-    // blob is too big. copy all that fits, and advance cursor.
-    memcpy(destination, (char*) blob->data + stream->firstBlobCursor, byteCount);
-    stream->firstBlobCursor += byteCount;
-    return sampleCount;
-  }
-}
-
-size_t lovrAudioStreamDecode(AudioStream* stream, int16_t* destination, size_t size) {
-  stb_vorbis* decoder = (stb_vorbis*) stream->decoder;
-  int16_t* buffer = destination ? destination : (int16_t*) stream->buffer;
-  size_t capacity = destination ? size : (stream->bufferSize / sizeof(int16_t));
-  uint32_t channelCount = stream->channelCount;
-  size_t samples = 0;
+size_t lovrAudioStreamDecode(AudioStream* stream, void* destination, size_t size) {
+  size_t stride = stream->bitDepth / 8;
+  void* buffer = destination ? destination : stream->buffer;
+  size_t capacity = destination ? size : (stream->bufferSize / stride);
 
-  while (samples < capacity) {
-    size_t count = 0;
-    if (decoder) {
-      count = stb_vorbis_get_samples_short_interleaved(decoder, channelCount, buffer + samples, (int)(capacity - samples));
-    } else {
-      count = dequeue_raw(stream, buffer + samples, (int)(capacity - samples));
-      stream->samples -= count;
-    }
-    if (count == 0) break;
-    samples += count * channelCount;
+  if (!stream->decoder) {
+    size_t samples = ring_read(&stream->queue, buffer, (uint32_t) (capacity * stride)) / stride;
+    stream->underruns += samples == 0 && !stream->starved;
+    stream->starved = samples == 0;
+    return samples;
   }
 
-  return samples;
+  return stream->decoder->decode(stream, buffer, capacity);
 }
 
-bool lovrAudioStreamAppendRawBlob(AudioStream* stream, struct Blob* blob) {
-  lovrAssert(lovrAudioStreamIsRaw(stream), "Raw PCM data can only be appended to a raw AudioStream (see constructor that takes channel count and sample rate)")
-  if (stream->queueLimitInSamples != 0 && stream->samples + blob->size/sizeof(int16_t) >= stream->queueLimitInSamples) {
+// Copies samples into the queue.  Only one thread may write to a stream at a time, but it doesn't
+// have to be the thread that plays it.  If the whole packet doesn't fit it is dropped.
+bool lovrAudioStreamWrite(AudioStream* stream, const void* samples, size_t count) {
+  lovrAssert(lovrAudioStreamIsRaw(stream), "Raw PCM data can only be appended to a raw AudioStream (see constructor that takes channel count and sample rate)");
+  size_t stride = stream->bitDepth / 8;
+  if (count > stream->queue.capacity / stride || !ring_write(&stream->queue, samples, (uint32_t) (count * stride))) {
+    stream->overruns++;
     return false;
   }
-  lovrRetain(blob);
-  arr_push(&stream->queuedRawBuffers, blob);
-  stream->samples += blob->size / sizeof(int16_t);
   return true;
 }
 
+bool lovrAudioStreamAppendRawBlob(AudioStream* stream, struct Blob* blob) {
+  return lovrAudioStreamWrite(stream, blob->data, blob->size / (stream->bitDepth / 8));
+}
+
 bool lovrAudioStreamAppendRawSound(AudioStream* stream, struct SoundData* sound) {
   lovrAssert(sound->channelCount == stream->channelCount && sound->bitDepth == stream->bitDepth && sound->sampleRate == stream->sampleRate, "SoundData and AudioStream formats must match");
   return lovrAudioStreamAppendRawBlob(stream, sound->blob);
 }
 
+size_t lovrAudioStreamGetQueuedSamples(AudioStream* stream) {
+  return stream->decoder ? 0 : ring_count(&stream->queue) / (stream->bitDepth / 8);
+}
+
 bool lovrAudioStreamIsRaw(AudioStream* stream) {
   return stream->decoder == NULL;
 }
 
 double lovrAudioStreamGetDurationInSeconds(AudioStream* stream) {
-  return (double) stream->samples / stream->channelCount / stream->sampleRate;
+  size_t samples = stream->decoder ? stream->samples : lovrAudioStreamGetQueuedSamples(stream);
+  return (double) samples / stream->channelCount / stream->sampleRate;
 }
 
 void lovrAudioStreamRewind(AudioStream* stream) {
-  stb_vorbis* decoder = (stb_vorbis*) stream->decoder;
-  if (decoder) {
-    stb_vorbis_seek_start(decoder);
+  if (stream->decoder) {
+    stream->decoder->seek(stream, 0);
   } else {
-    stream->samples = 0;
-    stream->firstBlobCursor = 0;
-    for (size_t i = 0; i < stream->queuedRawBuffers.length; i++) {
-      lovrRelease(Blob, stream->queuedRawBuffers.data[i]);
-    }
-    arr_clear(&stream->queuedRawBuffers);
+    ring_clear(&stream->queue);
   }
 }
 
 void lovrAudioStreamSeek(AudioStream* stream, size_t sample) {
   lovrAssert(!lovrAudioStreamIsRaw(stream), "Can't seek raw stream");
-  stb_vorbis* decoder = (stb_vorbis*) stream->decoder;
-  stb_vorbis_seek(decoder, (int) sample);
+  stream->decoder->seek(stream, sample);
 }
 
 size_t lovrAudioStreamTell(AudioStream* stream) {
   lovrAssert(!lovrAudioStreamIsRaw(stream), "No position available in raw stream");
-  stb_vorbis* decoder = (stb_vorbis*) stream->decoder;
-  return stb_vorbis_get_sample_offset(decoder);
+  return stream->decoder->tell(stream);
 }
@@ -1,36 +1,57 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
-#include "core/arr.h"
+#include "core/ring.h"
 
 #pragma once
 
 struct Blob;
 struct SoundData;
+struct AudioStream;
+
+// Each file format implements one of these.  Positions are in frames, counts are in samples.
+// Decoders produce samples in the stream's bitDepth: 16 bit integers or 32 bit floats.
+typedef struct {
+  bool (*init)(struct AudioStream* stream, struct Blob* blob); // Returns false if the Blob is some other format
+  void (*destroy)(struct AudioStream* stream);
+  size_t (*decode)(struct AudioStream* stream, void* buffer, size_t capacity);
+  void (*seek)(struct AudioStream* stream, size_t frame);
+  size_t (*tell)(struct AudioStream* stream);
+} AudioDecoder;
+
+extern const AudioDecoder lovrAudioDecoderWav;
+extern const AudioDecoder lovrAudioDecoderVorbis;
+#ifdef LOVR_USE_OPUS
+extern const AudioDecoder lovrAudioDecoderOpus;
+#endif
 
 typedef struct AudioStream {
-  uint32_t bitDepth;
+  uint32_t bitDepth; // 16 (integer) or 32 (float)
   uint32_t channelCount;
   uint32_t sampleRate;
-  size_t samples; // if raw: count of samples queued in queuedRawBuffers
+  size_t samples; // 0 if stream is raw, see lovrAudioStreamGetQueuedSamples
   size_t bufferSize;
   void* buffer;
-  void* decoder; // null if stream is raw
+  const AudioDecoder* decoder; // null if stream is raw
+  void* context; // Decoder state
   struct Blob* blob;
-  arr_t(struct Blob*) queuedRawBuffers;
-  size_t queueLimitInSamples;
-  size_t firstBlobCursor; // bytes into queuedRawBuffers.data[0] at which to do the next read
+  ring_t queue; // raw PCM, written by one producer thread and drained by the audio thread
+  uint32_t underruns; // Times a raw stream ran out of data after having some
+  uint32_t overruns;
+  bool starved; // Whether the last read from the queue came back empty
 } AudioStream;
 
 AudioStream* lovrAudioStreamInit(AudioStream* stream, struct Blob* blob, size_t bufferSize);
 #define lovrAudioStreamCreate(...) lovrAudioStreamInit(lovrAlloc(AudioStream), __VA_ARGS__)
-AudioStream* lovrAudioStreamInitRaw(AudioStream* stream, int channelCount, int sampleRate, size_t bufferSize, size_t queueLimitInSamples);
+AudioStream* lovrAudioStreamInitRaw(AudioStream* stream, int channelCount, int sampleRate, uint32_t bitDepth, size_t bufferSize, size_t queueLimitInSamples);
 #define lovrAudioStreamCreateRaw(...) lovrAudioStreamInitRaw(lovrAlloc(AudioStream), __VA_ARGS__)
 void lovrAudioStreamDestroy(void* ref);
-size_t lovrAudioStreamDecode(AudioStream* stream, int16_t* destination, size_t size);
+size_t lovrAudioStreamDecode(AudioStream* stream, void* destination, size_t size);
+bool lovrAudioStreamWrite(AudioStream* stream, const void* samples, size_t count);
 bool lovrAudioStreamAppendRawBlob(AudioStream* stream, struct Blob* blob);
 bool lovrAudioStreamAppendRawSound(AudioStream* stream, struct SoundData* sound);
 double lovrAudioStreamGetDurationInSeconds(AudioStream* stream);
+size_t lovrAudioStreamGetQueuedSamples(AudioStream* stream);
 bool lovrAudioStreamIsRaw(AudioStream* stream);
 void lovrAudioStreamRewind(AudioStream* stream);
 void lovrAudioStreamSeek(AudioStream* stream, size_t sample);
@@ -0,0 +1,65 @@
+#include "data/audioStream.h"
+#include "data/blob.h"
+
+// Opus in an Ogg container, via libopusfile.  Opus always decodes at 48kHz.
+
+#ifdef LOVR_USE_OPUS
+#include <opusfile.h>
+
+static bool opusInit(AudioStream* stream, Blob* blob) {
+  if (op_test(NULL, blob->data, blob->size) != 0) {
+    return false;
+  }
+
+  OggOpusFile* decoder = op_open_memory(blob->data, blob->size, NULL);
+
+  if (!decoder) {
+    return false;
+  }
+
+  ogg_int64_t frames = op_pcm_total(decoder, -1);
+  stream->bitDepth = 16;
+  stream->channelCount = op_channel_count(decoder, -1);
+  stream->sampleRate = 48000;
+  stream->samples = frames > 0 ? (size_t) frames * stream->channelCount : 0;
+  stream->context = decoder;
+  return true;
+}
+
+static void opusDestroy(AudioStream* stream) {
+  op_free(stream->context);
+}
+
+static size_t opusDecode(AudioStream* stream, void* data, size_t capacity) {
+  OggOpusFile* decoder = stream->context;
+  int16_t* buffer = data;
+  uint32_t channelCount = stream->channelCount;
+  size_t samples = 0;
+
+  // Each call decodes at most one packet, a hole in the data ends the stream early
+  while (samples < capacity) {
+    int count = op_read(decoder, buffer + samples, (int) (capacity - samples), NULL);
+    if (count <= 0) break;
+    samples += (size_t) count * channelCount;
+  }
+
+  return samples;
+}
+
+static void opusSeek(AudioStream* stream, size_t frame) {
+  op_pcm_seek(stream->context, (ogg_int64_t) frame);
+}
+
+static size_t opusTell(AudioStream* stream) {
+  ogg_int64_t offset = op_pcm_tell(stream->context);
+  return offset > 0 ? (size_t) offset : 0;
+}
+
+const AudioDecoder lovrAudioDecoderOpus = {
+  .init = opusInit,
+  .destroy = opusDestroy,
+  .decode = opusDecode,
+  .seek = opusSeek,
+  .tell = opusTell
+};
+#endif
@@ -0,0 +1,143 @@
+#include "data/audioStream.h"
+#include "data/blob.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Uncompressed PCM in a RIFF container.  The samples are read straight out of the Blob, so decoding
+// is just a copy (8 bit samples are widened to 16 bits on the way out).  Float files stay float.
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xfffe
+
+typedef struct {
+  const uint8_t* data;
+  size_t frames;
+  size_t cursor;
+  uint32_t bytesPerSample;
+} WavDecoder;
+
+static uint16_t read16(const uint8_t* p) {
+  return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t read32(const uint8_t* p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static bool wavInit(AudioStream* stream, Blob* blob) {
+  const uint8_t* bytes = blob->data;
+  size_t size = blob->size;
+
+  if (size < 12 || memcmp(bytes, "RIFF", 4) || memcmp(bytes + 8, "WAVE", 4)) {
+    return false;
+  }
+
+  const uint8_t* format = NULL;
+  uint32_t formatSize = 0;
+  const uint8_t* data = NULL;
+  size_t dataSize = 0;
+
+  // Chunks are word aligned, anything that isn't the format or the samples is skipped
+  size_t offset = 12;
+  while (offset + 8 <= size) {
+    uint32_t chunkSize = read32(bytes + offset + 4);
+    const uint8_t* chunk = bytes + offset + 8;
+    size_t available = size - offset - 8;
+
+    if (!memcmp(bytes + offset, "fmt ", 4) && chunkSize >= 16 && chunkSize <= available) {
+      format = chunk;
+      formatSize = chunkSize;
+    } else if (!memcmp(bytes + offset, "data", 4)) {
+      data = chunk;
+      dataSize = chunkSize < available ? chunkSize : available;
+      break;
+    }
+
+    offset += 8 + (size_t) chunkSize + (chunkSize & 1);
+  }
+
+  if (!format || !data) {
+    return false;
+  }
+
+  uint16_t tag = read16(format);
+  uint16_t channelCount = read16(format + 2);
+  uint32_t sampleRate = read32(format + 4);
+  uint16_t bitDepth = read16(format + 14);
+
+  if (tag == WAVE_FORMAT_EXTENSIBLE && formatSize >= 40) {
+    tag = read16(format + 24); // The first two bytes of the subformat GUID
+  }
+
+  bool pcm = tag == WAVE_FORMAT_PCM && (bitDepth == 8 || bitDepth == 16);
+  bool ieee = tag == WAVE_FORMAT_IEEE_FLOAT && bitDepth == 32;
+  if ((!pcm && !ieee) || channelCount == 0 || sampleRate == 0) {
+    return false;
+  }
+
+  WavDecoder* decoder = malloc(sizeof(WavDecoder));
+  if (!decoder) {
+    return false;
+  }
+
+  decoder->data = data;
+  decoder->bytesPerSample = bitDepth / 8;
+  decoder->frames = dataSize / (decoder->bytesPerSample * channelCount);
+  decoder->cursor = 0;
+
+  stream->bitDepth = ieee ? 32 : 16;
+  stream->channelCount = channelCount;
+  stream->sampleRate = sampleRate;
+  stream->samples = decoder->frames * channelCount;
+  stream->context = decoder;
+  return true;
+}
+
+static void wavDestroy(AudioStream* stream) {
+  free(stream->context);
+}
+
+static size_t wavDecode(AudioStream* stream, void* buffer, size_t capacity) {
+  WavDecoder* decoder = stream->context;
+  uint32_t channelCount = stream->channelCount;
+  size_t frames = capacity / channelCount;
+
+  if (frames > decoder->frames - decoder->cursor) {
+    frames = decoder->frames - decoder->cursor;
+  }
+
+  size_t samples = frames * channelCount;
+  size_t start = decoder->cursor * channelCount;
+
+  if (decoder->bytesPerSample == 1) {
+    const uint8_t* source = decoder->data + start;
+    int16_t* samples16 = buffer;
+    for (size_t i = 0; i < samples; i++) {
+      samples16[i] = (int16_t) ((source[i] - 128) * 256);
+    }
+  } else {
+    memcpy(buffer, decoder->data + start * decoder->bytesPerSample, samples * decoder->bytesPerSample);
+  }
+
+  decoder->cursor += frames;
+  return samples;
+}
+
+static void wavSeek(AudioStream* stream, size_t frame) {
+  WavDecoder* decoder = stream->context;
+  decoder->cursor = frame < decoder->frames ? frame : decoder->frames;
+}
+
+static size_t wavTell(AudioStream* stream) {
+  WavDecoder* decoder = stream->context;
+  return decoder->cursor;
+}
+
+const AudioDecoder lovrAudioDecoderWav = {
+  .init = wavInit,
+  .destroy = wavDestroy,
+  .decode = wavDecode,
+  .seek = wavSeek,
+  .tell = wavTell
+};
@@ -1,11 +1,16 @@
 #include "data/modelData.h"
 #include "data/blob.h"
 #include "data/textureData.h"
+#include "core/job.h"
 #include "core/ref.h"
 #include <stdlib.h>
 
+#define MAX_IMAGE_WORKERS 4
+
 ModelData* lovrModelDataInit(ModelData* model, Blob* source, ModelDataIO* io) {
-  if (lovrModelDataInitGltf(model, source, io)) {
+  if (lovrModelDataInitBin(model, source, io)) {
+    return model;
+  } else if (lovrModelDataInitGltf(model, source, io)) {
     return model;
   } else if (lovrModelDataInitObj(model, source, io)) {
     return model;
@@ -15,8 +20,30 @@ ModelData* lovrModelDataInit(ModelData* model, Blob* source, ModelDataIO* io) {
   return NULL;
 }
 
+static void releaseImages(ModelData* model) {
+  if (!model->images) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < model->textureCount; i++) {
+    ModelImage* image = &model->images[i];
+    if (image->blob && image->borrowed) {
+      image->blob->data = NULL; // XXX Blob data ownership
+    }
+    lovrRelease(Blob, image->blob);
+  }
+
+  free(model->images);
+  model->images = NULL;
+}
+
 void lovrModelDataDestroy(void* ref) {
   ModelData* model = ref;
+  if (model->imageJob) {
+    job_wait(model->imageJob, NULL, 0);
+    model->imageJob = NULL;
+  }
+  releaseImages(model);
   for (uint32_t i = 0; i < model->blobCount; i++) {
     lovrRelease(Blob, model->blobs[i]);
   }
@@ -26,6 +53,13 @@ void lovrModelDataDestroy(void* ref) {
   map_free(&model->animationMap);
   map_free(&model->materialMap);
   map_free(&model->nodeMap);
+  if (model->lods) {
+    for (uint32_t i = 0; i < model->primitiveCount; i++) {
+      free(model->lods[i].data);
+    }
+    free(model->lods);
+  }
+  free(model->bufferCopy);
   free(model->data);
 }
 
@@ -69,3 +103,50 @@ void lovrModelDataAllocate(ModelData* model) {
   map_init(&model->materialMap, model->materialCount);
   map_init(&model->nodeMap, model->nodeCount);
 }
+
+static void decodeImage(void* context, uint32_t index) {
+  ModelData* model = context;
+  ModelImage* image = &model->images[index];
+  if (image->blob) {
+    model->textures[index] = lovrTextureDataCreateFromBlob(image->blob, image->flip);
+    if (image->borrowed) {
+      image->blob->data = NULL; // XXX Blob data ownership
+    }
+    lovrRelease(Blob, image->blob);
+    image->blob = NULL;
+  }
+}
+
+// If the loader throws while images are decoding, the workers are joined before the error is passed on
+static void onParseError(void* userdata, const char* format, va_list args) {
+  ModelData* model = userdata;
+  lovrSetErrorCallback(model->parentError, model->parentErrorUserdata);
+  job_wait(model->imageJob, NULL, 0);
+  model->imageJob = NULL;
+  releaseImages(model);
+  model->parentError(model->parentErrorUserdata, format, args);
+}
+
+// Takes ownership of an array of textureCount encoded images and decodes them into the textures
+// in the background while the rest of the file is parsed.  The loader calls lovrModelDataFinish
+// before returning, so a bad image fails the load instead of leaving a missing texture behind.
+void lovrModelDataDecodeImages(ModelData* model, ModelImage* images) {
+  model->images = images;
+  model->parentError = lovrErrorCallback;
+  model->parentErrorUserdata = lovrErrorUserdata;
+  lovrSetErrorCallback(onParseError, model);
+  model->imageJob = job_start(decodeImage, model, model->textureCount, MAX_IMAGE_WORKERS);
+}
+
+void lovrModelDataFinish(ModelData* model) {
+  if (!model->images) {
+    return;
+  }
+
+  lovrSetErrorCallback(model->parentError, model->parentErrorUserdata);
+  char error[256];
+  bool success = job_wait(model->imageJob, error, sizeof(error));
+  model->imageJob = NULL;
+  releaseImages(model);
+  lovrAssert(success, "%s", error);
+}
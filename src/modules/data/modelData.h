@@ -7,9 +7,11 @@
 #pragma once
 
 #define MAX_BONES 48
+#define MAX_LODS 4
 
 struct TextureData;
 struct Blob;
+struct job_batch;
 
 typedef enum {
   ATTR_POSITION,
@@ -154,6 +156,16 @@ typedef struct {
   uint32_t material;
 } ModelPrimitive;
 
+typedef struct {
+  void* data;
+  uint32_t start[MAX_LODS];
+  uint32_t count[MAX_LODS];
+  float error[MAX_LODS];
+  float center[3];
+  float radius;
+  uint32_t levelCount;
+} ModelLod;
+
 typedef struct {
   const char* name;
   union {
@@ -178,6 +190,12 @@ typedef struct {
   float* inverseBindMatrices;
 } ModelSkin;
 
+typedef struct {
+  struct Blob* blob;
+  bool flip;
+  bool borrowed;
+} ModelImage;
+
 typedef struct ModelData {
   void* data;
   struct Blob** blobs;
@@ -213,6 +231,13 @@ typedef struct ModelData {
   map_t animationMap;
   map_t materialMap;
   map_t nodeMap;
+
+  ModelImage* images;
+  struct job_batch* imageJob;
+  errorFn* parentError;
+  void* parentErrorUserdata;
+  ModelLod* lods;
+  char* bufferCopy; // Vertex and index data copied out of the source so optimization can rewrite it
 } ModelData;
 
 typedef void* ModelDataIO(const char* filename, size_t* bytesRead);
@@ -221,5 +246,11 @@ ModelData* lovrModelDataInit(ModelData* model, struct Blob* blob, ModelDataIO* i
 #define lovrModelDataCreate(...) lovrModelDataInit(lovrAlloc(ModelData), __VA_ARGS__)
 ModelData* lovrModelDataInitGltf(ModelData* model, struct Blob* blob, ModelDataIO* io);
 ModelData* lovrModelDataInitObj(ModelData* model, struct Blob* blob, ModelDataIO* io);
+ModelData* lovrModelDataInitBin(ModelData* model, struct Blob* blob, ModelDataIO* io);
 void lovrModelDataDestroy(void* ref);
 void lovrModelDataAllocate(ModelData* model);
+void lovrModelDataDecodeImages(ModelData* model, ModelImage* images);
+void lovrModelDataFinish(ModelData* model);
+bool lovrModelDataEncode(ModelData* model, const char* filename);
+void lovrModelDataOptimize(ModelData* model, bool quantize);
+void lovrModelDataGenerateLods(ModelData* model, uint32_t levels, float ratio);
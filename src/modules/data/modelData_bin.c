@@ -0,0 +1,582 @@
+#include "data/modelData.h"
+#include "data/blob.h"
+#include "data/textureData.h"
+#include "filesystem/filesystem.h"
+#include "core/arr.h"
+#include "core/ref.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A versioned binary snapshot of a ModelData.  Everything is stored so that it can be used in place:
+// the header and records are followed by a data section with buffers, keyframes, bind matrices and
+// pixels, each aligned to 16 bytes.  Loading is just a few bounds checks and pointer fixups, the
+// geometry is never copied or parsed.  The layout is native-endian, the magic catches mismatches.
+
+#define MAGIC_LMDL 0x4c444d4c
+#define LMDL_VERSION 1
+#define LMDL_ALIGN 16
+#define NO_NAME ~0u
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t bufferCount;
+  uint32_t textureCount;
+  uint32_t materialCount;
+  uint32_t attributeCount;
+  uint32_t primitiveCount;
+  uint32_t animationCount;
+  uint32_t skinCount;
+  uint32_t nodeCount;
+  uint32_t channelCount;
+  uint32_t childCount;
+  uint32_t jointCount;
+  uint32_t charCount;
+  uint32_t rootNode;
+  uint32_t padding;
+} lmdlHeader;
+
+typedef struct {
+  uint64_t offset;
+  uint64_t size;
+  uint64_t stride;
+} lmdlBuffer;
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint32_t format;
+  uint32_t mipmapCount;
+  uint64_t offset;
+  uint64_t size;
+} lmdlTexture;
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint64_t offset;
+  uint64_t size;
+} lmdlMipmap;
+
+typedef struct {
+  uint32_t name;
+  float scalars[MAX_MATERIAL_SCALARS];
+  float colors[MAX_MATERIAL_COLORS][4];
+  uint32_t textures[MAX_MATERIAL_TEXTURES];
+  uint32_t filters[MAX_MATERIAL_TEXTURES];
+  float anisotropy[MAX_MATERIAL_TEXTURES];
+  uint32_t wraps[MAX_MATERIAL_TEXTURES][3];
+} lmdlMaterial;
+
+typedef struct {
+  uint32_t offset;
+  uint32_t buffer;
+  uint32_t count;
+  uint8_t type;
+  uint8_t components;
+  uint8_t flags;
+  uint8_t padding;
+  float min[4];
+  float max[4];
+} lmdlAttribute;
+
+enum { ATTRIBUTE_NORMALIZED = 1, ATTRIBUTE_MATRIX = 2, ATTRIBUTE_MIN = 4, ATTRIBUTE_MAX = 8 };
+
+typedef struct {
+  uint32_t attributes[MAX_DEFAULT_ATTRIBUTES];
+  uint32_t indices;
+  uint32_t mode;
+  uint32_t material;
+} lmdlPrimitive;
+
+typedef struct {
+  uint32_t name;
+  uint32_t channelIndex;
+  uint32_t channelCount;
+  float duration;
+} lmdlAnimation;
+
+typedef struct {
+  uint32_t nodeIndex;
+  uint32_t property;
+  uint32_t smoothing;
+  uint32_t keyframeCount;
+  uint64_t times;
+  uint64_t data;
+} lmdlChannel;
+
+typedef struct {
+  uint32_t jointIndex;
+  uint32_t jointCount;
+  uint64_t inverseBindMatrices;
+} lmdlSkin;
+
+typedef struct {
+  uint32_t name;
+  uint32_t matrix;
+  float transform[16];
+  uint32_t childIndex;
+  uint32_t childCount;
+  uint32_t primitiveIndex;
+  uint32_t primitiveCount;
+  uint32_t skin;
+  uint32_t padding;
+} lmdlNode;
+
+typedef arr_t(char) arr_char_t;
+
+static size_t reserve(arr_char_t* out, size_t size) {
+  size_t offset = ALIGN(out->length, LMDL_ALIGN);
+  arr_reserve(out, offset + size);
+  memset(out->data + out->length, 0, offset + size - out->length);
+  out->length = offset + size;
+  return offset;
+}
+
+static size_t append(arr_char_t* out, const void* data, size_t size) {
+  size_t offset = reserve(out, size);
+  if (size > 0) memcpy(out->data + offset, data, size);
+  return offset;
+}
+
+static uint32_t writeName(arr_char_t* chars, const char* name) {
+  if (!name) return NO_NAME;
+  uint32_t offset = (uint32_t) chars->length;
+  arr_append(chars, name, strlen(name) + 1);
+  return offset;
+}
+
+static void check(Blob* source, uint64_t offset, uint64_t size) {
+  lovrAssert(offset <= source->size && size <= source->size - offset, "Model file is truncated or corrupt");
+}
+
+static const uint8_t typeSizes[] = { [I8] = 1, [U8] = 1, [I16] = 2, [U16] = 2, [I32] = 4, [U32] = 4, [F32] = 4 };
+
+// Checks that count records starting at index fit in a table of limit records, without overflowing
+static void checkRange(uint64_t index, uint64_t count, uint64_t limit) {
+  lovrAssert(index <= limit && count <= limit - index, "Model file is truncated or corrupt");
+}
+
+// Indices of ~0u mean "none" wherever they're optional
+static void checkIndex(uint32_t index, uint32_t limit, bool optional) {
+  lovrAssert(index < limit || (optional && index == ~0u), "Model file is truncated or corrupt");
+}
+
+static const char* getName(ModelData* model, uint32_t name) {
+  lovrAssert(name < model->charCount && memchr(model->chars + name, '\0', model->charCount - name), "Model file is truncated or corrupt");
+  return model->chars + name;
+}
+
+static void* section(Blob* source, size_t* cursor, size_t size) {
+  size_t offset = ALIGN(*cursor, LMDL_ALIGN);
+  check(source, offset, size);
+  *cursor = offset + size;
+  return (char*) source->data + offset;
+}
+
+#define RECORD(T, base, i) ((T*) (out.data + base) + i)
+
+bool lovrModelDataEncode(ModelData* model, const char* filename) {
+  lovrModelDataFinish(model);
+
+  arr_char_t out;
+  arr_char_t chars;
+  arr_init(&out);
+  arr_init(&chars);
+
+  size_t header = reserve(&out, sizeof(lmdlHeader));
+  size_t buffers = reserve(&out, model->bufferCount * sizeof(lmdlBuffer));
+  size_t textures = reserve(&out, model->textureCount * sizeof(lmdlTexture));
+  size_t materials = reserve(&out, model->materialCount * sizeof(lmdlMaterial));
+  size_t attributes = reserve(&out, model->attributeCount * sizeof(lmdlAttribute));
+  size_t primitives = reserve(&out, model->primitiveCount * sizeof(lmdlPrimitive));
+  size_t animations = reserve(&out, model->animationCount * sizeof(lmdlAnimation));
+  size_t channels = reserve(&out, model->channelCount * sizeof(lmdlChannel));
+  size_t skins = reserve(&out, model->skinCount * sizeof(lmdlSkin));
+  size_t nodes = reserve(&out, model->nodeCount * sizeof(lmdlNode));
+  append(&out, model->children, model->childCount * sizeof(uint32_t));
+  append(&out, model->joints, model->jointCount * sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    ModelBuffer* buffer = &model->buffers[i];
+    size_t offset = append(&out, buffer->data, buffer->size);
+    *RECORD(lmdlBuffer, buffers, i) = (lmdlBuffer) { offset, buffer->size, buffer->stride };
+  }
+
+  for (uint32_t i = 0; i < model->textureCount; i++) {
+    TextureData* texture = model->textures[i];
+    if (!texture) continue;
+    lmdlTexture record = {
+      .width = texture->width,
+      .height = texture->height,
+      .format = texture->format,
+      .mipmapCount = texture->mipmapCount
+    };
+    if (texture->mipmapCount > 0) {
+      record.offset = reserve(&out, texture->mipmapCount * sizeof(lmdlMipmap));
+      for (uint32_t j = 0; j < texture->mipmapCount; j++) {
+        Mipmap* mipmap = &texture->mipmaps[j];
+        size_t offset = append(&out, mipmap->data, mipmap->size);
+        *RECORD(lmdlMipmap, record.offset, j) = (lmdlMipmap) { mipmap->width, mipmap->height, offset, mipmap->size };
+      }
+    } else {
+      record.offset = append(&out, texture->blob->data, texture->blob->size);
+      record.size = texture->blob->size;
+    }
+    *RECORD(lmdlTexture, textures, i) = record;
+  }
+
+  for (uint32_t i = 0; i < model->materialCount; i++) {
+    ModelMaterial* material = &model->materials[i];
+    lmdlMaterial* record = RECORD(lmdlMaterial, materials, i);
+    record->name = writeName(&chars, material->name);
+    memcpy(record->scalars, material->scalars, sizeof(record->scalars));
+    memcpy(record->textures, material->textures, sizeof(record->textures));
+    for (uint32_t j = 0; j < MAX_MATERIAL_COLORS; j++) {
+      Color color = material->colors[j];
+      record->colors[j][0] = color.r;
+      record->colors[j][1] = color.g;
+      record->colors[j][2] = color.b;
+      record->colors[j][3] = color.a;
+    }
+    for (uint32_t j = 0; j < MAX_MATERIAL_TEXTURES; j++) {
+      record->filters[j] = material->filters[j].mode;
+      record->anisotropy[j] = material->filters[j].anisotropy;
+      record->wraps[j][0] = material->wraps[j].s;
+      record->wraps[j][1] = material->wraps[j].t;
+      record->wraps[j][2] = material->wraps[j].r;
+    }
+  }
+
+  for (uint32_t i = 0; i < model->attributeCount; i++) {
+    ModelAttribute* attribute = &model->attributes[i];
+    lmdlAttribute* record = RECORD(lmdlAttribute, attributes, i);
+    record->offset = attribute->offset;
+    record->buffer = attribute->buffer;
+    record->count = attribute->count;
+    record->type = attribute->type;
+    record->components = attribute->components;
+    record->flags =
+      (attribute->normalized ? ATTRIBUTE_NORMALIZED : 0) |
+      (attribute->matrix ? ATTRIBUTE_MATRIX : 0) |
+      (attribute->hasMin ? ATTRIBUTE_MIN : 0) |
+      (attribute->hasMax ? ATTRIBUTE_MAX : 0);
+    memcpy(record->min, attribute->min, sizeof(record->min));
+    memcpy(record->max, attribute->max, sizeof(record->max));
+  }
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    lmdlPrimitive* record = RECORD(lmdlPrimitive, primitives, i);
+    for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+      record->attributes[j] = primitive->attributes[j] ? (uint32_t) (primitive->attributes[j] - model->attributes) : ~0u;
+    }
+    record->indices = primitive->indices ? (uint32_t) (primitive->indices - model->attributes) : ~0u;
+    record->mode = primitive->mode;
+    record->material = primitive->material;
+  }
+
+  for (uint32_t i = 0; i < model->animationCount; i++) {
+    ModelAnimation* animation = &model->animations[i];
+    uint32_t name = writeName(&chars, animation->name);
+    uint32_t channelIndex = (uint32_t) (animation->channels - model->channels);
+    *RECORD(lmdlAnimation, animations, i) = (lmdlAnimation) { name, channelIndex, animation->channelCount, animation->duration };
+  }
+
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    ModelAnimationChannel* channel = &model->channels[i];
+    size_t components = channel->property == PROP_ROTATION ? 4 : 3;
+    size_t values = channel->keyframeCount * components * (channel->smoothing == SMOOTH_CUBIC ? 3 : 1);
+    size_t times = append(&out, channel->times, channel->keyframeCount * sizeof(float));
+    size_t data = append(&out, channel->data, values * sizeof(float));
+    *RECORD(lmdlChannel, channels, i) = (lmdlChannel) {
+      channel->nodeIndex,
+      channel->property,
+      channel->smoothing,
+      channel->keyframeCount,
+      times,
+      data
+    };
+  }
+
+  for (uint32_t i = 0; i < model->skinCount; i++) {
+    ModelSkin* skin = &model->skins[i];
+    uint32_t jointIndex = (uint32_t) (skin->joints - model->joints);
+    size_t inverseBindMatrices = append(&out, skin->inverseBindMatrices, skin->jointCount * 16 * sizeof(float));
+    *RECORD(lmdlSkin, skins, i) = (lmdlSkin) { jointIndex, skin->jointCount, inverseBindMatrices };
+  }
+
+  for (uint32_t i = 0; i < model->nodeCount; i++) {
+    ModelNode* node = &model->nodes[i];
+    lmdlNode* record = RECORD(lmdlNode, nodes, i);
+    record->name = writeName(&chars, node->name);
+    record->matrix = node->matrix;
+    memcpy(record->transform, node->transform.matrix, sizeof(record->transform));
+    record->childIndex = node->childCount > 0 ? (uint32_t) (node->children - model->children) : 0;
+    record->childCount = node->childCount;
+    record->primitiveIndex = node->primitiveIndex;
+    record->primitiveCount = node->primitiveCount;
+    record->skin = node->skin;
+  }
+
+  // The names go last, so the loader can find them from the end of the file
+  append(&out, chars.data, chars.length);
+
+  *RECORD(lmdlHeader, header, 0) = (lmdlHeader) {
+    .magic = MAGIC_LMDL,
+    .version = LMDL_VERSION,
+    .bufferCount = model->bufferCount,
+    .textureCount = model->textureCount,
+    .materialCount = model->materialCount,
+    .attributeCount = model->attributeCount,
+    .primitiveCount = model->primitiveCount,
+    .animationCount = model->animationCount,
+    .skinCount = model->skinCount,
+    .nodeCount = model->nodeCount,
+    .channelCount = model->channelCount,
+    .childCount = model->childCount,
+    .jointCount = model->jointCount,
+    .charCount = (uint32_t) chars.length,
+    .rootNode = model->rootNode
+  };
+
+  bool success = lovrFilesystemWrite(filename, out.data, out.length, false) == out.length;
+  arr_free(&chars);
+  arr_free(&out);
+  return success;
+}
+
+ModelData* lovrModelDataInitBin(ModelData* model, Blob* source, ModelDataIO* io) {
+  char* data = source->data;
+  lmdlHeader* header = source->data;
+
+  if (source->size < sizeof(lmdlHeader) || header->magic != MAGIC_LMDL) {
+    return NULL;
+  }
+
+  lovrAssert(header->version == LMDL_VERSION, "Model file version %d is not supported (expected %d)", header->version, LMDL_VERSION);
+
+  size_t cursor = 0;
+  section(source, &cursor, sizeof(lmdlHeader));
+  lmdlBuffer* buffers = section(source, &cursor, header->bufferCount * sizeof(lmdlBuffer));
+  lmdlTexture* textures = section(source, &cursor, header->textureCount * sizeof(lmdlTexture));
+  lmdlMaterial* materials = section(source, &cursor, header->materialCount * sizeof(lmdlMaterial));
+  lmdlAttribute* attributes = section(source, &cursor, header->attributeCount * sizeof(lmdlAttribute));
+  lmdlPrimitive* primitives = section(source, &cursor, header->primitiveCount * sizeof(lmdlPrimitive));
+  lmdlAnimation* animations = section(source, &cursor, header->animationCount * sizeof(lmdlAnimation));
+  lmdlChannel* channels = section(source, &cursor, header->channelCount * sizeof(lmdlChannel));
+  lmdlSkin* skins = section(source, &cursor, header->skinCount * sizeof(lmdlSkin));
+  lmdlNode* nodes = section(source, &cursor, header->nodeCount * sizeof(lmdlNode));
+  uint32_t* children = section(source, &cursor, header->childCount * sizeof(uint32_t));
+  uint32_t* joints = section(source, &cursor, header->jointCount * sizeof(uint32_t));
+
+  check(source, cursor, header->charCount);
+  const char* chars = data + source->size - header->charCount;
+
+  model->blobCount = 1;
+  model->bufferCount = header->bufferCount;
+  model->textureCount = header->textureCount;
+  model->materialCount = header->materialCount;
+  model->attributeCount = header->attributeCount;
+  model->primitiveCount = header->primitiveCount;
+  model->animationCount = header->animationCount;
+  model->skinCount = header->skinCount;
+  model->nodeCount = header->nodeCount;
+  model->channelCount = header->channelCount;
+  model->childCount = header->childCount;
+  model->jointCount = header->jointCount;
+  model->charCount = header->charCount;
+  lovrModelDataAllocate(model);
+
+  lovrRetain(source);
+  model->blobs[0] = source;
+  model->rootNode = header->rootNode;
+  memcpy(model->children, children, model->childCount * sizeof(uint32_t));
+  memcpy(model->joints, joints, model->jointCount * sizeof(uint32_t));
+  memcpy(model->chars, chars, model->charCount);
+
+  if (model->nodeCount > 0) {
+    checkIndex(model->rootNode, model->nodeCount, false);
+  }
+
+  for (uint32_t i = 0; i < model->childCount; i++) {
+    checkIndex(model->children[i], model->nodeCount, false);
+  }
+
+  for (uint32_t i = 0; i < model->jointCount; i++) {
+    checkIndex(model->joints[i], model->nodeCount, false);
+  }
+
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    check(source, buffers[i].offset, buffers[i].size);
+    model->buffers[i] = (ModelBuffer) {
+      .data = data + buffers[i].offset,
+      .size = buffers[i].size,
+      .stride = buffers[i].stride
+    };
+  }
+
+  for (uint32_t i = 0; i < model->textureCount; i++) {
+    lmdlTexture* record = &textures[i];
+    if (record->width == 0) continue;
+    lovrAssert(record->format <= FORMAT_ASTC_12x12, "Model file is truncated or corrupt");
+    if (record->mipmapCount == 0) {
+      check(source, record->offset, record->size);
+      Blob pixels = { .data = data + record->offset, .size = record->size };
+      model->textures[i] = lovrTextureDataCreate(record->width, record->height, &pixels, 0x0, record->format);
+    } else {
+      check(source, record->offset, record->mipmapCount * sizeof(lmdlMipmap));
+      lmdlMipmap* mipmaps = (lmdlMipmap*) (data + record->offset);
+      TextureData* texture = model->textures[i] = lovrAlloc(TextureData);
+      texture->blob = lovrAlloc(Blob);
+      texture->width = record->width;
+      texture->height = record->height;
+      texture->format = record->format;
+      texture->mipmapCount = record->mipmapCount;
+      texture->mipmaps = malloc(record->mipmapCount * sizeof(Mipmap));
+      lovrAssert(texture->mipmaps, "Out of memory");
+      texture->source = source;
+      lovrRetain(source);
+      for (uint32_t j = 0; j < record->mipmapCount; j++) {
+        check(source, mipmaps[j].offset, mipmaps[j].size);
+        texture->mipmaps[j] = (Mipmap) {
+          .width = mipmaps[j].width,
+          .height = mipmaps[j].height,
+          .size = mipmaps[j].size,
+          .data = data + mipmaps[j].offset
+        };
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < model->materialCount; i++) {
+    lmdlMaterial* record = &materials[i];
+    ModelMaterial* material = &model->materials[i];
+    memcpy(material->scalars, record->scalars, sizeof(material->scalars));
+    memcpy(material->textures, record->textures, sizeof(material->textures));
+    for (uint32_t j = 0; j < MAX_MATERIAL_COLORS; j++) {
+      material->colors[j] = (Color) { record->colors[j][0], record->colors[j][1], record->colors[j][2], record->colors[j][3] };
+    }
+    for (uint32_t j = 0; j < MAX_MATERIAL_TEXTURES; j++) {
+      checkIndex(material->textures[j], model->textureCount, true);
+      lovrAssert(record->filters[j] <= FILTER_TRILINEAR, "Model file is truncated or corrupt");
+      lovrAssert(record->wraps[j][0] <= WRAP_MIRRORED_REPEAT && record->wraps[j][1] <= WRAP_MIRRORED_REPEAT && record->wraps[j][2] <= WRAP_MIRRORED_REPEAT, "Model file is truncated or corrupt");
+
+      // Textures that were missing when the file was written are stored empty, so drop references to them
+      if (material->textures[j] != ~0u && !model->textures[material->textures[j]]) {
+        material->textures[j] = ~0u;
+      }
+
+      material->filters[j] = (TextureFilter) { record->filters[j], record->anisotropy[j] };
+      material->wraps[j] = (TextureWrap) { record->wraps[j][0], record->wraps[j][1], record->wraps[j][2] };
+    }
+    if (record->name != NO_NAME) {
+      material->name = getName(model, record->name);
+      map_set(&model->materialMap, hash64(material->name, strlen(material->name)), i);
+    }
+  }
+
+  for (uint32_t i = 0; i < model->attributeCount; i++) {
+    lmdlAttribute* record = &attributes[i];
+    checkIndex(record->buffer, model->bufferCount, false);
+    lovrAssert(record->type <= F32 && record->components >= 1 && record->components <= 4, "Model file is truncated or corrupt");
+
+    // The last element has to end inside the buffer, matrices are components^2 values per element
+    ModelBuffer* buffer = &model->buffers[record->buffer];
+    uint64_t size = (uint64_t) typeSizes[record->type] * record->components * (record->flags & ATTRIBUTE_MATRIX ? record->components : 1);
+    uint64_t stride = buffer->stride ? buffer->stride : size;
+    if (record->count > 0) {
+      checkRange(record->offset, size, buffer->size);
+      lovrAssert(record->count - 1 <= (buffer->size - record->offset - size) / stride, "Model file is truncated or corrupt");
+    }
+    model->attributes[i] = (ModelAttribute) {
+      .offset = record->offset,
+      .buffer = record->buffer,
+      .count = record->count,
+      .type = record->type,
+      .components = record->components,
+      .normalized = !!(record->flags & ATTRIBUTE_NORMALIZED),
+      .matrix = !!(record->flags & ATTRIBUTE_MATRIX),
+      .hasMin = !!(record->flags & ATTRIBUTE_MIN),
+      .hasMax = !!(record->flags & ATTRIBUTE_MAX)
+    };
+    memcpy(model->attributes[i].min, record->min, sizeof(record->min));
+    memcpy(model->attributes[i].max, record->max, sizeof(record->max));
+  }
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    lmdlPrimitive* record = &primitives[i];
+    ModelPrimitive* primitive = &model->primitives[i];
+    for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+      primitive->attributes[j] = record->attributes[j] < model->attributeCount ? &model->attributes[record->attributes[j]] : NULL;
+    }
+    primitive->indices = record->indices < model->attributeCount ? &model->attributes[record->indices] : NULL;
+    lovrAssert(record->mode <= DRAW_TRIANGLE_FAN, "Model file is truncated or corrupt");
+    checkIndex(record->material, model->materialCount, true);
+    primitive->mode = record->mode;
+    primitive->material = record->material;
+  }
+
+  for (uint32_t i = 0; i < model->animationCount; i++) {
+    lmdlAnimation* record = &animations[i];
+    ModelAnimation* animation = &model->animations[i];
+    checkRange(record->channelIndex, record->channelCount, model->channelCount);
+    animation->channels = model->channels + record->channelIndex;
+    animation->channelCount = record->channelCount;
+    animation->duration = record->duration;
+    if (record->name != NO_NAME) {
+      animation->name = getName(model, record->name);
+      map_set(&model->animationMap, hash64(animation->name, strlen(animation->name)), i);
+    }
+  }
+
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    lmdlChannel* record = &channels[i];
+    checkIndex(record->nodeIndex, model->nodeCount, false);
+    lovrAssert(record->property <= PROP_SCALE && record->smoothing <= SMOOTH_CUBIC, "Model file is truncated or corrupt");
+    size_t components = record->property == PROP_ROTATION ? 4 : 3;
+    size_t values = record->keyframeCount * components * (record->smoothing == SMOOTH_CUBIC ? 3 : 1);
+    check(source, record->times, record->keyframeCount * sizeof(float));
+    check(source, record->data, values * sizeof(float));
+    model->channels[i] = (ModelAnimationChannel) {
+      .nodeIndex = record->nodeIndex,
+      .property = record->property,
+      .smoothing = record->smoothing,
+      .keyframeCount = record->keyframeCount,
+      .times = (float*) (data + record->times),
+      .data = (float*) (data + record->data)
+    };
+  }
+
+  for (uint32_t i = 0; i < model->skinCount; i++) {
+    lmdlSkin* record = &skins[i];
+    checkRange(record->jointIndex, record->jointCount, model->jointCount);
+    check(source, record->inverseBindMatrices, record->jointCount * 16 * sizeof(float));
+    model->skins[i] = (ModelSkin) {
+      .joints = model->joints + record->jointIndex,
+      .jointCount = record->jointCount,
+      .inverseBindMatrices = (float*) (data + record->inverseBindMatrices)
+    };
+  }
+
+  for (uint32_t i = 0; i < model->nodeCount; i++) {
+    lmdlNode* record = &nodes[i];
+    ModelNode* node = &model->nodes[i];
+    checkRange(record->childIndex, record->childCount, model->childCount);
+    checkRange(record->primitiveIndex, record->primitiveCount, model->primitiveCount);
+    checkIndex(record->skin, model->skinCount, true);
+    memcpy(node->transform.matrix, record->transform, sizeof(record->transform));
+    node->matrix = record->matrix;
+    node->children = model->children + record->childIndex;
+    node->childCount = record->childCount;
+    node->primitiveIndex = record->primitiveIndex;
+    node->primitiveCount = record->primitiveCount;
+    node->skin = record->skin;
+    if (record->name != NO_NAME) {
+      node->name = getName(model, record->name);
+      map_set(&model->nodeMap, hash64(node->name, strlen(node->name)), i);
+    }
+  }
+
+  return model;
+}
@@ -181,29 +181,29 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
     binOffset = 0;
   }
 
-  // Parse JSON
+  // Parse JSON.  jsmn can count tokens without storing them, so do that first and then allocate
+  // exactly enough tokens instead of growing the array and reparsing on JSMN_ERROR_NOMEM.
   jsmn_parser parser;
   jsmn_init(&parser);
 
   jsmntok_t stackTokens[MAX_STACK_TOKENS];
   jsmntok_t* heapTokens = NULL;
   jsmntok_t* tokens = &stackTokens[0];
-  int tokenCount = 0;
+  int tokenCount = jsmn_parse(&parser, json, jsonLength, NULL, 0);
 
-  if ((tokenCount = jsmn_parse(&parser, json, jsonLength, stackTokens, MAX_STACK_TOKENS)) == JSMN_ERROR_NOMEM) {
-    int capacity = MAX_STACK_TOKENS;
-    jsmn_init(&parser); // This shouldn't be necessary but not doing it caused an infinite loop?
-
-    do {
-      capacity *= 2;
-      heapTokens = realloc(heapTokens, capacity * sizeof(jsmntok_t));
-      lovrAssert(heapTokens, "Out of memory");
-      tokenCount = jsmn_parse(&parser, json, jsonLength, heapTokens, capacity);
-    } while (tokenCount == JSMN_ERROR_NOMEM);
+  if (tokenCount <= 0) {
+    return NULL;
+  }
 
+  if (tokenCount > MAX_STACK_TOKENS) {
+    heapTokens = malloc(tokenCount * sizeof(jsmntok_t));
+    lovrAssert(heapTokens, "Out of memory");
     tokens = heapTokens;
   }
 
+  jsmn_init(&parser);
+  tokenCount = jsmn_parse(&parser, json, jsonLength, tokens, tokenCount);
+
   if (tokenCount <= 0 || tokens[0].type != JSMN_OBJECT) {
     free(heapTokens);
     return NULL;
@@ -524,6 +524,38 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
     }
   }
 
+  // Textures (glTF images).  The encoded images are read here and decoded on worker threads while
+  // the rest of the file is parsed, then joined at the end with lovrModelDataFinish.
+  if (model->textureCount > 0) {
+    ModelImage* images = calloc(model->textureCount, sizeof(ModelImage));
+    lovrAssert(images, "Out of memory");
+    jsmntok_t* token = info.images;
+    ModelImage* image = images;
+    for (int i = (token++)->size; i > 0; i--, image++) {
+      for (int k = (token++)->size; k > 0; k--) {
+        gltfString key = NOM_STR(json, token);
+        if (STR_EQ(key, "bufferView")) {
+          ModelBuffer* buffer = &model->buffers[NOM_INT(json, token)];
+          image->blob = lovrBlobCreate(buffer->data, buffer->size, NULL);
+          image->borrowed = true;
+        } else if (STR_EQ(key, "uri")) {
+          size_t size = 0;
+          gltfString uri = NOM_STR(json, token);
+          lovrAssert(uri.length < 5 || strncmp("data:", uri.data, 5), "Base64 images aren't supported yet");
+          lovrAssert(uri.length < maxPathLength, "Image filename is too long");
+          strncat(filename, uri.data, uri.length);
+          void* data = io(filename, &size);
+          lovrAssert(data && size > 0, "Unable to read texture from '%s'", filename);
+          image->blob = lovrBlobCreate(data, size, NULL);
+          *root = '\0';
+        } else {
+          token += NOM_VALUE(json, token);
+        }
+      }
+    }
+    lovrModelDataDecodeImages(model, images);
+  }
+
   // Attributes
   if (model->attributeCount > 0) {
     jsmntok_t* token = info.attributes;
@@ -650,38 +682,6 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
     }
   }
 
-  // Textures (glTF images)
-  if (model->textureCount > 0) {
-    jsmntok_t* token = info.images;
-    TextureData** texture = model->textures;
-    for (int i = (token++)->size; i > 0; i--, texture++) {
-      for (int k = (token++)->size; k > 0; k--) {
-        gltfString key = NOM_STR(json, token);
-        if (STR_EQ(key, "bufferView")) {
-          ModelBuffer* buffer = &model->buffers[NOM_INT(json, token)];
-          Blob* blob = lovrBlobCreate(buffer->data, buffer->size, NULL);
-          *texture = lovrTextureDataCreateFromBlob(blob, false);
-          blob->data = NULL; // XXX Blob data ownership
-          lovrRelease(Blob, blob);
-        } else if (STR_EQ(key, "uri")) {
-          size_t size = 0;
-          gltfString uri = NOM_STR(json, token);
-          lovrAssert(uri.length < 5 || strncmp("data:", uri.data, 5), "Base64 images aren't supported yet");
-          lovrAssert(uri.length < maxPathLength, "Image filename is too long");
-          strncat(filename, uri.data, uri.length);
-          void* data = io(filename, &size);
-          lovrAssert(data && size > 0, "Unable to read texture from '%s'", filename);
-          Blob* blob = lovrBlobCreate(data, size, NULL);
-          *texture = lovrTextureDataCreateFromBlob(blob, false);
-          lovrRelease(Blob, blob);
-          *root = '\0';
-        } else {
-          token += NOM_VALUE(json, token);
-        }
-      }
-    }
-  }
-
   // Materials
   if (model->materialCount > 0) {
     jsmntok_t* token = info.materials;
@@ -930,5 +930,6 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
   free(textures);
   free(scenes);
   free(heapTokens);
+  lovrModelDataFinish(model);
   return model;
 }
@@ -2,31 +2,136 @@
 #include "data/blob.h"
 #include "data/textureData.h"
 #include "core/arr.h"
+#include "core/job.h"
 #include "core/maf.h"
 #include "core/map.h"
 #include "core/ref.h"
 #include "core/util.h"
 #include <stdlib.h>
 #include <float.h>
-#include <ctype.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+// The OBJ is split into chunks at line boundaries that are parsed in parallel.  Each chunk collects
+// its own vertex data and dedups its own face vertices, then a serial merge step resolves the chunk
+// vertices against a global dedup map and processes material statements in file order.
+
+#define OBJ_CHUNK_SIZE (1 << 22)
+#define MAX_OBJ_CHUNKS 64
+#define MAX_OBJ_WORKERS 8
 
 typedef struct {
   uint32_t material;
-  int start;
-  int count;
+  uint32_t start;
 } objGroup;
 
+typedef struct {
+  int32_t index[3];
+  uint32_t flags;
+} objVertex;
+
+enum {
+  OBJ_RELATIVE = 0x1,
+  OBJ_PRESENT = 0x10
+};
+
+typedef struct {
+  const char* name;
+  size_t length;
+  uint32_t offset;
+  bool library;
+} objEvent;
+
+typedef struct {
+  const char* start;
+  const char* end;
+  arr_t(float) positions;
+  arr_t(float) normals;
+  arr_t(float) uvs;
+  arr_t(objVertex) vertices;
+  arr_t(uint32_t) indices;
+  arr_t(objEvent) events;
+  map_t vertexMap;
+  uint32_t* remap;
+  uint32_t* output;
+} objChunk;
+
 typedef arr_t(ModelMaterial) arr_material_t;
 typedef arr_t(TextureData*) arr_texturedata_t;
 typedef arr_t(objGroup) arr_group_t;
 
 #define STARTS_WITH(a, b) !strncmp(a, b, strlen(b))
 
-static uint32_t nomu32(char* s, char** end) {
-  uint32_t n = 0;
-  while (isdigit(*s)) { n = 10 * n + (*s++ - '0'); }
-  *end = s;
-  return n;
+static const double powersOf10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Parses a decimal float without strtof's locale handling or the need for a null terminator.  Up to
+// 19 significant digits are accumulated in an integer, which is plenty for single precision output.
+static float parseFloat(const char* s, const char* end, const char** next) {
+  while (s < end && (*s == ' ' || *s == '\t')) s++;
+
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+')) {
+    negative = *s++ == '-';
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+
+  for (; s < end && *s >= '0' && *s <= '9'; s++) {
+    if (digits < 19) {
+      mantissa = 10 * mantissa + (*s - '0');
+      digits += mantissa > 0;
+    } else {
+      exponent++;
+    }
+  }
+
+  if (s < end && *s == '.') {
+    for (s++; s < end && *s >= '0' && *s <= '9'; s++) {
+      if (digits < 19) {
+        mantissa = 10 * mantissa + (*s - '0');
+        digits += mantissa > 0;
+        exponent--;
+      }
+    }
+  }
+
+  if (s < end && (*s == 'e' || *s == 'E')) {
+    bool negativeExponent = false;
+    int e = 0;
+    s++;
+    if (s < end && (*s == '-' || *s == '+')) {
+      negativeExponent = *s++ == '-';
+    }
+    for (; s < end && *s >= '0' && *s <= '9'; s++) {
+      e = MIN(10 * e + (*s - '0'), 1000);
+    }
+    exponent += negativeExponent ? -e : e;
+  }
+
+  double value = (double) mantissa;
+  while (exponent > 22) value *= 1e22, exponent -= 22;
+  while (exponent < -22) value /= 1e22, exponent += 22;
+  value = exponent < 0 ? value / powersOf10[-exponent] : value * powersOf10[exponent];
+
+  *next = s;
+  return (float) (negative ? -value : value);
+}
+
+static const char* parseIndex(const char* s, const char* end, int32_t* index) {
+  bool negative = s < end && *s == '-';
+  s += negative;
+  int32_t n = 0;
+  while (s < end && *s >= '0' && *s <= '9') {
+    n = 10 * n + (*s++ - '0');
+  }
+  *index = negative ? -n : n;
+  return s;
 }
 
 static void parseMtl(char* path, char* base, ModelDataIO* io, arr_texturedata_t* textures, arr_material_t* materials, map_t* names) {
@@ -58,10 +163,10 @@ static void parseMtl(char* path, char* base, ModelDataIO* io, arr_texturedata_t*
       memset(&materials->data[materials->length - 1].textures, 0xff, MAX_MATERIAL_TEXTURES * sizeof(int));
     } else if (line[0] == 'K' && line[1] == 'd' && line[2] == ' ') {
       float r, g, b;
-      char* s = line + 3;
-      r = strtof(s, &s);
-      g = strtof(s, &s);
-      b = strtof(s, &s);
+      const char* s = line + 3;
+      r = parseFloat(s, line + length, &s);
+      g = parseFloat(s, line + length, &s);
+      b = parseFloat(s, line + length, &s);
       ModelMaterial* material = &materials->data[materials->length - 1];
       material->colors[COLOR_DIFFUSE] = (Color) { r, g, b, 1.f };
     } else if (STARTS_WITH(line, "map_Kd ")) {
@@ -93,15 +198,187 @@ static void parseMtl(char* path, char* base, ModelDataIO* io, arr_texturedata_t*
   free(p);
 }
 
+typedef struct {
+  jmp_buf env;
+  char* error;
+  size_t size;
+} objCatch;
+
+static void onMtlError(void* userdata, const char* format, va_list args) {
+  objCatch* c = userdata;
+  vsnprintf(c->error, c->size, format, args);
+  longjmp(c->env, 1);
+}
+
+// Errors in mtl files are caught here so the OBJ loader can free its buffers before rethrowing
+static bool loadMtl(char* path, char* base, ModelDataIO* io, arr_texturedata_t* textures, arr_material_t* materials, map_t* names, char* error, size_t size) {
+  objCatch c = { .error = error, .size = size };
+  errorFn* parent = lovrErrorCallback;
+  void* parentUserdata = lovrErrorUserdata;
+  lovrSetErrorCallback(onMtlError, &c);
+
+  if (setjmp(c.env)) {
+    lovrSetErrorCallback(parent, parentUserdata);
+    return false;
+  }
+
+  parseMtl(path, base, io, textures, materials, names);
+  lovrSetErrorCallback(parent, parentUserdata);
+  return true;
+}
+
+// Negative indices count backwards from the most recent element, which is only known relative to the
+// start of the chunk.  They get flagged and resolved once the merge knows how much data came before.
+static void resolveIndex(objVertex* vertex, uint32_t slot, int32_t index, size_t count) {
+  if (index > 0) {
+    vertex->index[slot] = index - 1;
+    vertex->flags |= OBJ_PRESENT << slot;
+  } else if (index < 0) {
+    vertex->index[slot] = (int32_t) count + index;
+    vertex->flags |= (OBJ_PRESENT | OBJ_RELATIVE) << slot;
+  }
+}
+
+// hash64 goes a byte at a time, this mixes the whole vertex in a few multiplies
+static uint64_t hashVertex(const uint32_t* v) {
+  uint64_t a = ((uint64_t) v[0] << 32 | v[1]) * 0x9e3779b97f4a7c15ull;
+  uint64_t b = ((uint64_t) v[2] << 32 | v[3]) * 0xc2b2ae3d27d4eb4full;
+  uint64_t h = a ^ (b + (a >> 29));
+  h = (h ^ (h >> 32)) * 0xd6e8feb86659fd93ull;
+  return h ^ (h >> 32);
+}
+
+static uint32_t addVertex(objChunk* chunk, objVertex* vertex) {
+  uint64_t hash = hashVertex((const uint32_t*) vertex);
+  uint64_t index = map_get(&chunk->vertexMap, hash);
+  if (index == MAP_NIL) {
+    index = chunk->vertices.length;
+    map_set(&chunk->vertexMap, hash, index);
+    arr_push(&chunk->vertices, *vertex);
+  }
+  return (uint32_t) index;
+}
+
+static void parseChunk(void* context, uint32_t index) {
+  objChunk* chunk = (objChunk*) context + index;
+  const char* data = chunk->start;
+  const char* end = chunk->end;
+
+  // Presizing the dedup map avoids most of the rehashing, a face vertex takes up around 64 bytes
+  map_init(&chunk->vertexMap, (uint32_t) ((end - data) / 64));
+
+  while (data < end) {
+    const char* newline = memchr(data, '\n', end - data);
+    const char* next = newline ? newline + 1 : end;
+    const char* lineEnd = newline ? newline : end;
+    while (data < lineEnd && (*data == ' ' || *data == '\t')) data++;
+    while (lineEnd > data && (lineEnd[-1] == '\r' || lineEnd[-1] == '\t' || lineEnd[-1] == ' ')) lineEnd--;
+    size_t length = lineEnd - data;
+    const char* s = data;
+    data = next;
+
+    if (length < 2) {
+      continue;
+    } else if (s[0] == 'v' && s[1] == ' ') {
+      float v[3];
+      s += 2;
+      v[0] = parseFloat(s, lineEnd, &s);
+      v[1] = parseFloat(s, lineEnd, &s);
+      v[2] = parseFloat(s, lineEnd, &s);
+      arr_append(&chunk->positions, v, 3);
+    } else if (length > 2 && s[0] == 'v' && s[1] == 'n' && s[2] == ' ') {
+      float vn[3];
+      s += 3;
+      vn[0] = parseFloat(s, lineEnd, &s);
+      vn[1] = parseFloat(s, lineEnd, &s);
+      vn[2] = parseFloat(s, lineEnd, &s);
+      arr_append(&chunk->normals, vn, 3);
+    } else if (length > 2 && s[0] == 'v' && s[1] == 't' && s[2] == ' ') {
+      float vt[2];
+      s += 3;
+      vt[0] = parseFloat(s, lineEnd, &s);
+      vt[1] = parseFloat(s, lineEnd, &s);
+      arr_append(&chunk->uvs, vt, 2);
+    } else if (s[0] == 'f' && s[1] == ' ') {
+      uint32_t first = 0;
+      uint32_t previous = 0;
+      uint32_t count = 0;
+      s += 2;
+
+      // Faces with more than 3 vertices are triangulated as a fan
+      for (;;) {
+        while (s < lineEnd && (*s == ' ' || *s == '\t')) s++;
+        if (s >= lineEnd) break;
+
+        int32_t v = 0, vt = 0, vn = 0;
+        s = parseIndex(s, lineEnd, &v);
+        if (s < lineEnd && *s == '/') {
+          if (++s < lineEnd && *s != '/') {
+            s = parseIndex(s, lineEnd, &vt);
+          }
+          if (s < lineEnd && *s == '/') {
+            s = parseIndex(s + 1, lineEnd, &vn);
+          }
+        }
+        while (s < lineEnd && *s != ' ' && *s != '\t') s++;
+
+        objVertex vertex = { .index = { -1, -1, -1 } };
+        resolveIndex(&vertex, 0, v, chunk->positions.length / 3);
+        resolveIndex(&vertex, 1, vt, chunk->uvs.length / 2);
+        resolveIndex(&vertex, 2, vn, chunk->normals.length / 3);
+        uint32_t index = addVertex(chunk, &vertex);
+
+        if (count == 0) {
+          first = index;
+        } else if (count >= 2) {
+          arr_push(&chunk->indices, first);
+          arr_push(&chunk->indices, previous);
+          arr_push(&chunk->indices, index);
+        }
+
+        previous = index;
+        count++;
+      }
+    } else if (length > 7 && (!strncmp(s, "mtllib ", 7) || !strncmp(s, "usemtl ", 7))) {
+      arr_push(&chunk->events, ((objEvent) {
+        .name = s + 7,
+        .length = length - 7,
+        .offset = (uint32_t) chunk->indices.length,
+        .library = s[0] == 'm'
+      }));
+    }
+  }
+}
+
+static void remapChunk(void* context, uint32_t index) {
+  objChunk* chunk = (objChunk*) context + index;
+  for (size_t i = 0; i < chunk->indices.length; i++) {
+    chunk->output[i] = chunk->remap[chunk->indices.data[i]];
+  }
+}
+
+static void freeChunks(objChunk* chunks, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    arr_free(&chunks[i].positions);
+    arr_free(&chunks[i].normals);
+    arr_free(&chunks[i].uvs);
+    arr_free(&chunks[i].vertices);
+    arr_free(&chunks[i].indices);
+    arr_free(&chunks[i].events);
+    map_free(&chunks[i].vertexMap);
+    free(chunks[i].remap);
+  }
+}
+
 ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io) {
-  char* data = (char*) source->data;
-  size_t size = source->size;
+  const char* data = (const char*) source->data;
+  const char* end = data + source->size;
 
   arr_group_t groups;
   arr_texturedata_t textures;
   arr_material_t materials;
   arr_t(float) vertexBlob;
-  arr_t(int) indexBlob;
+  arr_t(uint32_t) indexBlob;
   map_t materialMap;
   map_t vertexMap;
   arr_t(float) positions;
@@ -114,7 +391,6 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   map_init(&materialMap, 0);
   arr_init(&vertexBlob);
   arr_init(&indexBlob);
-  map_init(&vertexMap, 0);
   arr_init(&positions);
   arr_init(&normals);
   arr_init(&uvs);
@@ -131,116 +407,167 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   size_t baseLength = base - path;
   *base = '\0';
 
-  while (size > 0) {
-    while (size > 0 && (*data == ' ' || *data == '\t')) data++, size--;
-    char* newline = memchr(data, '\n', size);
-    if (*data == '#') goto next;
+  // Split the file into chunks, each ending on a line boundary
+  objChunk chunks[MAX_OBJ_CHUNKS];
+  uint32_t chunkCount = 0;
+  size_t chunkSize = MAX(OBJ_CHUNK_SIZE, source->size / MAX_OBJ_CHUNKS + 1);
+  while (data < end) {
+    const char* chunkEnd = end - data > (ptrdiff_t) chunkSize ? data + chunkSize : end;
+    const char* newline = memchr(chunkEnd - 1, '\n', end - chunkEnd + 1);
+    chunkEnd = newline ? newline + 1 : end;
+    objChunk* chunk = &chunks[chunkCount++];
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->start = data;
+    chunk->end = chunkEnd;
+    arr_init(&chunk->positions);
+    arr_init(&chunk->normals);
+    arr_init(&chunk->uvs);
+    arr_init(&chunk->vertices);
+    arr_init(&chunk->indices);
+    arr_init(&chunk->events);
+    data = chunkEnd;
+  }
 
-    char line[1024];
-    size_t length = newline ? newline - data : size;
-    while (length > 0 && (data[length - 1] == '\r' || data[length - 1] == '\t' || data[length - 1] == ' ')) length--;
-    lovrAssert(length < sizeof(line), "OBJ line length is too long (max is %d)", sizeof(line) - 1);
-    memcpy(line, data, length);
-    line[length] = '\0';
+  char error[256];
+  job_batch* batch = job_start(parseChunk, chunks, chunkCount, MAX_OBJ_WORKERS);
+  if (!job_wait(batch, error, sizeof(error))) {
+    freeChunks(chunks, chunkCount);
+    lovrThrow("%s", error);
+  }
 
-    if (line[0] == 'v' && line[1] == ' ') {
-      float v[3];
-      char* s = line + 2;
-      v[0] = strtof(s, &s);
-      v[1] = strtof(s, &s);
-      v[2] = strtof(s, &s);
-      arr_append(&positions, v, 3);
-    } else if (line[0] == 'v' && line[1] == 'n' && line[2] == ' ') {
-      float vn[3];
-      char* s = line + 3;
-      vn[0] = strtof(s, &s);
-      vn[1] = strtof(s, &s);
-      vn[2] = strtof(s, &s);
-      arr_append(&normals, vn, 3);
-    } else if (line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
-      float vt[2];
-      char* s = line + 3;
-      vt[0] = strtof(s, &s);
-      vt[1] = strtof(s, &s);
-      arr_append(&uvs, vt, 2);
-    } else if (line[0] == 'f' && line[1] == ' ') {
-      char* s = line + 2;
-      for (size_t i = 0; i < 3; i++) {
-
-        // Find first number/slash
-        while (*s && !(*s >= '/' && *s <= '9')) s++;
-
-        // Find next non-number/non-slash
-        char* t = s;
-        while (*t && *t >= '/' && *t <= '9') t++;
-
-        // If the vertex already exists, add its index and skip
-        uint64_t hash = hash64(s, t - s);
-        uint64_t index = map_get(&vertexMap, hash);
-        if (index != MAP_NIL) {
-          arr_push(&indexBlob, index);
-          s = t;
-          continue;
-        }
+  // Merge the vertex data
+  size_t positionBase[MAX_OBJ_CHUNKS];
+  size_t normalBase[MAX_OBJ_CHUNKS];
+  size_t uvBase[MAX_OBJ_CHUNKS];
+  for (uint32_t i = 0; i < chunkCount; i++) {
+    positionBase[i] = positions.length / 3;
+    normalBase[i] = normals.length / 3;
+    uvBase[i] = uvs.length / 2;
+    arr_append(&positions, chunks[i].positions.data, chunks[i].positions.length);
+    arr_append(&normals, chunks[i].normals.data, chunks[i].normals.length);
+    arr_append(&uvs, chunks[i].uvs.data, chunks[i].uvs.length);
+  }
 
-        uint32_t v = 0;
-        uint32_t vt = 0;
-        uint32_t vn = 0;
-        v = nomu32(s, &s);
-        lovrAssert(v > 0, "Bad OBJ: Expected positive number for face vertex position index");
-
-        // Handle v//vn, v/vt, v/vt/vtn, and v
-        if (s[0] == '/') {
-          if (s[1] == '/') {
-            vn = nomu32(s + 2, &s);
-          } else {
-            vt = nomu32(s + 1, &s);
-            if (s[0] == '/') {
-              vn = nomu32(s + 1, &s);
-            }
-          }
+  // Resolve each chunk's unique vertices against the global dedup map
+  size_t vertexCount = 0;
+  for (uint32_t i = 0; i < chunkCount; i++) {
+    vertexCount += chunks[i].vertices.length;
+  }
+
+  map_init(&vertexMap, (uint32_t) vertexCount);
+  arr_reserve(&vertexBlob, 8 * vertexCount);
+
+  const char* message = NULL;
+  size_t indexCount = 0;
+  float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (uint32_t i = 0; i < chunkCount; i++) {
+    objChunk* chunk = &chunks[i];
+    chunk->remap = malloc(chunk->vertices.length * sizeof(uint32_t));
+    if (!chunk->remap && chunk->vertices.length > 0) {
+      message = "Out of memory";
+      break;
+    }
+
+    for (size_t j = 0; j < chunk->vertices.length; j++) {
+      objVertex* vertex = &chunk->vertices.data[j];
+      size_t bases[3] = { positionBase[i], uvBase[i], normalBase[i] };
+      size_t counts[3] = { positions.length / 3, uvs.length / 2, normals.length / 3 };
+      uint32_t resolved[3];
+
+      for (uint32_t k = 0; k < 3 && !message; k++) {
+        if (vertex->flags & (OBJ_PRESENT << k)) {
+          int64_t index = vertex->index[k] + ((vertex->flags & (OBJ_RELATIVE << k)) ? (int64_t) bases[k] : 0);
+          if (index < 0 || (size_t) index >= counts[k]) message = "Bad OBJ: Face vertex index is out of range";
+          resolved[k] = (uint32_t) index;
+        } else {
+          if (k == 0) message = "Bad OBJ: Expected positive number for face vertex position index";
+          resolved[k] = ~0u;
         }
+      }
 
-        float empty[3] = { 0.f };
-        arr_push(&indexBlob, vertexBlob.length / 8);
-        map_set(&vertexMap, hash, vertexBlob.length / 8);
-        arr_append(&vertexBlob, positions.data + 3 * (v - 1), 3);
-        arr_append(&vertexBlob, vn > 0 ? (normals.data + 3 * (vn - 1)) : empty, 3);
-        arr_append(&vertexBlob, vt > 0 ? (uvs.data + 2 * (vt - 1)) : empty, 2);
+      if (message) {
+        break;
+      }
 
-        s = t;
+      uint64_t hash = hashVertex((const uint32_t[4]) { resolved[0], resolved[1], resolved[2], 0 });
+      uint64_t index = map_get(&vertexMap, hash);
+      if (index == MAP_NIL) {
+        float empty[3] = { 0.f };
+        float* position = positions.data + 3 * resolved[0];
+        index = vertexBlob.length / 8;
+        map_set(&vertexMap, hash, index);
+        arr_append(&vertexBlob, position, 3);
+        arr_append(&vertexBlob, resolved[2] != ~0u ? (normals.data + 3 * resolved[2]) : empty, 3);
+        arr_append(&vertexBlob, resolved[1] != ~0u ? (uvs.data + 2 * resolved[1]) : empty, 2);
+        for (uint32_t k = 0; k < 3; k++) {
+          min[k] = MIN(min[k], position[k]);
+          max[k] = MAX(max[k], position[k]);
+        }
       }
-      groups.data[groups.length - 1].count += 3;
-    } else if (STARTS_WITH(line, "mtllib ")) {
-      const char* filename = line + 7;
-      size_t filenameLength = strlen(filename);
-      lovrAssert(baseLength + filenameLength < sizeof(path), "Bad OBJ: Material filename is too long");
-      memcpy(path + baseLength, filename, filenameLength);
-      path[baseLength + filenameLength] = '\0';
-      parseMtl(path, base, io, &textures, &materials, &materialMap);
-    } else if (STARTS_WITH(line, "usemtl ")) {
-      uint64_t index = map_get(&materialMap, hash64(line + 7, length - 7));
-      int material = index == MAP_NIL ? -1 : index;
-      objGroup* group = &groups.data[groups.length - 1];
-      if (group->count > 0) {
-        objGroup next = { .material = material, .start = group->start + group->count };
-        arr_push(&groups, next);
-      } else { // If the group doesn't have any faces yet, it's safe to modify its material
-        group->material = material;
+
+      chunk->remap[j] = (uint32_t) index;
+    }
+
+    indexCount += chunk->indices.length;
+  }
+
+  // Materials and groups are processed in file order
+  arr_reserve(&indexBlob, indexCount);
+  indexBlob.length = indexCount;
+  for (uint32_t i = 0, offset = 0; i < chunkCount && !message; offset += chunks[i].indices.length, i++) {
+    objChunk* chunk = &chunks[i];
+    chunk->output = indexBlob.data + offset;
+
+    for (size_t j = 0; j < chunk->events.length && !message; j++) {
+      objEvent* event = &chunk->events.data[j];
+      if (event->library) {
+        if (baseLength + event->length >= sizeof(path)) {
+          message = "Bad OBJ: Material filename is too long";
+          break;
+        }
+        memcpy(path + baseLength, event->name, event->length);
+        path[baseLength + event->length] = '\0';
+        if (!loadMtl(path, base, io, &textures, &materials, &materialMap, error, sizeof(error))) {
+          message = error;
+        }
+      } else {
+        uint64_t index = map_get(&materialMap, hash64(event->name, event->length));
+        uint32_t material = index == MAP_NIL ? ~0u : (uint32_t) index;
+        uint32_t start = offset + event->offset;
+        objGroup* group = &groups.data[groups.length - 1];
+        if (start > group->start) {
+          arr_push(&groups, ((objGroup) { .material = material, .start = start }));
+        } else { // If the group doesn't have any faces yet, it's safe to modify its material
+          group->material = material;
+        }
       }
     }
+  }
 
-    next:
-    if (!newline) break;
-    size -= newline - data + 1;
-    data = newline + 1;
+  // Face indices can only be checked once the chunks are merged, and mtl files are only read here,
+  // so errors from either are thrown after cleaning up
+  if (message) {
+    freeChunks(chunks, chunkCount);
+    arr_free(&vertexBlob);
+    arr_free(&indexBlob);
+    for (size_t i = 0; i < textures.length; i++) {
+      lovrRelease(TextureData, textures.data[i]);
+    }
+    model = NULL;
+    goto finish;
   }
 
+  batch = job_start(remapChunk, chunks, chunkCount, MAX_OBJ_WORKERS);
+  job_wait(batch, NULL, 0);
+  freeChunks(chunks, chunkCount);
+
   if (vertexBlob.length == 0 || indexBlob.length == 0) {
+    arr_free(&vertexBlob);
+    arr_free(&indexBlob);
     model = NULL;
     goto finish;
   }
-
   model->blobCount = 2;
   model->bufferCount = 2;
   model->attributeCount = 3 + (uint32_t) groups.length;
@@ -251,7 +578,7 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   lovrModelDataAllocate(model);
 
   model->blobs[0] = lovrBlobCreate(vertexBlob.data, vertexBlob.length * sizeof(float), "obj vertex data");
-  model->blobs[1] = lovrBlobCreate(indexBlob.data, indexBlob.length * sizeof(int), "obj index data");
+  model->blobs[1] = lovrBlobCreate(indexBlob.data, indexBlob.length * sizeof(uint32_t), "obj index data");
 
   model->buffers[0] = (ModelBuffer) {
     .data = model->blobs[0]->data,
@@ -262,7 +589,7 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   model->buffers[1] = (ModelBuffer) {
     .data = model->blobs[1]->data,
     .size = model->blobs[1]->size,
-    .stride = sizeof(int)
+    .stride = sizeof(uint32_t)
   };
 
   memcpy(model->textures, textures.data, model->textureCount * sizeof(TextureData*));
@@ -270,19 +597,6 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   memcpy(model->materialMap.hashes, materialMap.hashes, materialMap.size * sizeof(uint64_t));
   memcpy(model->materialMap.values, materialMap.values, materialMap.size * sizeof(uint64_t));
 
-  float min[4] = { FLT_MAX };
-  float max[4] = { FLT_MIN };
-
-  for (size_t i = 0; i < vertexBlob.length; i += 8) {
-    float* v = vertexBlob.data + i;
-    min[0] = MIN(min[0], v[0]);
-    max[0] = MAX(max[0], v[0]);
-    min[1] = MIN(min[1], v[1]);
-    max[1] = MAX(max[1], v[1]);
-    min[2] = MIN(min[2], v[2]);
-    max[2] = MAX(max[2], v[2]);
-  }
-
   model->attributes[0] = (ModelAttribute) {
     .buffer = 0,
     .offset = 0,
@@ -317,10 +631,11 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
 
   for (size_t i = 0; i < groups.length; i++) {
     objGroup* group = &groups.data[i];
+    uint32_t next = i + 1 < groups.length ? groups.data[i + 1].start : (uint32_t) indexBlob.length;
     model->attributes[3 + i] = (ModelAttribute) {
       .buffer = 1,
-      .offset = group->start * sizeof(int),
-      .count = group->count,
+      .offset = group->start * sizeof(uint32_t),
+      .count = next - group->start,
       .type = U32,
       .components = 1
     };
@@ -357,5 +672,8 @@ finish:
   arr_free(&positions);
   arr_free(&normals);
   arr_free(&uvs);
+  if (message) {
+    lovrThrow("%s", message);
+  }
   return model;
 }
@@ -0,0 +1,812 @@
+#include "data/modelData.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+// Import-time geometry optimization.  Triangles are reordered for the post-transform vertex cache
+// (Forsyth's algorithm), vertices are reordered into first-use order for fetch locality, and normals
+// and texture coordinates can optionally be quantized to 16 bits.  Everything happens in place on
+// the ModelBuffer memory, so this has to run before a Model is created from the ModelData.
+
+#define VERTEX_CACHE_SIZE 32
+
+static size_t getTypeSize(AttributeType type) {
+  switch (type) {
+    case I8: case U8: return 1;
+    case I16: case U16: return 2;
+    case I32: case U32: case F32: return 4;
+    default: return 0;
+  }
+}
+
+static char* getAttributeData(ModelData* model, ModelAttribute* attribute, size_t* stride) {
+  ModelBuffer* buffer = &model->buffers[attribute->buffer];
+  size_t size = attribute->components * getTypeSize(attribute->type);
+  *stride = buffer->stride ? buffer->stride : size;
+  return buffer->data + attribute->offset;
+}
+
+static uint32_t* readIndices(ModelData* model, ModelAttribute* attribute) {
+  size_t stride;
+  char* data = getAttributeData(model, attribute, &stride);
+  uint32_t* indices = malloc(attribute->count * sizeof(uint32_t));
+  lovrAssert(indices, "Out of memory");
+  for (uint32_t i = 0; i < attribute->count; i++) {
+    indices[i] = attribute->type == U16 ? *(uint16_t*) (data + i * stride) : *(uint32_t*) (data + i * stride);
+  }
+  return indices;
+}
+
+static void writeIndices(ModelData* model, ModelAttribute* attribute, uint32_t* indices) {
+  size_t stride;
+  char* data = getAttributeData(model, attribute, &stride);
+  for (uint32_t i = 0; i < attribute->count; i++) {
+    if (attribute->type == U16) {
+      *(uint16_t*) (data + i * stride) = (uint16_t) indices[i];
+    } else {
+      *(uint32_t*) (data + i * stride) = indices[i];
+    }
+  }
+}
+
+static bool isOptimizable(ModelPrimitive* primitive) {
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  ModelAttribute* indices = primitive->indices;
+  return primitive->mode == DRAW_TRIANGLES && position && indices && (indices->type == U16 || indices->type == U32);
+}
+
+static float getVertexScore(int32_t cachePosition, uint32_t triangles) {
+  if (triangles == 0) {
+    return -1.f;
+  }
+
+  float score = 0.f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      score = .75f;
+    } else {
+      score = powf(1.f - (cachePosition - 3) / (float) (VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+  }
+
+  return score + 2.f / sqrtf((float) triangles);
+}
+
+static void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount) {
+  uint32_t triangleCount = indexCount / 3;
+  uint32_t* triangles = calloc(vertexCount, sizeof(uint32_t));
+  uint32_t* offsets = malloc(vertexCount * sizeof(uint32_t));
+  uint32_t* adjacency = malloc(indexCount * sizeof(uint32_t));
+  int32_t* cachePositions = malloc(vertexCount * sizeof(int32_t));
+  float* vertexScores = malloc(vertexCount * sizeof(float));
+  float* triangleScores = malloc(triangleCount * sizeof(float));
+  bool* emitted = calloc(triangleCount, sizeof(bool));
+  uint32_t* output = malloc(indexCount * sizeof(uint32_t));
+  lovrAssert(triangles && offsets && adjacency && cachePositions && vertexScores && triangleScores && emitted && output, "Out of memory");
+
+  // Build the vertex-triangle adjacency lists
+  for (uint32_t i = 0; i < triangleCount * 3; i++) {
+    triangles[indices[i]]++;
+  }
+
+  for (uint32_t i = 0, offset = 0; i < vertexCount; i++) {
+    offsets[i] = offset;
+    offset += triangles[i];
+    triangles[i] = 0;
+  }
+
+  for (uint32_t i = 0; i < triangleCount * 3; i++) {
+    uint32_t v = indices[i];
+    adjacency[offsets[v] + triangles[v]++] = i / 3;
+  }
+
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    cachePositions[i] = -1;
+    vertexScores[i] = getVertexScore(-1, triangles[i]);
+  }
+
+  for (uint32_t i = 0; i < triangleCount; i++) {
+    triangleScores[i] = vertexScores[indices[3 * i + 0]] + vertexScores[indices[3 * i + 1]] + vertexScores[indices[3 * i + 2]];
+  }
+
+  uint32_t cache[VERTEX_CACHE_SIZE + 3];
+  uint32_t cacheSize = 0;
+  uint32_t cursor = 0;
+  uint32_t best = ~0u;
+
+  for (uint32_t n = 0; n < triangleCount; n++) {
+
+    // If nothing in the cache is useful, fall back to the next triangle that hasn't been emitted
+    if (best == ~0u) {
+      while (emitted[cursor]) cursor++;
+      best = cursor;
+    }
+
+    uint32_t* triangle = &indices[3 * best];
+    memcpy(output + 3 * n, triangle, 3 * sizeof(uint32_t));
+    emitted[best] = true;
+
+    // Remove the triangle from the adjacency lists of its vertices
+    for (uint32_t i = 0; i < 3; i++) {
+      uint32_t v = triangle[i];
+      uint32_t* list = adjacency + offsets[v];
+      for (uint32_t j = 0; j < triangles[v]; j++) {
+        if (list[j] == best) {
+          list[j] = list[--triangles[v]];
+          break;
+        }
+      }
+    }
+
+    // Push the triangle's vertices to the front of the cache
+    uint32_t newCache[VERTEX_CACHE_SIZE + 3];
+    uint32_t newCacheSize = 0;
+    for (uint32_t i = 0; i < 3; i++) {
+      newCache[newCacheSize++] = triangle[i];
+    }
+
+    for (uint32_t i = 0; i < cacheSize; i++) {
+      uint32_t v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        newCache[newCacheSize++] = v;
+      }
+    }
+
+    // Rescore everything that moved in (or fell out of) the cache
+    for (uint32_t i = 0; i < newCacheSize; i++) {
+      uint32_t v = newCache[i];
+      cachePositions[v] = i < VERTEX_CACHE_SIZE ? (int32_t) i : -1;
+      float score = getVertexScore(cachePositions[v], triangles[v]);
+      float delta = score - vertexScores[v];
+      vertexScores[v] = score;
+      for (uint32_t j = 0; j < triangles[v]; j++) {
+        triangleScores[adjacency[offsets[v] + j]] += delta;
+      }
+    }
+
+    cacheSize = MIN(newCacheSize, VERTEX_CACHE_SIZE);
+    memcpy(cache, newCache, cacheSize * sizeof(uint32_t));
+
+    // Pick the best triangle that uses a vertex in the cache
+    best = ~0u;
+    float bestScore = -1.f;
+    for (uint32_t i = 0; i < cacheSize; i++) {
+      uint32_t v = cache[i];
+      for (uint32_t j = 0; j < triangles[v]; j++) {
+        uint32_t t = adjacency[offsets[v] + j];
+        if (triangleScores[t] > bestScore) {
+          bestScore = triangleScores[t];
+          best = t;
+        }
+      }
+    }
+  }
+
+  memcpy(indices, output, triangleCount * 3 * sizeof(uint32_t));
+  free(triangles);
+  free(offsets);
+  free(adjacency);
+  free(cachePositions);
+  free(vertexScores);
+  free(triangleScores);
+  free(emitted);
+  free(output);
+}
+
+// Reorders the vertices of every primitive that shares the same set of attributes, so vertices are
+// stored in the order the (cache-optimized) index buffers first reference them.  This is only safe
+// if no other primitive references any of those attributes.
+static void optimizeVertexFetch(ModelData* model, uint32_t first, bool* done) {
+  ModelPrimitive* primitive = &model->primitives[first];
+  uint32_t vertexCount = primitive->attributes[ATTR_POSITION]->count;
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* other = &model->primitives[i];
+    bool same = !memcmp(other->attributes, primitive->attributes, sizeof(primitive->attributes));
+
+    if (same) {
+      done[i] = true;
+      if (!isOptimizable(other)) {
+        return;
+      }
+    } else {
+      for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+        for (uint32_t k = 0; k < MAX_DEFAULT_ATTRIBUTES; k++) {
+          if (other->attributes[j] && other->attributes[j] == primitive->attributes[k]) {
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+    if (primitive->attributes[i] && primitive->attributes[i]->count != vertexCount) {
+      return;
+    }
+  }
+
+  // Index buffers can't be shared with primitives outside of the group either
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* a = &model->primitives[i];
+    if (memcmp(a->attributes, primitive->attributes, sizeof(primitive->attributes))) {
+      for (uint32_t j = 0; j < model->primitiveCount; j++) {
+        ModelPrimitive* b = &model->primitives[j];
+        if (a->indices && a->indices == b->indices && !memcmp(b->attributes, primitive->attributes, sizeof(primitive->attributes))) {
+          return;
+        }
+      }
+    }
+  }
+
+  if (vertexCount == 0) {
+    return;
+  }
+
+  uint32_t* remap = malloc(vertexCount * sizeof(uint32_t));
+  lovrAssert(remap, "Out of memory");
+  memset(remap, 0xff, vertexCount * sizeof(uint32_t));
+  uint32_t next = 0;
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* other = &model->primitives[i];
+    if (!memcmp(other->attributes, primitive->attributes, sizeof(primitive->attributes))) {
+      uint32_t* indices = readIndices(model, other->indices);
+      for (uint32_t j = 0; j < other->indices->count; j++) {
+        if (indices[j] >= vertexCount) {
+          free(indices);
+          free(remap);
+          return;
+        } else if (remap[indices[j]] == ~0u) {
+          remap[indices[j]] = next++;
+        }
+      }
+      free(indices);
+    }
+  }
+
+  // Unreferenced vertices go at the end
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    if (remap[i] == ~0u) {
+      remap[i] = next++;
+    }
+  }
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* other = &model->primitives[i];
+    if (!memcmp(other->attributes, primitive->attributes, sizeof(primitive->attributes)) && other->indices) {
+      bool shared = false;
+      for (uint32_t j = 0; j < i; j++) {
+        shared |= model->primitives[j].indices == other->indices && !memcmp(model->primitives[j].attributes, primitive->attributes, sizeof(primitive->attributes));
+      }
+      if (shared) continue;
+      uint32_t* indices = readIndices(model, other->indices);
+      for (uint32_t j = 0; j < other->indices->count; j++) {
+        indices[j] = remap[indices[j]];
+      }
+      writeIndices(model, other->indices, indices);
+      free(indices);
+    }
+  }
+
+  for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+    ModelAttribute* attribute = primitive->attributes[i];
+    if (!attribute) continue;
+
+    size_t stride;
+    char* data = getAttributeData(model, attribute, &stride);
+    size_t size = attribute->components * getTypeSize(attribute->type);
+    char* copy = malloc(vertexCount * stride);
+    lovrAssert(copy, "Out of memory");
+    memcpy(copy, data, (vertexCount - 1) * stride + size);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+      memcpy(data + remap[v] * stride, copy + v * stride, size);
+    }
+    free(copy);
+  }
+
+  free(remap);
+}
+
+// An attribute can be repacked in place if it's the only thing in a tightly packed buffer
+static bool isPacked(ModelData* model, ModelAttribute* attribute) {
+  ModelBuffer* buffer = &model->buffers[attribute->buffer];
+  size_t size = attribute->components * getTypeSize(attribute->type);
+
+  if (buffer->stride != 0 && buffer->stride != size) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < model->attributeCount; i++) {
+    if (&model->attributes[i] != attribute && model->attributes[i].buffer == attribute->buffer) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void quantizeNormals(ModelData* model, ModelAttribute* attribute) {
+  if (attribute->type != F32 || attribute->components != 3 || !isPacked(model, attribute)) {
+    return;
+  }
+
+  // 3 floats become 4 shorts to keep every vertex 4-byte aligned
+  ModelBuffer* buffer = &model->buffers[attribute->buffer];
+  char* data = buffer->data + attribute->offset;
+  for (uint32_t i = 0; i < attribute->count; i++) {
+    float* n = (float*) (data + i * 12);
+    int16_t q[4] = { 0, 0, 0, 0 };
+    for (uint32_t j = 0; j < 3; j++) {
+      q[j] = (int16_t) roundf(CLAMP(n[j], -1.f, 1.f) * 32767.f);
+    }
+    memcpy(data + i * 8, q, sizeof(q));
+  }
+
+  attribute->type = I16;
+  attribute->components = 4;
+  attribute->normalized = true;
+  buffer->stride = 8;
+  buffer->size = attribute->offset + attribute->count * 8;
+}
+
+static void quantizeTexcoords(ModelData* model, ModelAttribute* attribute) {
+  if (attribute->type != F32 || attribute->components != 2 || !isPacked(model, attribute)) {
+    return;
+  }
+
+  // Normalized shorts can only represent [0, 1], so repeating texture coordinates are left alone
+  ModelBuffer* buffer = &model->buffers[attribute->buffer];
+  float* uv = (float*) (buffer->data + attribute->offset);
+  for (uint32_t i = 0; i < 2 * attribute->count; i++) {
+    if (uv[i] < 0.f || uv[i] > 1.f) {
+      return;
+    }
+  }
+
+  uint16_t* q = (uint16_t*) uv;
+  for (uint32_t i = 0; i < 2 * attribute->count; i++) {
+    q[i] = (uint16_t) roundf(uv[i] * 65535.f);
+  }
+
+  attribute->type = U16;
+  attribute->normalized = true;
+  buffer->stride = 4;
+  buffer->size = attribute->offset + attribute->count * 4;
+}
+
+// Buffers can point into the Blob the model was loaded from, and loading that Blob again would read
+// the rewritten data through the original accessors.  Everything optimization touches is copied.
+static void copyBuffers(ModelData* model) {
+  if (model->bufferCopy) {
+    return;
+  }
+
+  bool* used = calloc(model->bufferCount, sizeof(bool));
+  lovrAssert(used || model->bufferCount == 0, "Out of memory");
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+      if (primitive->attributes[j]) {
+        used[primitive->attributes[j]->buffer] = true;
+      }
+    }
+    if (primitive->indices) {
+      used[primitive->indices->buffer] = true;
+    }
+  }
+
+  size_t size = 0;
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    size += used[i] ? ALIGN(model->buffers[i].size, 8) : 0;
+  }
+
+  if (size > 0) {
+    char* data = model->bufferCopy = malloc(size);
+    lovrAssert(data, "Out of memory");
+    for (uint32_t i = 0; i < model->bufferCount; i++) {
+      if (used[i]) {
+        ModelBuffer* buffer = &model->buffers[i];
+        memcpy(data, buffer->data, buffer->size);
+        buffer->data = data;
+        data += ALIGN(buffer->size, 8);
+      }
+    }
+  }
+
+  free(used);
+}
+
+void lovrModelDataOptimize(ModelData* model, bool quantize) {
+  copyBuffers(model);
+
+  for (uint32_t i = 0; i < model->attributeCount; i++) {
+    bool isIndexBuffer = false;
+    ModelAttribute* attribute = &model->attributes[i];
+    for (uint32_t j = 0; j < model->primitiveCount; j++) {
+      isIndexBuffer |= model->primitives[j].indices == attribute && isOptimizable(&model->primitives[j]);
+    }
+
+    if (isIndexBuffer) {
+      uint32_t vertexCount = 0;
+      for (uint32_t j = 0; j < model->primitiveCount; j++) {
+        if (model->primitives[j].indices == attribute && isOptimizable(&model->primitives[j])) {
+          vertexCount = MAX(vertexCount, model->primitives[j].attributes[ATTR_POSITION]->count);
+        }
+      }
+
+      uint32_t* indices = readIndices(model, attribute);
+      bool valid = true;
+      for (uint32_t j = 0; j < attribute->count; j++) {
+        valid &= indices[j] < vertexCount;
+      }
+
+      if (valid) {
+        optimizeVertexCache(indices, attribute->count - attribute->count % 3, vertexCount);
+        writeIndices(model, attribute, indices);
+      }
+
+      free(indices);
+    }
+  }
+
+  // Existing LOD index buffers would need to be remapped too, so vertices stay put if there are any
+  if (!model->lods) {
+    bool* done = calloc(model->primitiveCount, sizeof(bool));
+    lovrAssert(done || model->primitiveCount == 0, "Out of memory");
+    for (uint32_t i = 0; i < model->primitiveCount; i++) {
+      if (!done[i] && isOptimizable(&model->primitives[i])) {
+        optimizeVertexFetch(model, i, done);
+      }
+    }
+    free(done);
+  }
+
+  if (quantize) {
+    for (uint32_t i = 0; i < model->primitiveCount; i++) {
+      ModelPrimitive* primitive = &model->primitives[i];
+      if (primitive->attributes[ATTR_NORMAL]) {
+        quantizeNormals(model, primitive->attributes[ATTR_NORMAL]);
+      }
+      if (primitive->attributes[ATTR_TEXCOORD]) {
+        quantizeTexcoords(model, primitive->attributes[ATTR_TEXCOORD]);
+      }
+    }
+  }
+}
+
+// LOD generation, using quadric error metrics and edge collapses.  Vertices on borders or attribute
+// seams are locked so the silhouette and texture mapping survive, everything else is collapsed onto
+// a neighbor in order of increasing error until the target triangle count is reached.
+
+typedef struct {
+  float a00, a11, a22;
+  float a10, a20, a21;
+  float b0, b1, b2;
+  float c, w;
+} Quadric;
+
+typedef struct {
+  uint32_t from;
+  uint32_t to;
+  float cost;
+} Collapse;
+
+static void quadricAdd(Quadric* q, Quadric* r) {
+  q->a00 += r->a00, q->a11 += r->a11, q->a22 += r->a22;
+  q->a10 += r->a10, q->a20 += r->a20, q->a21 += r->a21;
+  q->b0 += r->b0, q->b1 += r->b1, q->b2 += r->b2;
+  q->c += r->c, q->w += r->w;
+}
+
+static float quadricError(Quadric* q, float* p) {
+  float x = p[0], y = p[1], z = p[2];
+  float r = q->a00 * x * x + q->a11 * y * y + q->a22 * z * z;
+  r += 2.f * (q->a10 * x * y + q->a20 * x * z + q->a21 * y * z);
+  r += 2.f * (q->b0 * x + q->b1 * y + q->b2 * z);
+  r += q->c;
+  return q->w > 0.f ? fabsf(r) / q->w : 0.f;
+}
+
+static void getNormal(float* a, float* b, float* c, float* n) {
+  float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+  float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+  n[0] = u[1] * v[2] - u[2] * v[1];
+  n[1] = u[2] * v[0] - u[0] * v[2];
+  n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+static int compareCollapses(const void* a, const void* b) {
+  float x = ((const Collapse*) a)->cost;
+  float y = ((const Collapse*) b)->cost;
+  return (x > y) - (x < y);
+}
+
+static uint32_t simplify(uint32_t* indices, uint32_t indexCount, float* positions, Quadric* quadrics, bool* locked, uint32_t vertexCount, uint32_t target, float* error) {
+  uint32_t* counts = malloc(vertexCount * sizeof(uint32_t));
+  uint32_t* offsets = malloc(vertexCount * sizeof(uint32_t));
+  uint32_t* adjacency = malloc(indexCount * sizeof(uint32_t));
+  uint32_t* remap = malloc(vertexCount * sizeof(uint32_t));
+  bool* touched = malloc(vertexCount * sizeof(bool));
+  Collapse* collapses = malloc(2 * indexCount * sizeof(Collapse));
+  lovrAssert(counts && offsets && adjacency && remap && touched && collapses, "Out of memory");
+
+  while (indexCount > target) {
+    memset(counts, 0, vertexCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < indexCount; i++) {
+      counts[indices[i]]++;
+    }
+
+    for (uint32_t i = 0, offset = 0; i < vertexCount; i++) {
+      offsets[i] = offset;
+      offset += counts[i];
+      counts[i] = 0;
+      remap[i] = i;
+      touched[i] = false;
+    }
+
+    for (uint32_t i = 0; i < indexCount; i++) {
+      uint32_t v = indices[i];
+      adjacency[offsets[v] + counts[v]++] = i / 3;
+    }
+
+    uint32_t collapseCount = 0;
+    for (uint32_t i = 0; i < indexCount; i++) {
+      uint32_t a = indices[i];
+      uint32_t b = indices[i % 3 == 2 ? i - 2 : i + 1];
+      if (!locked[a]) collapses[collapseCount++] = (Collapse) { a, b, quadricError(&quadrics[a], positions + 3 * b) };
+      if (!locked[b]) collapses[collapseCount++] = (Collapse) { b, a, quadricError(&quadrics[b], positions + 3 * a) };
+    }
+
+    qsort(collapses, collapseCount, sizeof(Collapse), compareCollapses);
+
+    // Each collapse of an interior edge removes 2 triangles
+    uint32_t goal = (indexCount - target) / 6 + 1;
+    uint32_t applied = 0;
+
+    for (uint32_t i = 0; i < collapseCount && applied < goal; i++) {
+      Collapse* collapse = &collapses[i];
+      uint32_t from = collapse->from;
+      uint32_t to = collapse->to;
+
+      if (touched[from] || touched[to]) {
+        continue;
+      }
+
+      // Reject the collapse if it would flip any of the triangles that survive it
+      bool flipped = false;
+      for (uint32_t j = 0; j < counts[from] && !flipped; j++) {
+        uint32_t* triangle = &indices[3 * adjacency[offsets[from] + j]];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+          continue;
+        }
+
+        float* p[3], before[3], after[3];
+        for (uint32_t k = 0; k < 3; k++) p[k] = positions + 3 * triangle[k];
+        getNormal(p[0], p[1], p[2], before);
+        for (uint32_t k = 0; k < 3; k++) p[k] = positions + 3 * (triangle[k] == from ? to : triangle[k]);
+        getNormal(p[0], p[1], p[2], after);
+        flipped = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.f;
+      }
+
+      if (flipped) {
+        continue;
+      }
+
+      remap[from] = to;
+      quadricAdd(&quadrics[to], &quadrics[from]);
+      *error = MAX(*error, collapse->cost);
+      applied++;
+
+      for (uint32_t j = 0; j < counts[from]; j++) {
+        uint32_t* triangle = &indices[3 * adjacency[offsets[from] + j]];
+        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+      }
+    }
+
+    if (applied == 0) {
+      break;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < indexCount; i += 3) {
+      uint32_t a = remap[indices[i + 0]];
+      uint32_t b = remap[indices[i + 1]];
+      uint32_t c = remap[indices[i + 2]];
+      if (a != b && b != c && c != a) {
+        indices[count++] = a;
+        indices[count++] = b;
+        indices[count++] = c;
+      }
+    }
+    indexCount = count;
+  }
+
+  free(counts);
+  free(offsets);
+  free(adjacency);
+  free(remap);
+  free(touched);
+  free(collapses);
+  return indexCount;
+}
+
+static void generateLods(ModelData* model, ModelPrimitive* primitive, ModelLod* lod, uint32_t levels, float ratio) {
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  uint32_t vertexCount = position->count;
+  uint32_t indexCount = primitive->indices->count - primitive->indices->count % 3;
+
+  if (position->type != F32 || position->components < 3 || indexCount == 0) {
+    return;
+  }
+
+  uint32_t* indices = readIndices(model, primitive->indices);
+  for (uint32_t i = 0; i < indexCount; i++) {
+    if (indices[i] >= vertexCount) {
+      free(indices);
+      return;
+    }
+  }
+
+  // Positions are rescaled to the unit cube to keep the quadrics well-conditioned
+  size_t stride;
+  char* data = getAttributeData(model, position, &stride);
+  float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    float* p = (float*) (data + i * stride);
+    for (uint32_t j = 0; j < 3; j++) {
+      min[j] = MIN(min[j], p[j]);
+      max[j] = MAX(max[j], p[j]);
+    }
+  }
+
+  float extent = MAX(MAX(max[0] - min[0], max[1] - min[1]), max[2] - min[2]);
+  float scale = extent > 0.f ? 1.f / extent : 0.f;
+  float* positions = malloc(3 * vertexCount * sizeof(float));
+  Quadric* quadrics = calloc(vertexCount, sizeof(Quadric));
+  bool* locked = calloc(vertexCount, sizeof(bool));
+  uint32_t* groups = malloc(vertexCount * sizeof(uint32_t));
+  uint32_t* output = malloc(levels * indexCount * sizeof(uint32_t));
+  lovrAssert(positions && quadrics && locked && groups && output, "Out of memory");
+
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    float* p = (float*) (data + i * stride);
+    for (uint32_t j = 0; j < 3; j++) {
+      positions[3 * i + j] = (p[j] - min[j]) * scale;
+    }
+  }
+
+  // Vertices that share a position with other vertices are on a seam (different normals or UVs)
+  map_t positionMap;
+  map_init(&positionMap, vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    uint64_t hash = hash64(positions + 3 * i, 3 * sizeof(float));
+    uint64_t group = map_get(&positionMap, hash);
+    if (group == MAP_NIL) {
+      map_set(&positionMap, hash, i);
+      groups[i] = i;
+    } else {
+      groups[i] = (uint32_t) group;
+      locked[i] = locked[group] = true;
+    }
+  }
+  map_free(&positionMap);
+
+  // Edges without a twin going the other way are on a border
+  map_t edgeMap;
+  map_init(&edgeMap, indexCount);
+  for (uint32_t i = 0; i < indexCount; i++) {
+    uint32_t edge[2] = { groups[indices[i]], groups[indices[i % 3 == 2 ? i - 2 : i + 1]] };
+    map_set(&edgeMap, hash64(edge, sizeof(edge)), i);
+  }
+  for (uint32_t i = 0; i < indexCount; i++) {
+    uint32_t a = indices[i];
+    uint32_t b = indices[i % 3 == 2 ? i - 2 : i + 1];
+    uint32_t twin[2] = { groups[b], groups[a] };
+    if (map_get(&edgeMap, hash64(twin, sizeof(twin))) == MAP_NIL) {
+      locked[a] = locked[b] = true;
+    }
+  }
+  map_free(&edgeMap);
+
+  for (uint32_t i = 0; i < indexCount; i += 3) {
+    float* a = positions + 3 * indices[i + 0];
+    float* b = positions + 3 * indices[i + 1];
+    float* c = positions + 3 * indices[i + 2];
+    float n[3];
+    getNormal(a, b, c, n);
+    float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length == 0.f) continue;
+    float area = length * .5f;
+    n[0] /= length, n[1] /= length, n[2] /= length;
+    float d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+    Quadric q = {
+      area * n[0] * n[0], area * n[1] * n[1], area * n[2] * n[2],
+      area * n[1] * n[0], area * n[2] * n[0], area * n[2] * n[1],
+      area * n[0] * d, area * n[1] * d, area * n[2] * d,
+      area * d * d, area
+    };
+    quadricAdd(&quadrics[indices[i + 0]], &q);
+    quadricAdd(&quadrics[indices[i + 1]], &q);
+    quadricAdd(&quadrics[indices[i + 2]], &q);
+  }
+
+  // Each level is simplified from the previous one, so the errors accumulate
+  memcpy(output, indices, indexCount * sizeof(uint32_t));
+  lod->count[0] = indexCount;
+  lod->levelCount = 1;
+  uint32_t total = indexCount;
+  float error = 0.f;
+
+  for (uint32_t i = 1; i < levels; i++) {
+    uint32_t previous = lod->count[i - 1];
+    uint32_t target = (uint32_t) (previous / 3 * ratio) * 3;
+    uint32_t* level = output + total;
+    memcpy(level, output + lod->start[i - 1], previous * sizeof(uint32_t));
+    uint32_t count = simplify(level, previous, positions, quadrics, locked, vertexCount, target, &error);
+
+    // Stop once simplification stops making meaningful progress
+    if (count == 0 || previous - count < MAX(previous / 8, 3)) {
+      break;
+    }
+
+    optimizeVertexCache(level, count, vertexCount);
+    lod->start[i] = total;
+    lod->count[i] = count;
+    lod->error[i] = sqrtf(error) * extent;
+    lod->levelCount++;
+    total += count;
+  }
+
+  if (lod->levelCount > 1) {
+    size_t indexSize = primitive->indices->type == U16 ? 2 : 4;
+    lod->data = malloc(total * indexSize);
+    lovrAssert(lod->data, "Out of memory");
+    for (uint32_t i = 0; i < total; i++) {
+      if (indexSize == 2) {
+        ((uint16_t*) lod->data)[i] = (uint16_t) output[i];
+      } else {
+        ((uint32_t*) lod->data)[i] = output[i];
+      }
+    }
+
+    for (uint32_t i = 0; i < 3; i++) {
+      lod->center[i] = (min[i] + max[i]) * .5f;
+    }
+    float size[3] = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+    lod->radius = sqrtf(size[0] * size[0] + size[1] * size[1] + size[2] * size[2]) * .5f;
+  } else {
+    lod->levelCount = 0;
+  }
+
+  free(indices);
+  free(positions);
+  free(quadrics);
+  free(locked);
+  free(groups);
+  free(output);
+}
+
+void lovrModelDataGenerateLods(ModelData* model, uint32_t levels, float ratio) {
+  lovrAssert(ratio > 0.f && ratio < 1.f, "LOD ratio must be between 0 and 1");
+  levels = MIN(levels + 1, MAX_LODS);
+
+  if (model->lods) {
+    for (uint32_t i = 0; i < model->primitiveCount; i++) {
+      free(model->lods[i].data);
+    }
+    free(model->lods);
+  }
+
+  model->lods = calloc(model->primitiveCount, sizeof(ModelLod));
+  lovrAssert(model->lods || model->primitiveCount == 0, "Out of memory");
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    if (isOptimizable(&model->primitives[i]) && levels > 1) {
+      generateLods(model, &model->primitives[i], &model->lods[i], levels, ratio);
+    }
+  }
+}
@@ -2,12 +2,12 @@
 #include "data/audioStream.h"
 #include "core/util.h"
 #include "core/ref.h"
-#include "lib/stb/stb_vorbis.h"
 #include <limits.h>
 #include <stdlib.h>
 #include <stdint.h>
 
 SoundData* lovrSoundDataInit(SoundData* soundData, size_t samples, uint32_t sampleRate, uint32_t bitDepth, uint32_t channelCount) {
+  lovrAssert(bitDepth == 8 || bitDepth == 16 || bitDepth == 32, "Unsupported SoundData bit depth %d", bitDepth);
   soundData->samples = samples;
   soundData->sampleRate = sampleRate;
   soundData->bitDepth = bitDepth;
@@ -21,34 +21,32 @@ SoundData* lovrSoundDataInit(SoundData* soundData, size_t samples, uint32_t samp
 }
 
 SoundData* lovrSoundDataInitFromAudioStream(SoundData* soundData, AudioStream* audioStream) {
-  soundData->samples = audioStream->samples;
+  soundData->samples = audioStream->samples / audioStream->channelCount;
   soundData->sampleRate = audioStream->sampleRate;
   soundData->bitDepth = audioStream->bitDepth;
   soundData->channelCount = audioStream->channelCount;
-  size_t byteCount = audioStream->samples * audioStream->channelCount * (audioStream->bitDepth / 8);
+  size_t byteCount = audioStream->samples * (audioStream->bitDepth / 8);
   void* bytes = calloc(1, byteCount);
   lovrAssert(bytes != NULL, "Out of memory");
   soundData->blob = lovrBlobCreate(bytes, byteCount, "SoundData from AudioStream");
 
   size_t samples;
-  int16_t* buffer = soundData->blob->data;
+  char* buffer = soundData->blob->data;
+  size_t stride = audioStream->bitDepth / 8;
   size_t offset = 0;
   lovrAudioStreamRewind(audioStream);
-  while ((samples = lovrAudioStreamDecode(audioStream, buffer + offset, soundData->blob->size - (offset * sizeof(int16_t)))) != 0) {
+  while (offset < audioStream->samples && (samples = lovrAudioStreamDecode(audioStream, buffer + offset * stride, audioStream->samples - offset)) != 0) {
     offset += samples;
   }
 
   return soundData;
 }
 
+// Any format AudioStream can decode works here
 SoundData* lovrSoundDataInitFromBlob(SoundData* soundData, Blob* blob) {
-  int sampleRate, channels;
-  soundData->bitDepth = 16;
-  soundData->blob = lovrAlloc(Blob);
-  soundData->samples = stb_vorbis_decode_memory(blob->data, (int) blob->size, &channels, &sampleRate, (int16_t**) &soundData->blob->data);
-  soundData->sampleRate = sampleRate;
-  soundData->channelCount = channels;
-  soundData->blob->size = soundData->samples * soundData->channelCount * (soundData->bitDepth / 8);
+  AudioStream* stream = lovrAudioStreamCreate(blob, 4096);
+  lovrSoundDataInitFromAudioStream(soundData, stream);
+  lovrRelease(AudioStream, stream);
   return soundData;
 }
 
@@ -57,6 +55,7 @@ float lovrSoundDataGetSample(SoundData* soundData, size_t index) {
   switch (soundData->bitDepth) {
     case 8: return ((int8_t*) soundData->blob->data)[index] / (float) CHAR_MAX;
     case 16: return ((int16_t*) soundData->blob->data)[index] / (float) SHRT_MAX;
+    case 32: return ((float*) soundData->blob->data)[index];
     default: lovrThrow("Unsupported SoundData bit depth %d\n", soundData->bitDepth); return 0;
   }
 }
@@ -66,6 +65,7 @@ void lovrSoundDataSetSample(SoundData* soundData, size_t index, float value) {
   switch (soundData->bitDepth) {
     case 8: ((int8_t*) soundData->blob->data)[index] = value * CHAR_MAX; break;
     case 16: ((int16_t*) soundData->blob->data)[index] = value * SHRT_MAX; break;
+    case 32: ((float*) soundData->blob->data)[index] = value; break;
     default: lovrThrow("Unsupported SoundData bit depth %d\n", soundData->bitDepth); break;
   }
 }
@@ -10,7 +10,7 @@ typedef struct SoundData {
   uint32_t channelCount;
   uint32_t sampleRate;
   size_t samples;
-  uint32_t bitDepth;
+  uint32_t bitDepth; // 8 or 16 bit integers, or 32 bit floats
 } SoundData;
 
 SoundData* lovrSoundDataInit(SoundData* soundData, size_t samples, uint32_t sampleRate, uint32_t bitDepth, uint32_t channels);
@@ -22,3 +22,11 @@ SoundData* lovrSoundDataInitFromBlob(SoundData* soundData, Blob* blob);
 float lovrSoundDataGetSample(SoundData* soundData, size_t index);
 void lovrSoundDataSetSample(SoundData* soundData, size_t index, float value);
 void lovrSoundDataDestroy(void* ref);
+
+// Bulk operations (soundData_dsp.c), offsets and counts are in frames and SIZE_MAX means the rest
+void lovrSoundDataApplyGain(SoundData* soundData, float gain, size_t offset, size_t count);
+void lovrSoundDataMix(SoundData* soundData, SoundData* source, float gain, size_t offset);
+SoundData* lovrSoundDataResample(SoundData* soundData, uint32_t sampleRate);
+SoundData* lovrSoundDataConvert(SoundData* soundData, uint32_t bitDepth);
+void lovrSoundDataGetLevels(SoundData* soundData, size_t offset, size_t count, float* rms, float* peak);
+void lovrSoundDataGetSpectrum(SoundData* soundData, size_t offset, uint32_t size, float* magnitudes);
@@ -0,0 +1,333 @@
+#include "data/soundData.h"
+#include "core/ref.h"
+#include "core/util.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DSP_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DSP_NEON
+#include <arm_neon.h>
+#endif
+
+// Everything is processed as floats in blocks, so each operation is one conversion in and one
+// conversion out no matter what the bit depth is.  Scaling matches lovrSoundDataGetSample.
+
+#define DSP_BLOCK 1024
+
+// Kernels
+
+static void readFloats(SoundData* soundData, size_t start, size_t count, float* output) {
+  switch (soundData->bitDepth) {
+    case 8: {
+      const int8_t* input = (const int8_t*) soundData->blob->data + start;
+      for (size_t i = 0; i < count; i++) {
+        output[i] = input[i] / (float) CHAR_MAX;
+      }
+      break;
+    }
+
+    case 16: {
+      const int16_t* input = (const int16_t*) soundData->blob->data + start;
+      const float scale = 1.f / SHRT_MAX;
+      size_t i = 0;
+#if defined(DSP_SSE)
+      for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*) (input + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+        _mm_storeu_ps(output + i + 0, _mm_mul_ps(lo, _mm_set1_ps(scale)));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(hi, _mm_set1_ps(scale)));
+      }
+#elif defined(DSP_NEON)
+      for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(input + i);
+        vst1q_f32(output + i + 0, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+        vst1q_f32(output + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+      }
+#endif
+      for (; i < count; i++) {
+        output[i] = input[i] * scale;
+      }
+      break;
+    }
+
+    case 32:
+      memcpy(output, (const float*) soundData->blob->data + start, count * sizeof(float));
+      break;
+
+    default: lovrThrow("Unsupported SoundData bit depth %d\n", soundData->bitDepth); break;
+  }
+}
+
+// Integer formats saturate, float keeps whatever headroom it has
+static void writeFloats(SoundData* soundData, size_t start, size_t count, const float* input) {
+  switch (soundData->bitDepth) {
+    case 8: {
+      int8_t* output = (int8_t*) soundData->blob->data + start;
+      for (size_t i = 0; i < count; i++) {
+        float x = input[i] * CHAR_MAX;
+        output[i] = (int8_t) lrintf(CLAMP(x, (float) CHAR_MIN, (float) CHAR_MAX));
+      }
+      break;
+    }
+
+    case 16: {
+      int16_t* output = (int16_t*) soundData->blob->data + start;
+      size_t i = 0;
+#if defined(DSP_SSE)
+      __m128 scale = _mm_set1_ps((float) SHRT_MAX);
+      for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i + 0), scale));
+        __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale));
+        _mm_storeu_si128((__m128i*) (output + i), _mm_packs_epi32(lo, hi));
+      }
+#elif defined(DSP_NEON)
+      for (; i + 8 <= count; i += 8) {
+        int32x4_t lo = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i + 0), (float) SHRT_MAX));
+        int32x4_t hi = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i + 4), (float) SHRT_MAX));
+        vst1q_s16(output + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+      }
+#endif
+      for (; i < count; i++) {
+        float x = input[i] * SHRT_MAX;
+        output[i] = (int16_t) lrintf(CLAMP(x, (float) SHRT_MIN, (float) SHRT_MAX));
+      }
+      break;
+    }
+
+    case 32:
+      memcpy((float*) soundData->blob->data + start, input, count * sizeof(float));
+      break;
+
+    default: lovrThrow("Unsupported SoundData bit depth %d\n", soundData->bitDepth); break;
+  }
+}
+
+// output += input * gain, or output *= gain when input is NULL
+static void mulAdd(float* output, const float* input, size_t count, float gain) {
+  size_t i = 0;
+#if defined(DSP_SSE)
+  __m128 g = _mm_set1_ps(gain);
+  if (input) {
+    for (; i + 4 <= count; i += 4) {
+      _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(_mm_loadu_ps(input + i), g)));
+    }
+  } else {
+    for (; i + 4 <= count; i += 4) {
+      _mm_storeu_ps(output + i, _mm_mul_ps(_mm_loadu_ps(output + i), g));
+    }
+  }
+#elif defined(DSP_NEON)
+  if (input) {
+    for (; i + 4 <= count; i += 4) {
+      vst1q_f32(output + i, vmlaq_n_f32(vld1q_f32(output + i), vld1q_f32(input + i), gain));
+    }
+  } else {
+    for (; i + 4 <= count; i += 4) {
+      vst1q_f32(output + i, vmulq_n_f32(vld1q_f32(output + i), gain));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    output[i] = input ? output[i] + input[i] * gain : output[i] * gain;
+  }
+}
+
+// In place radix-2 FFT, size must be a power of 2
+static void fft(float* real, float* imag, uint32_t size) {
+  for (uint32_t i = 1, j = 0; i < size; i++) {
+    uint32_t bit = size >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float t;
+      t = real[i]; real[i] = real[j]; real[j] = t;
+      t = imag[i]; imag[i] = imag[j]; imag[j] = t;
+    }
+  }
+
+  for (uint32_t length = 2; length <= size; length <<= 1) {
+    double angle = -2. * M_PI / length;
+    float wr = (float) cos(angle);
+    float wi = (float) sin(angle);
+    for (uint32_t i = 0; i < size; i += length) {
+      float cr = 1.f, ci = 0.f;
+      for (uint32_t j = 0; j < length / 2; j++) {
+        uint32_t a = i + j;
+        uint32_t b = a + length / 2;
+        float xr = real[b] * cr - imag[b] * ci;
+        float xi = real[b] * ci + imag[b] * cr;
+        real[b] = real[a] - xr;
+        imag[b] = imag[a] - xi;
+        real[a] += xr;
+        imag[a] += xi;
+        float t = cr * wr - ci * wi;
+        ci = cr * wi + ci * wr;
+        cr = t;
+      }
+    }
+  }
+}
+
+// Operations
+
+// Offsets and counts are in frames
+static void checkRange(SoundData* soundData, size_t offset, size_t* count) {
+  lovrAssert(offset <= soundData->samples, "SoundData offset is out of range");
+  if (*count == SIZE_MAX) {
+    *count = soundData->samples - offset;
+  }
+  lovrAssert(*count <= soundData->samples - offset, "SoundData range is out of bounds");
+}
+
+void lovrSoundDataApplyGain(SoundData* soundData, float gain, size_t offset, size_t count) {
+  float block[DSP_BLOCK];
+  checkRange(soundData, offset, &count);
+  size_t start = offset * soundData->channelCount;
+  size_t total = count * soundData->channelCount;
+  for (size_t i = 0; i < total; i += DSP_BLOCK) {
+    size_t n = MIN(total - i, DSP_BLOCK);
+    readFloats(soundData, start + i, n, block);
+    mulAdd(block, NULL, n, gain);
+    writeFloats(soundData, start + i, n, block);
+  }
+}
+
+// Adds source into soundData starting at a frame offset, whatever doesn't fit is dropped
+void lovrSoundDataMix(SoundData* soundData, SoundData* source, float gain, size_t offset) {
+  lovrAssert(source->channelCount == soundData->channelCount, "SoundData channel counts must match");
+  lovrAssert(source->sampleRate == soundData->sampleRate, "SoundData sample rates must match, resample first");
+  lovrAssert(offset <= soundData->samples, "SoundData offset is out of range");
+  float output[DSP_BLOCK];
+  float input[DSP_BLOCK];
+  size_t start = offset * soundData->channelCount;
+  size_t total = MIN(source->samples, soundData->samples - offset) * soundData->channelCount;
+  // Blocks are mixed back to front, so mixing a SoundData into itself never reads mixed samples
+  for (size_t b = (total + DSP_BLOCK - 1) / DSP_BLOCK; b-- > 0;) {
+    size_t i = b * DSP_BLOCK;
+    size_t n = MIN(total - i, DSP_BLOCK);
+    readFloats(soundData, start + i, n, output);
+    readFloats(source, i, n, input);
+    mulAdd(output, input, n, gain);
+    writeFloats(soundData, start + i, n, output);
+  }
+}
+
+// Linear interpolation, good enough for voice and effects but it doesn't filter before downsampling
+SoundData* lovrSoundDataResample(SoundData* soundData, uint32_t sampleRate) {
+  lovrAssert(sampleRate > 0, "Sample rate must be positive");
+  uint32_t channels = soundData->channelCount;
+  size_t frames = (size_t) ceil((double) soundData->samples * sampleRate / soundData->sampleRate);
+  SoundData* result = lovrSoundDataCreate(frames, sampleRate, soundData->bitDepth, channels);
+
+  if (soundData->samples == 0 || frames == 0) {
+    return result;
+  }
+
+  size_t total = soundData->samples * channels;
+  float* input = malloc(total * sizeof(float));
+  lovrAssert(input, "Out of memory");
+  readFloats(soundData, 0, total, input);
+
+  float block[DSP_BLOCK];
+  double step = (double) soundData->sampleRate / sampleRate;
+  size_t last = soundData->samples - 1;
+  size_t framesPerBlock = DSP_BLOCK / channels;
+  for (size_t frame = 0; frame < frames; frame += framesPerBlock) {
+    size_t n = MIN(frames - frame, framesPerBlock);
+    for (size_t i = 0; i < n; i++) {
+      double position = (frame + i) * step;
+      size_t a = MIN((size_t) position, last);
+      size_t b = MIN(a + 1, last);
+      float t = (float) (position - (double) a);
+      for (uint32_t c = 0; c < channels; c++) {
+        float x = input[a * channels + c];
+        float y = input[b * channels + c];
+        block[i * channels + c] = x + (y - x) * t;
+      }
+    }
+    writeFloats(result, frame * channels, n * channels, block);
+  }
+
+  free(input);
+  return result;
+}
+
+SoundData* lovrSoundDataConvert(SoundData* soundData, uint32_t bitDepth) {
+  SoundData* result = lovrSoundDataCreate(soundData->samples, soundData->sampleRate, bitDepth, soundData->channelCount);
+  float block[DSP_BLOCK];
+  size_t total = soundData->samples * soundData->channelCount;
+  for (size_t i = 0; i < total; i += DSP_BLOCK) {
+    size_t n = MIN(total - i, DSP_BLOCK);
+    readFloats(soundData, i, n, block);
+    writeFloats(result, i, n, block);
+  }
+  return result;
+}
+
+// RMS and peak absolute value over every channel of a range of frames
+void lovrSoundDataGetLevels(SoundData* soundData, size_t offset, size_t count, float* rms, float* peak) {
+  float block[DSP_BLOCK];
+  checkRange(soundData, offset, &count);
+  size_t start = offset * soundData->channelCount;
+  size_t total = count * soundData->channelCount;
+  double sum = 0.;
+  float max = 0.f;
+  for (size_t i = 0; i < total; i += DSP_BLOCK) {
+    size_t n = MIN(total - i, DSP_BLOCK);
+    readFloats(soundData, start + i, n, block);
+    float partial = 0.f;
+    for (size_t j = 0; j < n; j++) {
+      float x = fabsf(block[j]);
+      partial += x * x;
+      max = MAX(max, x);
+    }
+    sum += partial;
+  }
+  *rms = total > 0 ? (float) sqrt(sum / total) : 0.f;
+  *peak = max;
+}
+
+// Writes size / 2 bin magnitudes for a Hann windowed mono mixdown of size frames starting at offset.
+// Frames past the end are treated as silence.  A full scale sine wave peaks around 0.5.
+void lovrSoundDataGetSpectrum(SoundData* soundData, size_t offset, uint32_t size, float* magnitudes) {
+  lovrAssert(size >= 2 && (size & (size - 1)) == 0, "Spectrum size must be a power of 2");
+  lovrAssert(offset <= soundData->samples, "SoundData offset is out of range");
+  uint32_t channels = soundData->channelCount;
+  float* real = calloc(2 * size, sizeof(float));
+  lovrAssert(real, "Out of memory");
+  float* imag = real + size;
+
+  float block[DSP_BLOCK];
+  size_t frames = MIN(soundData->samples - offset, size);
+  size_t framesPerBlock = DSP_BLOCK / channels;
+  for (size_t frame = 0; frame < frames; frame += framesPerBlock) {
+    size_t n = MIN(frames - frame, framesPerBlock);
+    readFloats(soundData, (offset + frame) * channels, n * channels, block);
+    for (size_t i = 0; i < n; i++) {
+      float sum = 0.f;
+      for (uint32_t c = 0; c < channels; c++) {
+        sum += block[i * channels + c];
+      }
+      real[frame + i] = sum / channels;
+    }
+  }
+
+  for (uint32_t i = 0; i < size; i++) {
+    real[i] *= .5f - .5f * cosf(2.f * (float) M_PI * i / (size - 1));
+  }
+
+  fft(real, imag, size);
+
+  float scale = 2.f / size;
+  for (uint32_t i = 0; i < size / 2; i++) {
+    magnitudes[i] = sqrtf(real[i] * real[i] + imag[i] * imag[i]) * scale;
+  }
+
+  free(real);
+}
@@ -569,6 +569,10 @@ void lovrGraphicsMatrixTransform(mat4 transform) {
   mat4_multiply(state.transforms[state.transform], transform);
 }
 
+void lovrGraphicsGetTransform(mat4 transform) {
+  mat4_init(transform, state.transforms[state.transform]);
+}
+
 // Rendering
 
 static void lovrGraphicsBatch(BatchRequest* req) {
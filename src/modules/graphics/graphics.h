@@ -147,6 +147,7 @@ void lovrGraphicsTranslate(vec3 translation);
 void lovrGraphicsRotate(quat rotation);
 void lovrGraphicsScale(vec3 scale);
 void lovrGraphicsMatrixTransform(mat4 transform);
+void lovrGraphicsGetTransform(mat4 transform);
 
 // Rendering
 void lovrGraphicsFlush(void);
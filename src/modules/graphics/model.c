@@ -8,6 +8,7 @@
 #include "core/maf.h"
 #include "core/ref.h"
 #include <stdlib.h>
+#include <string.h>
 #include <float.h>
 #include <math.h>
 
@@ -24,6 +25,11 @@ struct Model {
   NodeTransform* localTransforms;
   float* globalTransforms;
   bool transformsDirty;
+  ModelLod* lods;
+  float lodThreshold;
+  float lodTransform[16];
+  float lodCamera[4];
+  float lodScale;
 };
 
 static void updateGlobalTransform(Model* model, uint32_t nodeIndex, mat4 parent) {
@@ -44,6 +50,29 @@ static void updateGlobalTransform(Model* model, uint32_t nodeIndex, mat4 parent)
   }
 }
 
+// Picks the coarsest level whose simplification error covers less than lodThreshold of the screen
+static uint32_t selectLod(Model* model, ModelLod* lod, mat4 globalTransform) {
+  float transform[16], scale[4];
+  float center[4] = { lod->center[0], lod->center[1], lod->center[2], 1.f };
+  mat4_multiply(mat4_init(transform, model->lodTransform), globalTransform);
+  mat4_transform(transform, center);
+  mat4_getScale(transform, scale);
+  float maxScale = MAX(MAX(scale[0], scale[1]), scale[2]);
+  float distance = vec3_distance(center, model->lodCamera) - lod->radius * maxScale;
+
+  if (distance <= 0.f) {
+    return 0;
+  }
+
+  for (uint32_t i = lod->levelCount - 1; i > 0; i--) {
+    if (lod->error[i] * maxScale * model->lodScale / distance <= model->lodThreshold) {
+      return i;
+    }
+  }
+
+  return 0;
+}
+
 static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
   ModelNode* node = &model->data->nodes[nodeIndex];
   mat4 globalTransform = model->globalTransforms + 16 * nodeIndex;
@@ -67,7 +96,15 @@ static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
   }
 
   for (uint32_t i = 0; i < node->primitiveCount; i++) {
-    lovrGraphicsDrawMesh(model->meshes[node->primitiveIndex + i], globalTransform, instances, pose);
+    uint32_t index = node->primitiveIndex + i;
+    ModelLod* lod = model->lods ? &model->lods[index] : NULL;
+
+    if (lod && lod->levelCount > 1) {
+      uint32_t level = model->lodThreshold > 0.f ? selectLod(model, lod, globalTransform) : 0;
+      lovrMeshSetDrawRange(model->meshes[index], lod->start[level], lod->count[level]);
+    }
+
+    lovrGraphicsDrawMesh(model->meshes[index], globalTransform, instances, pose);
   }
 
   for (uint32_t i = 0; i < node->childCount; i++) {
@@ -76,6 +113,7 @@ static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
 }
 
 Model* lovrModelCreate(ModelData* data) {
+  lovrModelDataFinish(data);
   Model* model = lovrAlloc(Model);
   model->data = data;
   lovrRetain(data);
@@ -126,6 +164,13 @@ Model* lovrModelCreate(ModelData* data) {
     }
 
     model->meshes = calloc(data->primitiveCount, sizeof(Mesh*));
+
+    // The LOD levels are copied since the ModelData can regenerate them later
+    if (data->lods) {
+      model->lods = malloc(data->primitiveCount * sizeof(ModelLod));
+      memcpy(model->lods, data->lods, data->primitiveCount * sizeof(ModelLod));
+    }
+
     for (uint32_t i = 0; i < data->primitiveCount; i++) {
       ModelPrimitive* primitive = &data->primitives[i];
       model->meshes[i] = lovrMeshCreate(primitive->mode, NULL, 0);
@@ -176,8 +221,19 @@ Model* lovrModelCreate(ModelData* data) {
         }
 
         size_t indexSize = attribute->type == U16 ? 2 : 4;
-        lovrMeshSetIndexBuffer(model->meshes[i], model->buffers[attribute->buffer], attribute->count, indexSize, attribute->offset);
-        lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
+        ModelLod* lod = model->lods ? &model->lods[i] : NULL;
+
+        // All of the LOD levels go in a single index buffer, the draw range picks one of them
+        if (lod && lod->levelCount > 1) {
+          uint32_t count = lod->start[lod->levelCount - 1] + lod->count[lod->levelCount - 1];
+          Buffer* buffer = lovrBufferCreate(count * indexSize, lod->data, BUFFER_INDEX, USAGE_STATIC, false);
+          lovrMeshSetIndexBuffer(model->meshes[i], buffer, count, indexSize, 0);
+          lovrMeshSetDrawRange(model->meshes[i], 0, lod->count[0]);
+          lovrRelease(Buffer, buffer);
+        } else {
+          lovrMeshSetIndexBuffer(model->meshes[i], model->buffers[attribute->buffer], attribute->count, indexSize, attribute->offset);
+          lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
+        }
       }
     }
   }
@@ -188,6 +244,7 @@ Model* lovrModelCreate(ModelData* data) {
     lovrAssert(jointCount < MAX_BONES, "ModelData skin '%d' has too many joints (%d, max is %d)", i, jointCount, MAX_BONES);
   }
 
+  model->lodThreshold = .001f;
   model->localTransforms = malloc(sizeof(NodeTransform) * data->nodeCount);
   model->globalTransforms = malloc(16 * sizeof(float) * data->nodeCount);
   lovrModelResetPose(model);
@@ -226,6 +283,7 @@ void lovrModelDestroy(void* ref) {
   }
 
   lovrRelease(ModelData, model->data);
+  free(model->lods);
   free(model->globalTransforms);
   free(model->localTransforms);
 }
@@ -234,6 +292,14 @@ ModelData* lovrModelGetModelData(Model* model) {
   return model->data;
 }
 
+float lovrModelGetLodThreshold(Model* model) {
+  return model->lodThreshold;
+}
+
+void lovrModelSetLodThreshold(Model* model, float threshold) {
+  model->lodThreshold = threshold;
+}
+
 void lovrModelDraw(Model* model, mat4 transform, uint32_t instances) {
   if (model->transformsDirty) {
     updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
@@ -242,6 +308,18 @@ void lovrModelDraw(Model* model, mat4 transform, uint32_t instances) {
 
   lovrGraphicsPush();
   lovrGraphicsMatrixTransform(transform);
+
+  // LODs are selected using the first view, both eyes are close enough to agree
+  if (model->lods) {
+    float view[16], projection[16];
+    lovrGraphicsGetTransform(model->lodTransform);
+    lovrGraphicsGetViewMatrix(0, view);
+    lovrGraphicsGetProjection(0, projection);
+    mat4_invert(view);
+    vec3_set(model->lodCamera, view[12], view[13], view[14]);
+    model->lodScale = projection[5] * .5f;
+  }
+
   renderNode(model, model->data->rootNode, instances);
   lovrGraphicsPop();
 }
@@ -15,6 +15,8 @@ typedef struct Model Model;
 Model* lovrModelCreate(struct ModelData* data);
 void lovrModelDestroy(void* ref);
 struct ModelData* lovrModelGetModelData(Model* model);
+float lovrModelGetLodThreshold(Model* model);
+void lovrModelSetLodThreshold(Model* model, float threshold);
 void lovrModelDraw(Model* model, float* transform, uint32_t instances);
 void lovrModelAnimate(Model* model, uint32_t animationIndex, float time, float alpha);
 void lovrModelGetNodePose(Model* model, uint32_t nodeIndex, float position[4], float rotation[4], CoordinateSpace space);
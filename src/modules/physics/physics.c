@@ -1,8 +1,210 @@
 #include "physics.h"
+#include "data/modelData.h"
+#include "core/os.h"
 #include "core/ref.h"
 #include "core/util.h"
+#include <math.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#ifdef LOVR_ENABLE_THREAD
+#include "lib/tinycthread/tinycthread.h"
+#endif
+
+#define SWEEP_MAX_STEPS 4096
+#define SWEEP_ITERATIONS 10
+#define SNAPSHOT_MAGIC 0x4e53574c // "LWSN"
+#define SNAPSHOT_VERSION 2
+
+// Snapshots are a header followed by one entry per collider, in collider list order.  Body state is
+// kept at ODE's precision so restoring a snapshot resumes exactly where the simulation left off.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t colliderCount;
+  uint32_t seed;
+  uint32_t precision; // sizeof(dReal)
+  uint32_t padding;
+  double accumulator;
+} SnapshotHeader;
+
+enum {
+  SNAPSHOT_AWAKE = (1 << 0),
+  SNAPSHOT_KINEMATIC = (1 << 1)
+};
+
+typedef struct {
+  dReal position[3];
+  dReal orientation[4]; // ODE order (wxyz)
+  dReal linearVelocity[3];
+  dReal angularVelocity[3];
+  dReal force[3];
+  dReal torque[3];
+  uint32_t flags;
+} ColliderSnapshot;
+
+static bool isCollisionEnabled(World* world, uint32_t i, uint32_t j) {
+  return i == NO_TAG || j == NO_TAG || ((world->masks[i] & (1 << j)) && (world->masks[j] & (1 << i)));
+}
+
+static uint64_t hashPair(Shape* a, Shape* b) {
+  Shape* pair[2] = { a, b };
+  if ((uintptr_t) a > (uintptr_t) b) {
+    pair[0] = b;
+    pair[1] = a;
+  }
+  return hash64(pair, sizeof(pair));
+}
+
+// Returns NULL if events are off for the pair, or if it was already reported during this update
+static ContactEvent* recordEvent(World* world, Shape* a, Shape* b, dContactGeom* contact) {
+  uint32_t i = a->collider->tag;
+  uint32_t j = b->collider->tag;
+
+  if (!world->eventsEnabled || (i != NO_TAG && j != NO_TAG && !(world->eventMasks[i] & (1 << j)))) {
+    return NULL;
+  }
+
+  uint64_t hash = hashPair(a, b);
+  uint64_t frame = map_get(&world->touching, hash);
+
+  if (frame == world->frame) {
+    return NULL;
+  }
+
+  map_set(&world->touching, hash, world->frame);
+  arr_push(&world->events, ((ContactEvent) {
+    .type = frame == MAP_NIL ? CONTACT_BEGIN : CONTACT_PERSIST,
+    .a = a,
+    .b = b,
+    .position = { contact->pos[0], contact->pos[1], contact->pos[2] },
+    .normal = { contact->normal[0], contact->normal[1], contact->normal[2] },
+    .depth = contact->depth,
+    .firstJoint = world->contactJoints.length
+  }));
+
+  return &world->events.data[world->events.length - 1];
+}
+
+// Contact joints are only ever created on the calling thread, the joint group isn't thread safe.
+// Friction and restitution come from the arguments, then the tag rules, then the colliders.
+// Friction stays infinite unless it was given explicitly or by a rule.
+static void addContacts(World* world, Shape* a, Shape* b, float friction, float restitution, dContactGeom* geoms, uint32_t count) {
+  Collider* colliderA = a->collider;
+  Collider* colliderB = b->collider;
+  uint32_t i = colliderA->tag;
+  uint32_t j = colliderB->tag;
+  bool tagged = i != NO_TAG && j != NO_TAG;
+  float mu = dInfinity;
+
+  if (friction < 0.f && tagged) {
+    friction = world->frictionRules[i][j];
+  }
+
+  if (friction < 0.f) {
+    friction = sqrtf(colliderA->friction * colliderB->friction);
+  } else {
+    mu = friction;
+  }
+
+  if (restitution < 0.f && tagged) {
+    restitution = world->restitutionRules[i][j];
+  }
+
+  if (restitution < 0.f) {
+    restitution = MAX(colliderA->restitution, colliderB->restitution);
+  }
+
+  ContactEvent* event = count > 0 ? recordEvent(world, a, b, &geoms[0]) : NULL;
+
+  if (a->sensor || b->sensor) {
+    return;
+  }
+
+  for (uint32_t c = 0; c < count; c++) {
+    dContact contact;
+    contact.geom = geoms[c];
+    contact.surface.mode = 0;
+    contact.surface.mu = mu;
+    contact.surface.bounce = restitution;
+
+    if (restitution > 0) {
+      contact.surface.mode |= dContactBounce;
+    }
+
+    dJointID joint = dJointCreateContact(world->id, world->contactGroup, &contact);
+    dJointAttach(joint, colliderA->body, colliderB->body);
+
+    if (event) {
+      arr_push(&world->contactJoints, joint);
+      event->jointCount++;
+    }
+  }
+
+  world->stats.contacts += count;
+}
+
+// The current events become the previous ones, the two arrays trade storage
+static void beginEvents(World* world) {
+  ContactEvent* data = world->previousEvents.data;
+  size_t capacity = world->previousEvents.capacity;
+  world->previousEvents.data = world->events.data;
+  world->previousEvents.length = world->events.length;
+  world->previousEvents.capacity = world->events.capacity;
+  world->events.data = data;
+  world->events.capacity = capacity;
+  arr_clear(&world->events);
+  arr_clear(&world->contactJoints);
+  arr_clear(&world->feedback);
+  world->frame++;
+}
+
+// Impulses are read from joint feedback, and pairs that touched last update but not this one end
+static void finishEvents(World* world, float dt) {
+  for (size_t i = 0; i < world->events.length; i++) {
+    ContactEvent* event = &world->events.data[i];
+    for (uint32_t j = 0; j < event->jointCount; j++) {
+      dJointFeedback* feedback = &world->feedback.data[event->firstJoint + j];
+      dReal* f = feedback->f1;
+      event->impulse += sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]) * dt;
+    }
+  }
+
+  for (size_t i = 0; i < world->previousEvents.length; i++) {
+    ContactEvent* previous = &world->previousEvents.data[i];
+    if (previous->type == CONTACT_END) {
+      continue;
+    }
+
+    uint64_t hash = hashPair(previous->a, previous->b);
+    if (map_get(&world->touching, hash) != world->frame) {
+      map_remove(&world->touching, hash);
+      arr_push(&world->events, ((ContactEvent) {
+        .type = CONTACT_END,
+        .a = previous->a,
+        .b = previous->b
+      }));
+    }
+  }
+}
+
+// Events point at Shapes without retaining them, so they're dropped when a Shape leaves the World
+static void forgetShape(World* world, Shape* shape) {
+  for (size_t i = world->events.length; i-- > 0;) {
+    ContactEvent* event = &world->events.data[i];
+    if (event->a == shape || event->b == shape) {
+      map_remove(&world->touching, hashPair(event->a, event->b));
+      arr_splice(&world->events, i, 1);
+    }
+  }
+
+  for (size_t i = world->previousEvents.length; i-- > 0;) {
+    ContactEvent* event = &world->previousEvents.data[i];
+    if (event->a == shape || event->b == shape) {
+      map_remove(&world->touching, hashPair(event->a, event->b));
+      arr_splice(&world->previousEvents, i, 1);
+    }
+  }
+}
 
 static void defaultNearCallback(void* data, dGeomID a, dGeomID b) {
   lovrWorldCollide((World*) data, dGeomGetData(a), dGeomGetData(b), -1, -1);
@@ -14,20 +216,205 @@ static void customNearCallback(void* data, dGeomID shapeA, dGeomID shapeB) {
   arr_push(&world->overlaps, dGeomGetData(shapeB));
 }
 
+// Broadphase pairs for the threaded narrowphase, filtered by tag up front
+static void pairNearCallback(void* data, dGeomID a, dGeomID b) {
+  World* world = data;
+  Shape* shapeA = dGeomGetData(a);
+  Shape* shapeB = dGeomGetData(b);
+
+  if (!shapeA || !shapeB || !isCollisionEnabled(world, shapeA->collider->tag, shapeB->collider->tag)) {
+    return;
+  }
+
+  arr_expand(&world->pairs, 1);
+  ContactPair* pair = &world->pairs.data[world->pairs.length++];
+  pair->a = shapeA;
+  pair->b = shapeB;
+  pair->count = 0;
+}
+
+// The static space is never collided with itself, so static pairs cost nothing.  Each dynamic geom
+// is looked up in the static quadtree, which only walks the blocks the geom overlaps.  Colliding the
+// two spaces directly would test every static geom against every dynamic one.
+static void collideSpaces(World* world, dNearCallback* callback) {
+  dSpaceCollide(world->space, world, callback);
+  if (world->staticSpace) {
+    int count = dSpaceGetNumGeoms(world->space);
+    for (int i = 0; i < count; i++) {
+      dSpaceCollide2(dSpaceGetGeom(world->space, i), (dGeomID) world->staticSpace, world, callback);
+    }
+  }
+}
+
+static uint32_t getSpaces(World* world, dSpaceID spaces[2]) {
+  spaces[0] = world->space;
+  spaces[1] = world->staticSpace;
+  return world->staticSpace ? 2 : 1;
+}
+
+static dSpaceID getColliderSpace(Collider* collider) {
+  World* world = collider->world;
+  return world->staticSpace && dBodyIsKinematic(collider->body) ? world->staticSpace : world->space;
+}
+
+static dSpaceID createSpace(WorldInfo* info, BroadPhase broadphase) {
+  dSpaceID space;
+  switch (broadphase) {
+    case BROADPHASE_HASH:
+      space = dHashSpaceCreate(0);
+      dHashSpaceSetLevels(space, info->hashLevels[0], info->hashLevels[1]);
+      return space;
+    case BROADPHASE_SAP:
+      return dSweepAndPruneSpaceCreate(0, dSAP_AXES_XZY);
+    case BROADPHASE_QUADTREE: {
+      dVector3 center = { info->center[0], info->center[1], info->center[2] };
+      dVector3 extents = { info->extents[0], info->extents[1], info->extents[2] };
+      return dQuadTreeSpaceCreate(0, center, extents, info->depth);
+    }
+    default: lovrThrow("Unreachable");
+  }
+}
+
+// Hits are collected first and reported afterwards, so callbacks can raycast too
 static void raycastCallback(void* data, dGeomID a, dGeomID b) {
-  RaycastCallback callback = ((RaycastData*) data)->callback;
-  void* userdata = ((RaycastData*) data)->userdata;
+  World* world = data;
   Shape* shape = dGeomGetData(b);
 
   if (!shape) {
     return;
   }
 
-  dContact contact;
-  if (dCollide(a, b, MAX_CONTACTS, &contact.geom, sizeof(dContact))) {
-    dContactGeom g = contact.geom;
-    callback(shape, g.pos[0], g.pos[1], g.pos[2], g.normal[0], g.normal[1], g.normal[2], userdata);
+  dContactGeom contacts[MAX_CONTACTS];
+  if (dCollide(a, b, MAX_CONTACTS, contacts, sizeof(dContactGeom))) {
+    dContactGeom* g = &contacts[0];
+    arr_push(&world->hits, ((RaycastHit) {
+      .shape = shape,
+      .position = { g->pos[0], g->pos[1], g->pos[2] },
+      .normal = { g->normal[0], g->normal[1], g->normal[2] },
+      .distance = g->depth
+    }));
+  }
+}
+
+static dGeomID getRay(World* world, uint32_t index) {
+  while (world->rays.length <= index) {
+    dGeomID ray = dCreateRay(0, 1.);
+    dGeomRaySetClosestHit(ray, 1);
+    arr_push(&world->rays, ray);
+  }
+  return world->rays.data[index];
+}
+
+// Sets up a pooled ray from a start and end point, returns false if they're the same
+static bool setRay(dGeomID ray, const float* start, const float* end) {
+  float dx = end[0] - start[0];
+  float dy = end[1] - start[1];
+  float dz = end[2] - start[2];
+  float length = sqrtf(dx * dx + dy * dy + dz * dz);
+  if (length == 0.f) {
+    return false;
+  }
+  dGeomRaySetLength(ray, length);
+  dGeomRaySet(ray, start[0], start[1], start[2], dx, dy, dz);
+  return true;
+}
+
+// Fills the target list with the enabled geoms that touch a bounding box (or all of them if it's
+// NULL) and are allowed to collide with a tag
+static void gatherTargets(World* world, const float* bounds, uint32_t tag) {
+  arr_clear(&world->targets);
+  dSpaceID spaces[2];
+  uint32_t spaceCount = getSpaces(world, spaces);
+  for (uint32_t s = 0; s < spaceCount; s++) {
+    int count = dSpaceGetNumGeoms(spaces[s]);
+    for (int i = 0; i < count; i++) {
+      dGeomID geom = dSpaceGetGeom(spaces[s], i);
+      Shape* shape = dGeomGetData(geom);
+      if (!shape || !dGeomIsEnabled(geom) || !isCollisionEnabled(world, tag, shape->collider->tag)) {
+        continue;
+      }
+
+      dReal aabb[6];
+      dGeomGetAABB(geom, aabb);
+      if (bounds && (
+        aabb[0] > bounds[1] || aabb[1] < bounds[0] ||
+        aabb[2] > bounds[3] || aabb[3] < bounds[2] ||
+        aabb[4] > bounds[5] || aabb[5] < bounds[4])) {
+        continue;
+      }
+
+      arr_push(&world->targets, ((RaycastTarget) {
+        .geom = geom,
+        .shape = shape
+      }));
+    }
+  }
+}
+
+// Narrowphase for one geom.  The ray is shortened to the closest hit so far first, which lets ODE
+// reject farther contacts early.  Returns true if the hit was replaced.
+static bool raycastGeom(dGeomID ray, dGeomID geom, Shape* shape, float* closest, RaycastHit* hit) {
+  dContactGeom contacts[MAX_CONTACTS];
+  dGeomRaySetLength(ray, *closest);
+  int count = dCollide(ray, geom, MAX_CONTACTS, contacts, sizeof(dContactGeom));
+  bool found = false;
+  for (int i = 0; i < count; i++) {
+    dContactGeom* g = &contacts[i];
+    if (g->depth <= *closest) {
+      *closest = g->depth;
+      hit->shape = shape;
+      hit->position[0] = g->pos[0];
+      hit->position[1] = g->pos[1];
+      hit->position[2] = g->pos[2];
+      hit->normal[0] = g->normal[0];
+      hit->normal[1] = g->normal[1];
+      hit->normal[2] = g->normal[2];
+      hit->distance = g->depth;
+      found = true;
+    }
+  }
+  return found;
+}
+
+typedef struct {
+  dGeomID ray;
+  RaycastHit* hit;
+  float closest;
+  bool any;
+  bool found;
+} RaycastQuery;
+
+typedef struct {
+  World* world;
+  const float* rays;
+  RaycastHit* hits;
+  uint32_t count;
+  uint32_t chunkSize;
+} RaycastBatch;
+
+static int joinChunks(void* context, dcallindex_t index, dCallReleaseeID releasee) {
+  return 1;
+}
+
+// Runs chunks on the World's ODE thread pool, whose threads are started once and already have
+// ODE's collision data allocated.  Without a pool everything runs here.  Chunks must not throw.
+static void runChunks(World* world, dThreadedCallFunction* fn, void* context, uint32_t chunks) {
+  if (!world->threading || chunks <= 1) {
+    for (uint32_t i = 0; i < chunks; i++) {
+      fn(context, i, NULL);
+    }
+    return;
+  }
+
+  const dThreadingFunctionsInfo* functions = dThreadingImplementationGetFunctions(world->threading);
+  dCallReleaseeID join;
+  functions->preallocate_resources_for_calls(world->threading, chunks + 1);
+  functions->reset_call_wait(world->threading, world->callWait);
+  functions->post_call(world->threading, NULL, &join, chunks, NULL, world->callWait, joinChunks, NULL, 0, "lovrJoin");
+  for (uint32_t i = 0; i < chunks; i++) {
+    functions->post_call(world->threading, NULL, NULL, 0, join, NULL, fn, context, i, "lovrChunk");
   }
+  functions->wait_call(world->threading, NULL, world->callWait, NULL, "lovrChunks");
 }
 
 // XXX slow, but probably fine (tag names are not on any critical path), could switch to hashing if needed
@@ -41,25 +428,82 @@ static uint32_t findTag(World* world, const char* name) {
 }
 
 static bool initialized = false;
+static map_t meshCache; // TriMeshData built from ModelData, keyed by ModelData and node (not retained)
+
+// MeshShapes can be created on any thread, so the cache has a lock
+#ifdef LOVR_ENABLE_THREAD
+static mtx_t meshCacheLock;
+#define lockMeshCache() mtx_lock(&meshCacheLock)
+#define unlockMeshCache() mtx_unlock(&meshCacheLock)
+#else
+#define lockMeshCache()
+#define unlockMeshCache()
+#endif
 
 bool lovrPhysicsInit() {
   if (initialized) return false;
   dInitODE();
+  map_init(&meshCache, 0);
+#ifdef LOVR_ENABLE_THREAD
+  mtx_init(&meshCacheLock, mtx_plain);
+#endif
   return initialized = true;
 }
 
 void lovrPhysicsDestroy() {
   if (!initialized) return;
+  map_free(&meshCache);
+#ifdef LOVR_ENABLE_THREAD
+  mtx_destroy(&meshCacheLock);
+#endif
   dCloseODE();
   initialized = false;
 }
 
-World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, uint32_t tagCount) {
+World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, uint32_t tagCount, WorldInfo* info) {
+  WorldInfo defaults = {
+    .broadphase = BROADPHASE_HASH,
+    .hashLevels = { -4, 8 },
+    .extents = { 1000.f, 1000.f, 1000.f },
+    .depth = 8
+  };
+
+  info = info ? info : &defaults;
   world->id = dWorldCreate();
-  world->space = dHashSpaceCreate(0);
-  dHashSpaceSetLevels(world->space, -4, 8);
+  world->stats.threads = 1;
+
+  // Islands are stepped on ODE's own thread pool, if it was built with one
+  uint32_t threads = MIN(info->threads, MAX_WORLD_THREADS);
+  if (threads > 1) {
+    world->threading = dThreadingAllocateMultiThreadedImplementation();
+    if (world->threading) {
+      world->threadPool = dThreadingAllocateThreadPool(threads, 0, dAllocateMaskAll, NULL);
+      if (world->threadPool) {
+        dThreadingThreadPoolServeMultiThreadedImplementation(world->threadPool, world->threading);
+        world->callWait = dThreadingImplementationGetFunctions(world->threading)->alloc_call_wait(world->threading);
+        dWorldSetStepThreadingImplementation(world->id, dThreadingImplementationGetFunctions(world->threading), world->threading);
+        dWorldSetStepIslandsProcessingMaxThreadCount(world->id, threads);
+        world->stats.threads = threads;
+      } else {
+        dThreadingFreeImplementation(world->threading);
+        world->threading = NULL;
+      }
+    }
+  }
+
+  world->space = createSpace(info, info->broadphase);
+  world->staticSpace = info->staticSpace ? createSpace(info, BROADPHASE_QUADTREE) : NULL;
   world->contactGroup = dJointGroupCreate(0);
   arr_init(&world->overlaps);
+  arr_init(&world->rays);
+  arr_init(&world->hits);
+  arr_init(&world->targets);
+  arr_init(&world->pairs);
+  arr_init(&world->events);
+  arr_init(&world->previousEvents);
+  arr_init(&world->contactJoints);
+  arr_init(&world->feedback);
+  map_init(&world->touching, 0);
   lovrWorldSetGravity(world, xg, yg, zg);
   lovrWorldSetSleepingAllowed(world, allowSleep);
   for (uint32_t i = 0; i < tagCount; i++) {
@@ -68,6 +512,15 @@ World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep
     memcpy(world->tags[i], tags[i], size);
   }
   memset(world->masks, 0xff, sizeof(world->masks));
+  memset(world->eventMasks, 0xff, sizeof(world->eventMasks));
+  world->maxSubsteps = 1;
+  world->alpha = 1.f;
+  for (uint32_t i = 0; i < MAX_TAGS; i++) {
+    for (uint32_t j = 0; j < MAX_TAGS; j++) {
+      world->frictionRules[i][j] = -1.f;
+      world->restitutionRules[i][j] = -1.f;
+    }
+  }
   return world;
 }
 
@@ -75,6 +528,15 @@ void lovrWorldDestroy(void* ref) {
   World* world = ref;
   lovrWorldDestroyData(world);
   arr_free(&world->overlaps);
+  arr_free(&world->rays);
+  arr_free(&world->hits);
+  arr_free(&world->targets);
+  arr_free(&world->pairs);
+  arr_free(&world->events);
+  arr_free(&world->previousEvents);
+  arr_free(&world->contactJoints);
+  arr_free(&world->feedback);
+  map_free(&world->touching);
   for (uint32_t i = 0; i < MAX_TAGS && world->tags[i]; i++) {
     free(world->tags[i]);
   }
@@ -92,34 +554,336 @@ void lovrWorldDestroyData(World* world) {
     world->contactGroup = NULL;
   }
 
+  for (size_t i = 0; i < world->rays.length; i++) {
+    dGeomDestroy(world->rays.data[i]);
+  }
+  arr_clear(&world->rays);
+
+  for (size_t i = 0; i < sizeof(world->queries) / sizeof(world->queries[0]); i++) {
+    if (world->queries[i]) {
+      dGeomDestroy(world->queries[i]);
+      world->queries[i] = NULL;
+    }
+  }
+  arr_clear(&world->targets);
+
   if (world->space) {
     dSpaceDestroy(world->space);
     world->space = NULL;
   }
 
+  if (world->staticSpace) {
+    dSpaceDestroy(world->staticSpace);
+    world->staticSpace = NULL;
+  }
+
+  if (world->threading) {
+    dThreadingImplementationGetFunctions(world->threading)->free_call_wait(world->threading, world->callWait);
+    dThreadingImplementationShutdownProcessing(world->threading);
+    dThreadingFreeThreadPool(world->threadPool);
+    dWorldSetStepThreadingImplementation(world->id, NULL, NULL);
+    dThreadingFreeImplementation(world->threading);
+    world->threadPool = NULL;
+    world->threading = NULL;
+  }
+
   if (world->id) {
     dWorldDestroy(world->id);
     world->id = NULL;
   }
 }
 
-void lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata) {
+const WorldStats* lovrWorldGetStats(World* world) {
+  return &world->stats;
+}
+
+typedef struct {
+  World* world;
+  uint32_t chunkSize;
+} ContactBatch;
+
+static int contactChunk(void* context, dcallindex_t index, dCallReleaseeID releasee) {
+  ContactBatch* batch = context;
+  World* world = batch->world;
+  size_t start = (size_t) index * batch->chunkSize;
+  size_t end = MIN(start + batch->chunkSize, world->pairs.length);
+
+  for (size_t i = start; i < end; i++) {
+    ContactPair* pair = &world->pairs.data[i];
+    pair->count = dCollide(pair->a->id, pair->b->id, MAX_CONTACTS, pair->contacts, sizeof(dContactGeom));
+  }
+
+  return 1;
+}
+
+// The broadphase runs on the calling thread and the narrowphase is split across workers.  Joints
+// are created afterwards in broadphase order, so the result is the same as colliding serially.
+static void collideThreaded(World* world) {
+  arr_clear(&world->pairs);
+  collideSpaces(world, pairNearCallback);
+
+  uint32_t count = world->pairs.length;
+  uint32_t chunks = MIN(world->stats.threads, count);
+  ContactBatch batch = { .world = world, .chunkSize = chunks ? (count + chunks - 1) / chunks : 0 };
+  runChunks(world, contactChunk, &batch, chunks);
+
+  for (uint32_t i = 0; i < count; i++) {
+    ContactPair* pair = &world->pairs.data[i];
+    addContacts(world, pair->a, pair->b, -1.f, -1.f, pair->contacts, pair->count);
+  }
+
+  world->stats.pairs += count;
+}
+
+// Joints from earlier substeps are gone by now, only the new ones get feedback
+static void attachFeedback(World* world) {
+  arr_reserve(&world->feedback, world->contactJoints.length);
+  for (size_t i = world->feedback.length; i < world->contactJoints.length; i++) {
+    memset(&world->feedback.data[i], 0, sizeof(dJointFeedback));
+    dJointSetFeedback(world->contactJoints.data[i], &world->feedback.data[i]);
+  }
+  world->feedback.length = world->contactJoints.length;
+}
+
+static void savePoses(World* world) {
+  for (Collider* collider = world->head; collider; collider = collider->next) {
+    const dReal* position = dBodyGetPosition(collider->body);
+    const dReal* orientation = dBodyGetQuaternion(collider->body);
+    vec3_set(collider->previousPosition, position[0], position[1], position[2]);
+    quat_set(collider->previousOrientation, orientation[1], orientation[2], orientation[3], orientation[0]);
+  }
+}
+
+static void stepWorld(World* world, float dt, CollisionResolver resolver, void* userdata) {
+  double start = lovrPlatformGetTime();
+
   if (resolver) {
     resolver(world, userdata);
+  } else if (world->stats.threads > 1 && dCheckConfiguration("ODE_EXT_mt_collisions")) {
+    collideThreaded(world);
   } else {
-    dSpaceCollide(world->space, world, defaultNearCallback);
+    collideSpaces(world, defaultNearCallback);
   }
 
+  double collided = lovrPlatformGetTime();
+
+  if (world->eventsEnabled) {
+    attachFeedback(world);
+  }
+
+  // QuickStep shuffles constraints using ODE's global random seed, each deterministic world keeps
+  // its own so other worlds can't disturb it
   if (dt > 0) {
+    if (world->deterministic) dRandSetSeed(world->seed);
     dWorldQuickStep(world->id, dt);
+    if (world->deterministic) world->seed = dRandGetSeed();
   }
 
   dJointGroupEmpty(world->contactGroup);
+
+  double end = lovrPlatformGetTime();
+  world->stats.collideTime += collided - start;
+  world->stats.stepTime += end - collided;
+}
+
+// With a step rate, time accumulates and the world advances in fixed substeps.  The leftover time
+// becomes the interpolation factor between the poses before and after the last substep.  Contact
+// events cover all substeps, a pair's impulse comes from the first substep it touched in.
+void lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata) {
+  world->stats.pairs = 0;
+  world->stats.contacts = 0;
+  world->stats.collideTime = 0.;
+  world->stats.stepTime = 0.;
+
+  float step = dt;
+  uint32_t steps = 1;
+
+  if (world->stepRate > 0.f) {
+    step = 1.f / world->stepRate;
+    world->accumulator += dt;
+
+    steps = (uint32_t) (world->accumulator / step);
+    if (steps > world->maxSubsteps) {
+      world->accumulator -= (steps - world->maxSubsteps) * step;
+      steps = world->maxSubsteps;
+    }
+  }
+
+  // Updates that don't step leave the event lists alone, otherwise touching pairs would end and
+  // begin again whenever the display rate is higher than the step rate
+  world->eventsCurrent = steps > 0;
+  if (world->eventsEnabled && steps > 0) {
+    beginEvents(world);
+  }
+
+  if (world->stepRate > 0.f) {
+    for (uint32_t i = 0; i < steps; i++) {
+      savePoses(world);
+      stepWorld(world, step, resolver, userdata);
+      world->accumulator -= step;
+    }
+
+    world->alpha = CLAMP(world->accumulator / step, 0.f, 1.f);
+  } else {
+    savePoses(world);
+    stepWorld(world, dt, resolver, userdata);
+    world->alpha = 1.f;
+  }
+
+  if (world->eventsEnabled && steps > 0) {
+    finishEvents(world, step);
+  }
+}
+
+float lovrWorldGetStepRate(World* world, uint32_t* maxSubsteps) {
+  *maxSubsteps = world->maxSubsteps;
+  return world->stepRate;
+}
+
+// A rate of zero steps by whatever time is passed to update
+void lovrWorldSetStepRate(World* world, float rate, uint32_t maxSubsteps) {
+  world->stepRate = MAX(rate, 0.f);
+  world->maxSubsteps = MAX(maxSubsteps, 1);
+  world->accumulator = 0.;
+  world->alpha = 1.f;
+}
+
+float lovrWorldGetInterpolation(World* world) {
+  return world->alpha;
+}
+
+bool lovrWorldIsDeterministic(World* world) {
+  return world->deterministic;
+}
+
+// ODE's sleep timers can't be saved, so sleeping is off while the world is deterministic.  Leaving
+// the mode gives every body the world's sleep setting again.
+void lovrWorldSetDeterministic(World* world, bool deterministic) {
+  if (deterministic == world->deterministic) {
+    return;
+  }
+
+  if (deterministic) {
+    world->sleepingAllowed = dWorldGetAutoDisableFlag(world->id);
+    world->seed = (uint32_t) dRandGetSeed();
+    dWorldSetAutoDisableFlag(world->id, 0);
+  } else {
+    dWorldSetAutoDisableFlag(world->id, world->sleepingAllowed);
+  }
+
+  // Islands stepped in parallel would draw from the shared random seed in whatever order they run
+  if (world->threading) {
+    dWorldSetStepIslandsProcessingMaxThreadCount(world->id, deterministic ? 1 : world->stats.threads);
+  }
+
+  for (Collider* collider = world->head; collider; collider = collider->next) {
+    dBodySetAutoDisableFlag(collider->body, deterministic ? 0 : world->sleepingAllowed);
+    if (deterministic) {
+      dBodyEnable(collider->body);
+    }
+  }
+
+  world->deterministic = deterministic;
+}
+
+size_t lovrWorldGetSnapshotSize(World* world) {
+  uint32_t count = 0;
+  for (Collider* collider = world->head; collider; collider = collider->next) {
+    count++;
+  }
+  return sizeof(SnapshotHeader) + count * sizeof(ColliderSnapshot);
+}
+
+// The data has to be lovrWorldGetSnapshotSize bytes.  Contact joints only exist during a step and
+// ODE doesn't warm start them, so body state is all that's needed to resume the simulation.
+void lovrWorldSaveSnapshot(World* world, void* data) {
+  SnapshotHeader* header = data;
+  ColliderSnapshot* snapshot = (ColliderSnapshot*) (header + 1);
+  uint32_t count = 0;
+
+  for (Collider* collider = world->head; collider; collider = collider->next, snapshot++, count++) {
+    dBodyID body = collider->body;
+    const dReal* position = dBodyGetPosition(body);
+    const dReal* orientation = dBodyGetQuaternion(body);
+    const dReal* linearVelocity = dBodyGetLinearVel(body);
+    const dReal* angularVelocity = dBodyGetAngularVel(body);
+    const dReal* force = dBodyGetForce(body);
+    const dReal* torque = dBodyGetTorque(body);
+    for (int i = 0; i < 3; i++) {
+      snapshot->position[i] = position[i];
+      snapshot->linearVelocity[i] = linearVelocity[i];
+      snapshot->angularVelocity[i] = angularVelocity[i];
+      snapshot->force[i] = force[i];
+      snapshot->torque[i] = torque[i];
+    }
+    for (int i = 0; i < 4; i++) {
+      snapshot->orientation[i] = orientation[i];
+    }
+    snapshot->flags = 0;
+    snapshot->flags |= dBodyIsEnabled(body) ? SNAPSHOT_AWAKE : 0;
+    snapshot->flags |= dBodyIsKinematic(body) ? SNAPSHOT_KINEMATIC : 0;
+  }
+
+  header->magic = SNAPSHOT_MAGIC;
+  header->version = SNAPSHOT_VERSION;
+  header->colliderCount = count;
+  header->precision = sizeof(dReal);
+  header->padding = 0;
+  header->seed = world->deterministic ? world->seed : (uint32_t) dRandGetSeed();
+  header->accumulator = world->accumulator;
+}
+
+// Colliders are matched up by their position in the collider list, so the world needs to have the
+// same colliders it had when the snapshot was taken
+void lovrWorldRestoreSnapshot(World* world, const void* data, size_t size) {
+  const SnapshotHeader* header = data;
+  lovrAssert(size >= sizeof(SnapshotHeader) && header->magic == SNAPSHOT_MAGIC, "Invalid World snapshot");
+  lovrAssert(header->version == SNAPSHOT_VERSION, "Unsupported World snapshot version %d", header->version);
+  lovrAssert(header->precision == sizeof(dReal), "World snapshot was saved with a different physics precision");
+  lovrAssert(size >= sizeof(SnapshotHeader) + header->colliderCount * sizeof(ColliderSnapshot), "World snapshot is truncated");
+  lovrAssert(lovrWorldGetSnapshotSize(world) == sizeof(SnapshotHeader) + header->colliderCount * sizeof(ColliderSnapshot), "World snapshot has %d colliders but the World has a different number", header->colliderCount);
+
+  const ColliderSnapshot* snapshot = (const ColliderSnapshot*) (header + 1);
+  for (Collider* collider = world->head; collider; collider = collider->next, snapshot++) {
+    dBodyID body = collider->body;
+    const dReal* orientation = snapshot->orientation;
+    lovrColliderSetKinematic(collider, snapshot->flags & SNAPSHOT_KINEMATIC);
+    dBodySetPosition(body, snapshot->position[0], snapshot->position[1], snapshot->position[2]);
+    dBodySetQuaternion(body, orientation);
+    dBodySetLinearVel(body, snapshot->linearVelocity[0], snapshot->linearVelocity[1], snapshot->linearVelocity[2]);
+    dBodySetAngularVel(body, snapshot->angularVelocity[0], snapshot->angularVelocity[1], snapshot->angularVelocity[2]);
+    dBodySetForce(body, snapshot->force[0], snapshot->force[1], snapshot->force[2]);
+    dBodySetTorque(body, snapshot->torque[0], snapshot->torque[1], snapshot->torque[2]);
+
+    if (snapshot->flags & SNAPSHOT_AWAKE) {
+      dBodyEnable(body);
+    } else {
+      dBodyDisable(body);
+    }
+
+    vec3_set(collider->previousPosition, snapshot->position[0], snapshot->position[1], snapshot->position[2]);
+    quat_set(collider->previousOrientation, orientation[1], orientation[2], orientation[3], orientation[0]);
+  }
+
+  if (world->deterministic) {
+    world->seed = header->seed;
+  } else {
+    dRandSetSeed(header->seed);
+  }
+
+  world->accumulator = header->accumulator;
+  world->alpha = 1.f;
+
+  // Touching pairs from the future would produce bogus end events
+  if (world->eventsEnabled) {
+    lovrWorldSetContactEventsEnabled(world, false);
+    lovrWorldSetContactEventsEnabled(world, true);
+  }
 }
 
 void lovrWorldComputeOverlaps(World* world) {
   arr_clear(&world->overlaps);
-  dSpaceCollide(world->space, world, customNearCallback);
+  collideSpaces(world, customNearCallback);
 }
 
 int lovrWorldGetNextOverlap(World* world, Shape** a, Shape** b) {
@@ -138,44 +902,14 @@ int lovrWorldCollide(World* world, Shape* a, Shape* b, float friction, float res
     return false;
   }
 
-  Collider* colliderA = a->collider;
-  Collider* colliderB = b->collider;
-  uint32_t i = colliderA->tag;
-  uint32_t j = colliderB->tag;
-
-  if (i != NO_TAG && j != NO_TAG && !((world->masks[i] & (1 << j)) && (world->masks[j] & (1 << i)))) {
+  if (!isCollisionEnabled(world, a->collider->tag, b->collider->tag)) {
     return false;
   }
 
-  if (friction < 0.f) {
-    friction = sqrtf(colliderA->friction * colliderB->friction);
-  }
-
-  if (restitution < 0.f) {
-    restitution = MAX(colliderA->restitution, colliderB->restitution);
-  }
-
-  dContact contacts[MAX_CONTACTS];
-  for (int c = 0; c < MAX_CONTACTS; c++) {
-    contacts[c].surface.mode = 0;
-    contacts[c].surface.mu = friction;
-    contacts[c].surface.bounce = restitution;
-    contacts[c].surface.mu = dInfinity;
-
-    if (restitution > 0) {
-      contacts[c].surface.mode |= dContactBounce;
-    }
-  }
-
-  int contactCount = dCollide(a->id, b->id, MAX_CONTACTS, &contacts[0].geom, sizeof(dContact));
-
-  if (!a->sensor && !b->sensor) {
-    for (int c = 0; c < contactCount; c++) {
-      dJointID joint = dJointCreateContact(world->id, world->contactGroup, &contacts[c]);
-      dJointAttach(joint, colliderA->body, colliderB->body);
-    }
-  }
-
+  dContactGeom contacts[MAX_CONTACTS];
+  int contactCount = dCollide(a->id, b->id, MAX_CONTACTS, contacts, sizeof(dContactGeom));
+  addContacts(world, a, b, friction, restitution, contacts, contactCount);
+  world->stats.pairs++;
   return contactCount;
 }
 
@@ -236,25 +970,472 @@ bool lovrWorldIsSleepingAllowed(World* world) {
 }
 
 void lovrWorldSetSleepingAllowed(World* world, bool allowed) {
-  dWorldSetAutoDisableFlag(world->id, allowed);
+  if (world->deterministic) {
+    world->sleepingAllowed = allowed;
+  } else {
+    dWorldSetAutoDisableFlag(world->id, allowed);
+  }
 }
 
 void lovrWorldRaycast(World* world, float x1, float y1, float z1, float x2, float y2, float z2, RaycastCallback callback, void* userdata) {
-  RaycastData data = { .callback = callback, .userdata = userdata };
-  float dx = x2 - x1;
-  float dy = y2 - y1;
-  float dz = z2 - z1;
-  float length = sqrtf(dx * dx + dy * dy + dz * dz);
-  dGeomID ray = dCreateRay(world->space, length);
-  dGeomRaySet(ray, x1, y1, z1, dx, dy, dz);
-  dSpaceCollide2(ray, (dGeomID) world->space, &data, raycastCallback);
-  dGeomDestroy(ray);
+  float start[3] = { x1, y1, z1 };
+  float end[3] = { x2, y2, z2 };
+  dGeomID ray = getRay(world, 0);
+  if (!setRay(ray, start, end)) {
+    return;
+  }
+
+  // Callbacks can raycast again, which pushes hits past ours and pops them before returning
+  size_t base = world->hits.length;
+  dSpaceID spaces[2];
+  uint32_t spaceCount = getSpaces(world, spaces);
+  for (uint32_t i = 0; i < spaceCount; i++) {
+    dSpaceCollide2(ray, (dGeomID) spaces[i], world, raycastCallback);
+  }
+  size_t count = world->hits.length;
+
+  for (size_t i = base; i < count; i++) {
+    RaycastHit hit = world->hits.data[i];
+    callback(hit.shape, hit.position[0], hit.position[1], hit.position[2], hit.normal[0], hit.normal[1], hit.normal[2], userdata);
+  }
+
+  world->hits.length = base;
+}
+
+// Narrowphase for every geom the broadphase finds near the ray.  raycastGeom shortens the ray to
+// the closest hit so far, and an any-hit query ignores everything after its first hit.
+static void raycastFirstCallback(void* data, dGeomID a, dGeomID b) {
+  RaycastQuery* query = data;
+  dGeomID geom = a == query->ray ? b : a;
+  Shape* shape = dGeomGetData(geom);
+
+  if (!shape || (query->any && query->found)) {
+    return;
+  }
+
+  query->found |= raycastGeom(query->ray, geom, shape, &query->closest, query->hit);
+}
+
+// Casts a pooled ray through the World's spaces, keeping the closest (or first) hit.  The spaces
+// aren't modified when they're already clean, so this can run on several threads with their own rays.
+static bool castRay(World* world, dGeomID ray, const float* start, const float* end, bool any, RaycastHit* hit) {
+  hit->shape = NULL;
+
+  if (!setRay(ray, start, end)) {
+    return false;
+  }
+
+  RaycastQuery query = { .ray = ray, .hit = hit, .closest = dGeomRayGetLength(ray), .any = any };
+  dGeomRaySetClosestHit(ray, !any);
+  dGeomRaySetFirstContact(ray, any);
+
+  dSpaceID spaces[2];
+  uint32_t spaceCount = getSpaces(world, spaces);
+  for (uint32_t i = 0; i < spaceCount && !(any && query.found); i++) {
+    dSpaceCollide2(ray, (dGeomID) spaces[i], &query, raycastFirstCallback);
+  }
+
+  dGeomRaySetClosestHit(ray, 1);
+  dGeomRaySetFirstContact(ray, 0);
+  return query.found;
+}
+
+// Casts one chunk of a batch through the World's spaces.  The spaces are cleaned before the batch
+// starts so nothing in the World is modified, and chunks can run in parallel with their own rays.
+static int raycastChunk(void* context, dcallindex_t index, dCallReleaseeID releasee) {
+  RaycastBatch* batch = context;
+  dGeomID ray = batch->world->rays.data[index];
+  uint32_t start = (uint32_t) index * batch->chunkSize;
+  uint32_t end = MIN(start + batch->chunkSize, batch->count);
+
+  for (uint32_t i = start; i < end; i++) {
+    const float* origin = batch->rays + 6 * i;
+    castRay(batch->world, ray, origin, origin + 3, false, &batch->hits[i]);
+  }
+
+  return 1;
+}
+
+static bool raycastFirst(World* world, float x1, float y1, float z1, float x2, float y2, float z2, bool any, RaycastHit* hit) {
+  float start[3] = { x1, y1, z1 };
+  float end[3] = { x2, y2, z2 };
+  return castRay(world, getRay(world, 0), start, end, any, hit);
+}
+
+bool lovrWorldRaycastClosest(World* world, float x1, float y1, float z1, float x2, float y2, float z2, RaycastHit* hit) {
+  return raycastFirst(world, x1, y1, z1, x2, y2, z2, false, hit);
+}
+
+bool lovrWorldRaycastAny(World* world, float x1, float y1, float z1, float x2, float y2, float z2, RaycastHit* hit) {
+  return raycastFirst(world, x1, y1, z1, x2, y2, z2, true, hit);
+}
+
+// Each ray is 6 floats (start and end point), and gets the closest hit along it.  The spaces are
+// cleaned once up front, and the rays are split across workers when ODE's collision functions are
+// thread safe (ODE_EXT_mt_collisions).  Returns the hit count.
+uint32_t lovrWorldRaycastBatch(World* world, const float* rays, uint32_t count, RaycastHit* hits, uint32_t workers) {
+  dSpaceID spaces[2];
+  uint32_t spaceCount = getSpaces(world, spaces);
+  for (uint32_t i = 0; i < spaceCount; i++) {
+    dSpaceClean(spaces[i]);
+  }
+
+  // Workers come from the World's thread pool, so there are never more chunks than pool threads.
+  // Each chunk needs its own pooled ray, which is another reason to keep the count small.
+  workers = CLAMP(workers, 1, MAX_RAYCAST_WORKERS);
+  if (!world->threading || !dCheckConfiguration("ODE_EXT_mt_collisions")) {
+    workers = 1;
+  }
+
+  uint32_t chunks = CLAMP(MIN(workers, world->stats.threads), 1, MAX(count, 1));
+  RaycastBatch batch = {
+    .world = world,
+    .rays = rays,
+    .hits = hits,
+    .count = count,
+    .chunkSize = (count + chunks - 1) / chunks
+  };
+
+  getRay(world, chunks - 1);
+
+  if (count > 0) {
+    runChunks(world, raycastChunk, &batch, chunks);
+  }
+
+  uint32_t hitCount = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    hitCount += hits[i].shape != NULL;
+  }
+  return hitCount;
 }
 
 const char* lovrWorldGetTagName(World* world, uint32_t tag) {
   return (tag == NO_TAG) ? NULL : world->tags[tag];
 }
 
+static uint32_t checkTag(World* world, const char* name) {
+  if (!name) {
+    return NO_TAG;
+  }
+
+  uint32_t tag = findTag(world, name);
+  lovrAssert(tag != NO_TAG, "Unknown tag '%s'", name);
+  return tag;
+}
+
+// Poses one of the pooled query geoms, they live outside of the space and have no body
+static dGeomID getQueryGeom(World* world, QueryShape* shape, float x, float y, float z) {
+  dGeomID* geom;
+  switch (shape->type) {
+    case SHAPE_SPHERE:
+      geom = &world->queries[0];
+      if (!*geom) *geom = dCreateSphere(0, 1.);
+      dGeomSphereSetRadius(*geom, shape->size[0]);
+      break;
+    case SHAPE_BOX:
+      geom = &world->queries[1];
+      if (!*geom) *geom = dCreateBox(0, 1., 1., 1.);
+      dGeomBoxSetLengths(*geom, shape->size[0], shape->size[1], shape->size[2]);
+      break;
+    case SHAPE_CAPSULE:
+      geom = &world->queries[2];
+      if (!*geom) *geom = dCreateCapsule(0, 1., 1.);
+      dGeomCapsuleSetParams(*geom, shape->size[0], shape->size[1]);
+      break;
+    default:
+      lovrThrow("Only sphere, box, and capsule shapes can be used for queries");
+      return NULL;
+  }
+
+  float* q = shape->orientation;
+  dReal orientation[4] = { q[3], q[0], q[1], q[2] };
+  dGeomSetQuaternion(*geom, orientation);
+  dGeomSetPosition(*geom, x, y, z);
+  return *geom;
+}
+
+// Returns the total number of overlapping shapes, which can be more than the capacity
+static uint32_t queryOverlaps(World* world, dGeomID geom, uint32_t tag, Shape** shapes, uint32_t capacity) {
+  dReal bounds[6];
+  dGeomGetAABB(geom, bounds);
+  float aabb[6] = { bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5] };
+  gatherTargets(world, aabb, tag);
+
+  uint32_t count = 0;
+  for (size_t i = 0; i < world->targets.length; i++) {
+    dContactGeom contact;
+    if (dCollide(geom, world->targets.data[i].geom, 1, &contact, sizeof(dContactGeom))) {
+      if (count < capacity) {
+        shapes[count] = world->targets.data[i].shape;
+      }
+      count++;
+    }
+  }
+  return count;
+}
+
+uint32_t lovrWorldQueryPoint(World* world, float x, float y, float z, const char* tag, Shape** shapes, uint32_t capacity) {
+  QueryShape point = { .type = SHAPE_SPHERE, .orientation = { 0.f, 0.f, 0.f, 1.f } };
+  return lovrWorldQueryShape(world, &point, x, y, z, tag, shapes, capacity);
+}
+
+uint32_t lovrWorldQueryShape(World* world, QueryShape* shape, float x, float y, float z, const char* tag, Shape** shapes, uint32_t capacity) {
+  uint32_t index = checkTag(world, tag);
+  dGeomID geom = getQueryGeom(world, shape, x, y, z);
+  return queryOverlaps(world, geom, index, shapes, capacity);
+}
+
+// Finds the part [t0, t1] of the path where the query's bounding box (a, at the start of the path)
+// overlaps a target's bounding box (b).  Returns false if they never overlap.
+static bool sweepInterval(const dReal* a, const float* delta, const dReal* b, float* t0, float* t1) {
+  *t0 = 0.f;
+  *t1 = 1.f;
+  for (int i = 0; i < 3; i++) {
+    float enter = b[2 * i] - a[2 * i + 1];
+    float exit = b[2 * i + 1] - a[2 * i];
+    if (fabsf(delta[i]) < 1e-8f) {
+      if (enter > 0.f || exit < 0.f) {
+        return false;
+      }
+    } else {
+      float ta = enter / delta[i];
+      float tb = exit / delta[i];
+      *t0 = MAX(*t0, MIN(ta, tb));
+      *t1 = MIN(*t1, MAX(ta, tb));
+      if (*t0 > *t1) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Tests the query geom against one target at a point along the path, keeping the deepest contact
+static bool sweepTest(dGeomID geom, RaycastTarget* target, const float* start, const float* delta, float t, RaycastHit* hit) {
+  dGeomSetPosition(geom, start[0] + delta[0] * t, start[1] + delta[1] * t, start[2] + delta[2] * t);
+
+  dContactGeom contacts[MAX_CONTACTS];
+  int count = dCollide(geom, target->geom, MAX_CONTACTS, contacts, sizeof(dContactGeom));
+  float deepest = -HUGE_VALF;
+  for (int c = 0; c < count; c++) {
+    dContactGeom* g = &contacts[c];
+    if (g->depth > deepest) {
+      deepest = g->depth;
+      hit->shape = target->shape;
+      hit->position[0] = g->pos[0];
+      hit->position[1] = g->pos[1];
+      hit->position[2] = g->pos[2];
+      hit->normal[0] = g->normal[0];
+      hit->normal[1] = g->normal[1];
+      hit->normal[2] = g->normal[2];
+    }
+  }
+  return count > 0;
+}
+
+// ODE has no shape casts.  For each target, the part of the path where the bounding boxes overlap is
+// found first, and only that part is stepped through in increments no bigger than half of the
+// shape's thickness until it touches, then the time of impact is refined by bisection.  Thin shapes
+// (like zero radius spheres) take at most SWEEP_MAX_STEPS steps per target, so they can still miss
+// geometry thinner than the step if their path overlaps a target's bounds for a long distance.
+// The distance in the hit is how far the shape can travel before touching the shape.
+bool lovrWorldSweep(World* world, QueryShape* shape, float x1, float y1, float z1, float x2, float y2, float z2, const char* tag, RaycastHit* hit) {
+  uint32_t index = checkTag(world, tag);
+  float start[3] = { x1, y1, z1 };
+  float delta[3] = { x2 - x1, y2 - y1, z2 - z1 };
+  float length = sqrtf(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+  dGeomID geom = getQueryGeom(world, shape, x2, y2, z2);
+  hit->shape = NULL;
+
+  dReal a[6], b[6];
+  dGeomGetAABB(geom, b);
+  dGeomSetPosition(geom, x1, y1, z1);
+  dGeomGetAABB(geom, a);
+  float bounds[6] = { MIN(a[0], b[0]), MAX(a[1], b[1]), MIN(a[2], b[2]), MAX(a[3], b[3]), MIN(a[4], b[4]), MAX(a[5], b[5]) };
+  gatherTargets(world, bounds, index);
+
+  float thickness = shape->type == SHAPE_BOX ? MIN(shape->size[0], MIN(shape->size[1], shape->size[2])) : 2.f * shape->size[0];
+  float step = length > 0.f ? .5f * thickness / length : 1.f;
+  float best = HUGE_VALF;
+  float bestLo = 0.f;
+
+  for (size_t i = 0; i < world->targets.length; i++) {
+    RaycastTarget* target = &world->targets.data[i];
+    dReal aabb[6];
+    float t0, t1;
+    dGeomGetAABB(target->geom, aabb);
+    if (!sweepInterval(a, delta, aabb, &t0, &t1) || t0 >= best) {
+      continue;
+    }
+
+    t1 = MIN(t1, best);
+    float increment = MAX(step, (t1 - t0) / SWEEP_MAX_STEPS);
+    RaycastHit candidate;
+
+    // Before t0 the bounding boxes are apart, so the shape is known to be clear there
+    float lo = t0;
+    float hi = -1.f;
+    for (float t = t0;; t = MIN(t + increment, t1)) {
+      if (sweepTest(geom, target, start, delta, t, &candidate)) {
+        hi = t;
+        break;
+      }
+      lo = t;
+      if (t >= t1) {
+        break;
+      }
+    }
+
+    if (hi < 0.f) {
+      continue;
+    }
+
+    for (int j = 0; j < SWEEP_ITERATIONS && hi > lo; j++) {
+      float t = (lo + hi) * .5f;
+      if (sweepTest(geom, target, start, delta, t, &candidate)) {
+        hi = t;
+      } else {
+        lo = t;
+      }
+    }
+
+    best = hi;
+    bestLo = lo;
+    *hit = candidate;
+  }
+
+  if (!hit->shape) {
+    return false;
+  }
+
+  hit->distance = bestLo * length;
+  return true;
+}
+
+bool lovrWorldIsContactEventsEnabled(World* world) {
+  return world->eventsEnabled;
+}
+
+void lovrWorldSetContactEventsEnabled(World* world, bool enabled) {
+  if (!enabled) {
+    arr_clear(&world->events);
+    arr_clear(&world->previousEvents);
+    map_free(&world->touching);
+    map_init(&world->touching, 0);
+  }
+
+  world->eventsEnabled = enabled;
+}
+
+int lovrWorldSetContactEventsBetween(World* world, const char* tag1, const char* tag2, bool enabled) {
+  uint32_t i = findTag(world, tag1);
+  uint32_t j = findTag(world, tag2);
+  if (i == NO_TAG || j == NO_TAG) {
+    return NO_TAG;
+  }
+
+  if (enabled) {
+    world->eventMasks[i] |= (1 << j);
+    world->eventMasks[j] |= (1 << i);
+  } else {
+    world->eventMasks[i] &= ~(1 << j);
+    world->eventMasks[j] &= ~(1 << i);
+  }
+  return 0;
+}
+
+// Negative values remove the override
+int lovrWorldSetContactRule(World* world, const char* tag1, const char* tag2, float friction, float restitution) {
+  uint32_t i = findTag(world, tag1);
+  uint32_t j = findTag(world, tag2);
+  if (i == NO_TAG || j == NO_TAG) {
+    return NO_TAG;
+  }
+
+  world->frictionRules[i][j] = world->frictionRules[j][i] = friction;
+  world->restitutionRules[i][j] = world->restitutionRules[j][i] = restitution;
+  return 0;
+}
+
+ContactEvent* lovrWorldGetContactEvents(World* world, uint32_t* count) {
+  *count = world->eventsCurrent ? world->events.length : 0;
+  return world->events.data;
+}
+
+// States are COLLIDER_STATE_SIZE floats each, in the same order as the collider list, so states
+// read by the getter can be written back with the setter as long as no colliders were added or
+// removed.  The getter returns the number of colliders that matched the tag, which can exceed the
+// capacity, and the setter returns the number of states it wrote.
+uint32_t lovrWorldGetColliderStates(World* world, const char* tag, float* data, uint32_t capacity, Collider** colliders, bool interpolate) {
+  uint32_t index = checkTag(world, tag);
+  uint32_t count = 0;
+
+  for (Collider* collider = world->head; collider; collider = collider->next) {
+    if (index != NO_TAG && collider->tag != index) {
+      continue;
+    }
+
+    if (count < capacity) {
+      float* state = data + count * COLLIDER_STATE_SIZE;
+      const dReal* position = dBodyGetPosition(collider->body);
+      const dReal* orientation = dBodyGetQuaternion(collider->body);
+      const dReal* linearVelocity = dBodyGetLinearVel(collider->body);
+      const dReal* angularVelocity = dBodyGetAngularVel(collider->body);
+      state[0] = position[0];
+      state[1] = position[1];
+      state[2] = position[2];
+      state[3] = orientation[1];
+      state[4] = orientation[2];
+      state[5] = orientation[3];
+      state[6] = orientation[0];
+      state[7] = linearVelocity[0];
+      state[8] = linearVelocity[1];
+      state[9] = linearVelocity[2];
+      state[10] = angularVelocity[0];
+      state[11] = angularVelocity[1];
+      state[12] = angularVelocity[2];
+
+      if (interpolate && world->alpha < 1.f) {
+        float pose[7];
+        vec3_init(pose, collider->previousPosition);
+        quat_init(pose + 3, collider->previousOrientation);
+        vec3_lerp(pose, state, world->alpha);
+        quat_slerp(pose + 3, state + 3, world->alpha);
+        memcpy(state, pose, sizeof(pose));
+      }
+
+      if (colliders) {
+        colliders[count] = collider;
+      }
+    }
+
+    count++;
+  }
+
+  return count;
+}
+
+uint32_t lovrWorldSetColliderStates(World* world, const char* tag, const float* data, uint32_t count) {
+  uint32_t index = checkTag(world, tag);
+  uint32_t i = 0;
+
+  for (Collider* collider = world->head; collider && i < count; collider = collider->next) {
+    if (index != NO_TAG && collider->tag != index) {
+      continue;
+    }
+
+    const float* state = data + i * COLLIDER_STATE_SIZE;
+    dReal orientation[4] = { state[6], state[3], state[4], state[5] };
+    dBodySetPosition(collider->body, state[0], state[1], state[2]);
+    dBodySetQuaternion(collider->body, orientation);
+    dBodySetLinearVel(collider->body, state[7], state[8], state[9]);
+    dBodySetAngularVel(collider->body, state[10], state[11], state[12]);
+    i++;
+  }
+
+  return i;
+}
+
 int lovrWorldDisableCollisionBetween(World* world, const char* tag1, const char* tag2) {
   uint32_t i = findTag(world, tag1);
   uint32_t j = findTag(world, tag2);
@@ -300,6 +1481,8 @@ Collider* lovrColliderInit(Collider* collider, World* world, float x, float y, f
   arr_init(&collider->joints);
 
   lovrColliderSetPosition(collider, x, y, z);
+  vec3_set(collider->previousPosition, x, y, z);
+  quat_set(collider->previousOrientation, 0.f, 0.f, 0.f, 1.f);
 
   // Adjust the world's collider list
   if (!collider->world->head) {
@@ -372,13 +1555,13 @@ void lovrColliderAddShape(Collider* collider, Shape* shape) {
 
   shape->collider = collider;
   dGeomSetBody(shape->id, collider->body);
-  dSpaceID newSpace = collider->world->space;
-  dSpaceAdd(newSpace, shape->id);
+  dSpaceAdd(getColliderSpace(collider), shape->id);
 }
 
 void lovrColliderRemoveShape(Collider* collider, Shape* shape) {
   if (shape->collider == collider) {
-    dSpaceRemove(collider->world->space, shape->id);
+    forgetShape(collider->world, shape);
+    dSpaceRemove(getColliderSpace(collider), shape->id);
     dGeomSetBody(shape->id, 0);
     shape->collider = NULL;
     lovrRelease(Shape, shape);
@@ -453,11 +1636,21 @@ bool lovrColliderIsKinematic(Collider* collider) {
 }
 
 void lovrColliderSetKinematic(Collider* collider, bool kinematic) {
+  dSpaceID oldSpace = getColliderSpace(collider);
+
   if (kinematic) {
     dBodySetKinematic(collider->body);
   } else {
     dBodySetDynamic(collider->body);
   }
+
+  dSpaceID newSpace = getColliderSpace(collider);
+  if (newSpace != oldSpace) {
+    for (dGeomID geom = dBodyGetFirstGeom(collider->body); geom; geom = dBodyGetNextGeom(geom)) {
+      dSpaceRemove(oldSpace, geom);
+      dSpaceAdd(newSpace, geom);
+    }
+  }
 }
 
 bool lovrColliderIsGravityIgnored(Collider* collider) {
@@ -687,12 +1880,10 @@ void lovrShapeDestroy(void* ref) {
 
 void lovrShapeDestroyData(Shape* shape) {
   if (shape->id) {
-    if (shape->type == SHAPE_MESH) {
-      dTriMeshDataID dataID = dGeomTriMeshGetData(shape->id);
-      dGeomTriMeshDataDestroy(dataID);
-    }
     dGeomDestroy(shape->id);
     shape->id = NULL;
+    lovrRelease(TriMeshData, shape->mesh);
+    shape->mesh = NULL;
   }
 }
 
@@ -905,17 +2096,233 @@ void lovrCylinderShapeSetLength(CylinderShape* cylinder, float length) {
   dGeomCylinderSetParams(cylinder->id, lovrCylinderShapeGetRadius(cylinder), length);
 }
 
-MeshShape* lovrMeshShapeInit(MeshShape* mesh, int vertexCount, float vertices[], int indexCount, dTriIndex indices[]) {
-  dTriMeshDataID dataID = dGeomTriMeshDataCreate();
-  dGeomTriMeshDataBuildSingle(dataID, vertices, 3 * sizeof(float), vertexCount, 
-                              indices, indexCount, 3 * sizeof(dTriIndex));
-  dGeomTriMeshDataPreprocess2(dataID, (1U << dTRIDATAPREPROCESS_BUILD_FACE_ANGLES), NULL);
-  mesh->id = dCreateTriMesh(0, dataID, 0, 0, 0);
+MeshShape* lovrMeshShapeInit(MeshShape* mesh, TriMeshData* data) {
+  lovrRetain(data);
+  mesh->mesh = data;
+  mesh->id = dCreateTriMesh(0, data->id, 0, 0, 0);
   mesh->type = SHAPE_MESH;
   dGeomSetData(mesh->id, mesh);
   return mesh;
 }
 
+TriMeshData* lovrMeshShapeGetData(MeshShape* mesh) {
+  return mesh->mesh;
+}
+
+// Takes ownership of the vertices and indices.  ODE builds the AABB tree for the triangles here, so
+// it only happens once no matter how many MeshShapes end up using the data.
+TriMeshData* lovrTriMeshDataInit(TriMeshData* data, uint32_t vertexCount, float* vertices, uint32_t indexCount, dTriIndex* indices) {
+  data->vertices = vertices;
+  data->indices = indices;
+  data->vertexCount = vertexCount;
+  data->indexCount = indexCount;
+  data->id = dGeomTriMeshDataCreate();
+  dGeomTriMeshDataBuildSingle(data->id, vertices, 3 * sizeof(float), vertexCount, indices, indexCount, 3 * sizeof(dTriIndex));
+  dGeomTriMeshDataPreprocess2(data->id, (1U << dTRIDATAPREPROCESS_BUILD_FACE_ANGLES), NULL);
+  return data;
+}
+
+typedef struct {
+  arr_t(float) vertices;
+  arr_t(dTriIndex) indices;
+} TriangleList;
+
+static const size_t typeSizes[] = {
+  [I8] = 1, [U8] = 1, [I16] = 2, [U16] = 2, [I32] = 4, [U32] = 4, [F32] = 4
+};
+
+static float readComponent(const char* p, AttributeType type, bool normalized) {
+  switch (type) {
+    case I8: return normalized ? MAX(*(int8_t*) p / 127.f, -1.f) : *(int8_t*) p;
+    case U8: return normalized ? *(uint8_t*) p / 255.f : *(uint8_t*) p;
+    case I16: return normalized ? MAX(*(int16_t*) p / 32767.f, -1.f) : *(int16_t*) p;
+    case U16: return normalized ? *(uint16_t*) p / 65535.f : *(uint16_t*) p;
+    case I32: return (float) *(int32_t*) p;
+    case U32: return (float) *(uint32_t*) p;
+    case F32: return *(float*) p;
+    default: return 0.f;
+  }
+}
+
+static uint32_t readIndex(const char* p, AttributeType type) {
+  switch (type) {
+    case U8: return *(uint8_t*) p;
+    case U16: return *(uint16_t*) p;
+    case U32: return *(uint32_t*) p;
+    default: return ~0u;
+  }
+}
+
+// Bakes the triangles of every node under (and including) the target into model space.  Returns
+// false if an index is out of range, so the caller can free the list before throwing.
+static bool gatherTriangles(ModelData* model, uint32_t nodeIndex, uint32_t target, mat4 parent, bool included, TriangleList* list) {
+  ModelNode* node = &model->nodes[nodeIndex];
+  float transform[16];
+  mat4_init(transform, parent);
+
+  if (node->matrix) {
+    mat4_multiply(transform, node->transform.matrix);
+  } else {
+    float* T = node->transform.properties.translation;
+    float* R = node->transform.properties.rotation;
+    float* S = node->transform.properties.scale;
+    mat4_translate(transform, T[0], T[1], T[2]);
+    mat4_rotateQuat(transform, R);
+    mat4_scale(transform, S[0], S[1], S[2]);
+  }
+
+  included |= nodeIndex == target;
+
+  // Mirroring transforms flip the winding, which would turn the triangles inside out
+  float* m = transform;
+  float determinant =
+    m[0] * (m[5] * m[10] - m[6] * m[9]) -
+    m[4] * (m[1] * m[10] - m[2] * m[9]) +
+    m[8] * (m[1] * m[6] - m[2] * m[5]);
+  uint32_t flip = determinant < 0.f ? 1 : 0;
+
+  for (uint32_t i = 0; included && i < node->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[node->primitiveIndex + i];
+    ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+
+    if (primitive->mode != DRAW_TRIANGLES || !position) {
+      continue;
+    }
+
+    ModelBuffer* buffer = &model->buffers[position->buffer];
+    size_t size = typeSizes[position->type];
+    size_t stride = buffer->stride ? buffer->stride : position->components * size;
+    char* data = buffer->data + position->offset;
+    uint32_t base = (uint32_t) (list->vertices.length / 3);
+    uint32_t components = MIN(position->components, 3);
+
+    arr_expand(&list->vertices, 3 * position->count);
+    for (uint32_t j = 0; j < position->count; j++) {
+      float v[4] = { 0.f };
+      for (uint32_t k = 0; k < components; k++) {
+        v[k] = readComponent(data + j * stride + k * size, position->type, position->normalized);
+      }
+      mat4_transform(transform, v);
+      list->vertices.data[list->vertices.length++] = v[0];
+      list->vertices.data[list->vertices.length++] = v[1];
+      list->vertices.data[list->vertices.length++] = v[2];
+    }
+
+    ModelAttribute* indices = primitive->indices;
+    uint32_t count = indices ? indices->count : position->count;
+    count -= count % 3;
+    arr_expand(&list->indices, count);
+
+    ModelBuffer* indexBuffer = indices ? &model->buffers[indices->buffer] : NULL;
+    size_t indexStride = indices ? (indexBuffer->stride ? indexBuffer->stride : typeSizes[indices->type]) : 0;
+    char* indexData = indices ? indexBuffer->data + indices->offset : NULL;
+
+    for (uint32_t j = 0; j < count; j += 3) {
+      uint32_t order[3] = { j, j + 1 + flip, j + 2 - flip };
+      for (uint32_t k = 0; k < 3; k++) {
+        uint32_t index = indices ? readIndex(indexData + order[k] * indexStride, indices->type) : order[k];
+        if (index >= position->count) {
+          return false;
+        }
+        list->indices.data[list->indices.length++] = base + index;
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < node->childCount; i++) {
+    if (!gatherTriangles(model, node->children[i], target, transform, included, list)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Returns a retained TriMeshData from the cache, or NULL.  Must be called with the cache locked.  An
+// entry whose last reference was just dropped on another thread is treated as missing: its
+// refcount is back to zero and it can't be freed yet, since its destroy needs the lock.
+static TriMeshData* findMesh(uint64_t hash) {
+  uint64_t cached = map_get(&meshCache, hash);
+  if (cached == MAP_NIL) {
+    return NULL;
+  }
+
+  TriMeshData* data = (TriMeshData*) (uintptr_t) cached;
+  if (ref_inc(toRef(data)) == 1) {
+    ref_dec(toRef(data));
+    return NULL;
+  }
+
+  return data;
+}
+
+// Repeated requests for the same ModelData and node share one TriMeshData while any of them is alive
+TriMeshData* lovrTriMeshDataCreateFromModel(ModelData* model, uint32_t node) {
+  lovrAssert(node == ALL_NODES || node < model->nodeCount, "Invalid node index '%d' (ModelData only has %d nodes)", node + 1, model->nodeCount);
+
+  uint64_t key[2] = { (uint64_t) (uintptr_t) model, node };
+  uint64_t hash = hash64(key, sizeof(key));
+
+  lockMeshCache();
+  TriMeshData* cached = findMesh(hash);
+  unlockMeshCache();
+
+  if (cached) {
+    return cached;
+  }
+
+  TriangleList list;
+  arr_init(&list.vertices);
+  arr_init(&list.indices);
+  float transform[16] = MAT4_IDENTITY;
+  bool valid = gatherTriangles(model, model->rootNode, node, transform, node == ALL_NODES, &list);
+
+  if (!valid || list.indices.length == 0) {
+    arr_free(&list.vertices);
+    arr_free(&list.indices);
+    lovrAssert(valid, "ModelData has an invalid vertex index");
+    lovrThrow("ModelData has no triangles to build a MeshShape from");
+  }
+
+  TriMeshData* data = lovrTriMeshDataCreate((uint32_t) list.vertices.length / 3, list.vertices.data, (uint32_t) list.indices.length, list.indices.data);
+  lovrRetain(model);
+  data->model = model;
+  data->hash = hash;
+
+  // Another thread may have built the same mesh in the meantime
+  lockMeshCache();
+  cached = findMesh(hash);
+  if (!cached) {
+    map_set(&meshCache, hash, (uint64_t) (uintptr_t) data);
+  }
+  unlockMeshCache();
+
+  if (cached) {
+    lovrRelease(TriMeshData, data);
+    return cached;
+  }
+
+  return data;
+}
+
+void lovrTriMeshDataDestroy(void* ref) {
+  TriMeshData* data = ref;
+  if (data->model) {
+    // The entry may already belong to a newer TriMeshData for the same key
+    if (initialized) {
+      lockMeshCache();
+      if (map_get(&meshCache, data->hash) == (uint64_t) (uintptr_t) data) {
+        map_remove(&meshCache, data->hash);
+      }
+      unlockMeshCache();
+    }
+    lovrRelease(ModelData, data->model);
+  }
+  dGeomTriMeshDataDestroy(data->id);
+  free(data->vertices);
+  free(data->indices);
+}
+
 void lovrJointDestroy(void* ref) {
   Joint* joint = ref;
   lovrJointDestroyData(joint);
@@ -1,5 +1,6 @@
 #include "core/arr.h"
 #include "core/maf.h"
+#include "core/map.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <ode/ode.h>
@@ -9,6 +10,12 @@
 #define MAX_CONTACTS 10
 #define MAX_TAGS 16
 #define NO_TAG ~0u
+#define MAX_RAYCAST_WORKERS 16
+#define MAX_WORLD_THREADS 16
+#define COLLIDER_STATE_SIZE 13 // Position, orientation, linear velocity, angular velocity
+#define ALL_NODES ~0u
+
+struct ModelData;
 
 typedef enum {
   SHAPE_SPHERE,
@@ -18,6 +25,22 @@ typedef enum {
   SHAPE_MESH,
 } ShapeType;
 
+typedef enum {
+  BROADPHASE_HASH,
+  BROADPHASE_SAP,
+  BROADPHASE_QUADTREE
+} BroadPhase;
+
+typedef struct {
+  uint32_t threads; // Threads used to step islands and generate contacts (at most MAX_WORLD_THREADS), 1 keeps everything on the calling thread
+  BroadPhase broadphase;
+  bool staticSpace; // Kinematic colliders go in their own quadtree, which is only collided with the other space
+  int hashLevels[2]; // Min and max cell size, as powers of two
+  float center[3]; // Quadtree bounds
+  float extents[3];
+  int depth;
+} WorldInfo;
+
 typedef enum {
   JOINT_BALL,
   JOINT_DISTANCE,
@@ -29,11 +52,90 @@ typedef struct Collider Collider;
 typedef struct Shape Shape;
 typedef struct Joint Joint;
 
+typedef struct {
+  Shape* shape; // NULL if the ray didn't hit anything
+  float position[3];
+  float normal[3];
+  float distance;
+} RaycastHit;
+
+typedef struct {
+  dGeomID geom;
+  Shape* shape;
+} RaycastTarget;
+
+typedef struct {
+  Shape* a;
+  Shape* b;
+  uint32_t count;
+  dContactGeom contacts[MAX_CONTACTS];
+} ContactPair;
+
+typedef enum {
+  CONTACT_BEGIN,
+  CONTACT_PERSIST,
+  CONTACT_END
+} ContactEventType;
+
+typedef struct {
+  ContactEventType type;
+  Shape* a;
+  Shape* b;
+  float position[3]; // First contact point, zero for end events
+  float normal[3];
+  float depth;
+  float impulse; // Total impulse applied by the contact joints during the step
+  uint32_t firstJoint; // Contact joints that belong to the event, used to compute the impulse
+  uint32_t jointCount;
+} ContactEvent;
+
+typedef struct {
+  double collideTime; // Seconds spent in the last update
+  double stepTime;
+  uint32_t pairs; // Shape pairs that were passed to the narrowphase
+  uint32_t contacts;
+  uint32_t threads;
+} WorldStats;
+
+typedef struct {
+  ShapeType type; // Sphere, box, or capsule
+  float size[3]; // Radius for spheres, dimensions for boxes, radius and length for capsules
+  float orientation[4];
+} QueryShape;
+
 typedef struct {
   dWorldID id;
   dSpaceID space;
+  dSpaceID staticSpace; // NULL unless kinematic colliders are split off
   dJointGroupID contactGroup;
   arr_t(Shape*) overlaps;
+  arr_t(dGeomID) rays; // Pooled ray geoms, they aren't in any space
+  arr_t(RaycastHit) hits;
+  arr_t(RaycastTarget) targets;
+  dGeomID queries[3]; // Pooled sphere, box, and capsule used for queries, created on demand
+  dThreadingImplementationID threading;
+  dThreadingThreadPoolID threadPool;
+  dCallWaitID callWait; // Used to wait for work the World posts to its own thread pool
+  arr_t(ContactPair) pairs;
+  WorldStats stats;
+  bool eventsEnabled;
+  uint16_t eventMasks[MAX_TAGS];
+  float frictionRules[MAX_TAGS][MAX_TAGS]; // Negative when there's no override
+  float restitutionRules[MAX_TAGS][MAX_TAGS];
+  arr_t(ContactEvent) events;
+  arr_t(ContactEvent) previousEvents;
+  bool eventsCurrent; // False when the last update didn't step, its events were already reported
+  arr_t(dJointID) contactJoints;
+  arr_t(dJointFeedback) feedback;
+  map_t touching; // Pair hash -> the last frame the pair was touching
+  uint64_t frame;
+  float stepRate; // Zero if the world is stepped by the time passed to update
+  uint32_t maxSubsteps;
+  double accumulator;
+  float alpha; // How far between the previous and current poses the leftover time is
+  bool deterministic;
+  bool sleepingAllowed; // Restored when leaving deterministic mode
+  uint32_t seed; // ODE's random seed, kept per world in deterministic mode
   char* tags[MAX_TAGS];
   uint16_t masks[MAX_TAGS];
   Collider* head;
@@ -50,14 +152,28 @@ struct Collider {
   arr_t(Joint*) joints;
   float friction;
   float restitution;
+  float previousPosition[4]; // Pose before the last step, for interpolation
+  float previousOrientation[4];
 };
 
+// Triangle data (and the AABB tree ODE builds for it) is shared by every MeshShape that uses it
+typedef struct {
+  dTriMeshDataID id;
+  float* vertices;
+  dTriIndex* indices;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  struct ModelData* model; // Set if the data was built from a ModelData, retained so cache keys stay unique
+  uint64_t hash;
+} TriMeshData;
+
 struct Shape {
   ShapeType type;
   dGeomID id;
   Collider* collider;
   void* userdata;
   bool sensor;
+  TriMeshData* mesh;
 };
 
 typedef Shape SphereShape;
@@ -80,19 +196,23 @@ typedef Joint SliderJoint;
 typedef void (*CollisionResolver)(World* world, void* userdata);
 typedef void (*RaycastCallback)(Shape* shape, float x, float y, float z, float nx, float ny, float nz, void* userdata);
 
-typedef struct {
-  RaycastCallback callback;
-  void* userdata;
-} RaycastData;
-
 bool lovrPhysicsInit(void);
 void lovrPhysicsDestroy(void);
 
-World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, uint32_t tagCount);
+World* lovrWorldInit(World* world, float xg, float yg, float zg, bool allowSleep, const char** tags, uint32_t tagCount, WorldInfo* info);
 #define lovrWorldCreate(...) lovrWorldInit(lovrAlloc(World), __VA_ARGS__)
 void lovrWorldDestroy(void* ref);
 void lovrWorldDestroyData(World* world);
+const WorldStats* lovrWorldGetStats(World* world);
 void lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata);
+float lovrWorldGetStepRate(World* world, uint32_t* maxSubsteps);
+void lovrWorldSetStepRate(World* world, float rate, uint32_t maxSubsteps);
+float lovrWorldGetInterpolation(World* world);
+bool lovrWorldIsDeterministic(World* world);
+void lovrWorldSetDeterministic(World* world, bool deterministic);
+size_t lovrWorldGetSnapshotSize(World* world);
+void lovrWorldSaveSnapshot(World* world, void* data);
+void lovrWorldRestoreSnapshot(World* world, const void* data, size_t size);
 void lovrWorldComputeOverlaps(World* world);
 int lovrWorldGetNextOverlap(World* world, Shape** a, Shape** b);
 int lovrWorldCollide(World* world, Shape* a, Shape* b, float friction, float restitution);
@@ -110,7 +230,20 @@ void lovrWorldSetAngularDamping(World* world, float damping, float threshold);
 bool lovrWorldIsSleepingAllowed(World* world);
 void lovrWorldSetSleepingAllowed(World* world, bool allowed);
 void lovrWorldRaycast(World* world, float x1, float y1, float z1, float x2, float y2, float z2, RaycastCallback callback, void* userdata);
+bool lovrWorldRaycastClosest(World* world, float x1, float y1, float z1, float x2, float y2, float z2, RaycastHit* hit);
+bool lovrWorldRaycastAny(World* world, float x1, float y1, float z1, float x2, float y2, float z2, RaycastHit* hit);
+uint32_t lovrWorldRaycastBatch(World* world, const float* rays, uint32_t count, RaycastHit* hits, uint32_t workers);
+uint32_t lovrWorldQueryPoint(World* world, float x, float y, float z, const char* tag, Shape** shapes, uint32_t capacity);
+uint32_t lovrWorldQueryShape(World* world, QueryShape* shape, float x, float y, float z, const char* tag, Shape** shapes, uint32_t capacity);
+bool lovrWorldSweep(World* world, QueryShape* shape, float x1, float y1, float z1, float x2, float y2, float z2, const char* tag, RaycastHit* hit);
 const char* lovrWorldGetTagName(World* world, uint32_t tag);
+bool lovrWorldIsContactEventsEnabled(World* world);
+void lovrWorldSetContactEventsEnabled(World* world, bool enabled);
+int lovrWorldSetContactEventsBetween(World* world, const char* tag1, const char* tag2, bool enabled);
+int lovrWorldSetContactRule(World* world, const char* tag1, const char* tag2, float friction, float restitution);
+ContactEvent* lovrWorldGetContactEvents(World* world, uint32_t* count);
+uint32_t lovrWorldGetColliderStates(World* world, const char* tag, float* data, uint32_t capacity, Collider** colliders, bool interpolate);
+uint32_t lovrWorldSetColliderStates(World* world, const char* tag, const float* data, uint32_t count);
 int lovrWorldDisableCollisionBetween(World* world, const char* tag1, const char* tag2);
 int lovrWorldEnableCollisionBetween(World* world, const char* tag1, const char* tag2);
 int lovrWorldIsCollisionEnabledBetween(World* world, const char* tag1, const char* tag);
@@ -214,9 +347,15 @@ void lovrCylinderShapeSetRadius(CylinderShape* cylinder, float radius);
 float lovrCylinderShapeGetLength(CylinderShape* cylinder);
 void lovrCylinderShapeSetLength(CylinderShape* cylinder, float length);
 
-MeshShape* lovrMeshShapeInit(MeshShape* mesh, int vertexCount, float vertices[], int indexCount, dTriIndex indices[]);
+MeshShape* lovrMeshShapeInit(MeshShape* mesh, TriMeshData* data);
 #define lovrMeshShapeCreate(...) lovrMeshShapeInit(lovrAlloc(MeshShape), __VA_ARGS__)
 #define lovrMeshShapeDestroy lovrShapeDestroy
+TriMeshData* lovrMeshShapeGetData(MeshShape* mesh);
+
+TriMeshData* lovrTriMeshDataInit(TriMeshData* data, uint32_t vertexCount, float* vertices, uint32_t indexCount, dTriIndex* indices);
+#define lovrTriMeshDataCreate(...) lovrTriMeshDataInit(lovrAlloc(TriMeshData), __VA_ARGS__)
+TriMeshData* lovrTriMeshDataCreateFromModel(struct ModelData* model, uint32_t node);
+void lovrTriMeshDataDestroy(void* ref);
 
 void lovrJointDestroy(void* ref);
 void lovrJointDestroyData(Joint* joint);
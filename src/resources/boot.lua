@@ -112,6 +112,12 @@ function lovr.boot()
       thread = true,
       timer = true
     },
+    audio = {
+      output = 'openal',
+      samplerate = 44100,
+      voices = 64,
+      path = 'audio.wav'
+    },
     graphics = {
       debug = false
     },